@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""
+priority-log-decode.py
+
+Decodes the binary output of a PriorityLogger component (log_format = "binary")
+on the host, so formatting is kept out of the system entirely.
+
+Reads console output (from a file or stdin), decodes every priority-log-raw line
+using the event catalogs, and passes every other line through unchanged:
+
+    priority-log-decode.py [--catalog FILE ...] [--cycles-per-us N] [console.log]
+
+Events are numbered in catalog order, so catalogs must be given in the same order
+as the component includes them: priority-log-events.h first (the default),
+followed by the application's PRIORITY_LOG_USER_EVENTS file, if any.
+
+Decoded records are printed in the logger's text format:
+
+    priority-log,<owner>,<ring>,<timestamp>,<priority>,<event>,<message>
+
+with timestamps in cycles, or in microseconds given --cycles-per-us.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+DEFAULT_CATALOG = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                               '..', 'priority-protocols', 'priority-log-events.h')
+
+# struct Priority_Log_Record in priority-log.h
+RECORD = struct.Struct('QHhB3x4Q')
+
+EVENT = re.compile(r'^\s*PRIORITY_LOG_EVENT\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)', re.M)
+CONVERSION = re.compile(r'%ll([dux])')
+
+
+def load_catalog(paths):
+    events = []
+    for path in paths:
+        with open(path) as f:
+            for name, fmt in EVENT.findall(f.read()):
+                events.append((name, fmt))
+    return events
+
+
+def format_message(fmt, args):
+    """Apply a catalog format, with its 64-bit conversions, to a record's arguments."""
+    values = []
+    conversions = CONVERSION.findall(fmt)
+    for conversion, arg in zip(conversions, args):
+        if conversion == 'd' and arg >= 1 << 63:
+            arg -= 1 << 64
+        values.append(arg)
+    return CONVERSION.sub(r'%\1', fmt) % tuple(values)
+
+
+def decode(line, events, endian, cycles_per_us):
+    _, owner, ring, data = line.split(',', 3)
+    raw = bytes.fromhex(data.strip())
+    timestamp, event, priority, _, *args = struct.unpack(endian + RECORD.format, raw)
+    if cycles_per_us:
+        timestamp //= cycles_per_us
+    if event >= len(events):
+        return 'priority-log,%s,%s,%d,%d,%d,unknown event' % (owner, ring, timestamp, priority, event)
+    name, fmt = events[event]
+    return 'priority-log,%s,%s,%d,%d,%s,%s' % (owner, ring, timestamp, priority, name,
+                                                format_message(fmt, args))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode binary PriorityLogger output')
+    parser.add_argument('--catalog', action='append',
+                        help='event catalog, in include order (default: priority-log-events.h)')
+    parser.add_argument('--cycles-per-us', type=int, default=0,
+                        help='convert timestamps from cycles to microseconds')
+    parser.add_argument('--big-endian', action='store_true',
+                        help='records were written by a big-endian target')
+    parser.add_argument('input', nargs='?', type=argparse.FileType('r'), default=sys.stdin)
+    args = parser.parse_args()
+
+    events = load_catalog(args.catalog or [DEFAULT_CATALOG])
+    endian = '>' if args.big_endian else '<'
+
+    for line in args.input:
+        line = line.rstrip('\r\n')
+        if line.startswith('priority-log-raw,'):
+            try:
+                line = decode(line, events, endian, args.cycles_per_us)
+            except (ValueError, struct.error) as error:
+                line = '%s (undecodable: %s)' % (line, error)
+        print(line)
+
+
+if __name__ == '__main__':
+    main()
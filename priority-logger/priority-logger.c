@@ -0,0 +1,77 @@
+/*
+
+    priority-logger.c
+
+    The control thread of the PriorityLogger component.
+    Drains the rings of the deferred log and prints each record, either as text:
+
+        priority-log,<owner>,<ring>,<timestamp>,<priority>,<event>,<message>
+
+    or in hexadecimal, for priority-log-decode.py:
+
+        priority-log-raw,<owner>,<ring>,<record bytes>
+
+    Dropped records are reported as:
+
+        priority-log-dropped,<owner>,<ring>,<count>
+
+    See priority-log.h for more details.
+
+*/
+
+#include <camkes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../priority-protocols/priority-log.h"
+
+
+static bool binary = false;
+
+static void print_record(unsigned ring, const char * owner,
+        const struct Priority_Log_Record * record, uint32_t dropped) {
+
+    if(!owner) owner = "unclaimed";
+
+    if(!record) {
+        printf("priority-log-dropped,%s,%u,%u\n", owner, ring, dropped);
+        return;
+    }
+
+    if(binary) {
+        const uint8_t * bytes = (const uint8_t *) record;
+        printf("priority-log-raw,%s,%u,", owner, ring);
+        for(unsigned i = 0; i < sizeof(*record); ++i) {
+            printf("%02x", bytes[i]);
+        }
+        printf("\n");
+        return;
+    }
+
+    const char * name = priority_log_event_name(record->event);
+    const char * format = priority_log_event_format(record->event);
+    printf("priority-log,%s,%u,%llu,%d,", owner, ring,
+            (unsigned long long) record->timestamp, record->priority);
+    if(!name) {
+        printf("%u,unknown event\n", record->event);
+        return;
+    }
+    printf("%s,", name);
+    printf(format, record->args[0], record->args[1], record->args[2], record->args[3]);
+    printf("\n");
+}
+
+int run(void) {
+
+    binary = !strcmp(log_format, "binary");
+    priority_log_init((void *) trace, PRIORITY_LOG_SIZE);
+
+    while(1) {
+        //Only runs when every thread that logs is idle
+        if(!priority_log_drain(print_record)) {
+            seL4_Yield();
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,26 @@
+/*
+
+    baseline-service.c
+
+    Implements functionality for the BaselineService component,
+    connected with the standard seL4RPCCall connector, without a priority protocol.
+    Provides the same null procedure as bench-service.c, without nesting.
+
+*/
+
+#include <camkes.h>
+
+#include "../priority-aware-camkes/priority-protocols/priority-clock.h"
+
+void b__init(void) {
+    priority_clock_init(clock_cycles_per_us);
+}
+
+void b_null(int depth, uint64_t hold_cycles, uint64_t * entered, uint64_t * exiting) {
+
+    *entered = priority_clock_cycles();
+
+    while (priority_clock_cycles() - *entered < hold_cycles);
+
+    *exiting = priority_clock_cycles();
+}
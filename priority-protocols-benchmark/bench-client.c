@@ -0,0 +1,155 @@
+/*
+
+    bench-client.c
+
+    Implements the measuring task of the benchmark application.
+    For each CPI, and each nesting depth, sends a series of null requests,
+    timestamping each with the cycle counter:
+
+        * before sending the request (sent)
+        * on entering the procedure (entered, returned by the CPI)
+        * on leaving the procedure (exiting, returned by the CPI)
+        * after receiving the reply (replied)
+
+    so that each request's round trip (replied - sent) is split into
+    its request path (entered - sent), including the CPI's priority_pre,
+    and its reply path (replied - exiting), including its priority_post.
+    The overhead of a protocol is the difference between the median paths of its CPI
+    and those of the baseline CPI, which uses the standard seL4RPCCall connector.
+
+    Requests to pip_contended are sent one per release of a periodic timeout,
+    so that the lower-priority contender tasks run in between and usually hold its lock.
+
+    Results are reported in cycles, in the format of priority-stats.h, e.g.:
+
+        priority-stats,measure,benchmark,pip,threads=2,contenders=2,depth=0,...
+
+*/
+
+#include <camkes.h>
+#include <stdlib.h>
+#include <utils/time.h>
+#include <utils/util.h>
+
+#include "../priority-aware-camkes/priority-protocols/priority-clock.h"
+#include "../priority-aware-camkes/priority-protocols/priority-stats.h"
+
+#define BENCH_MAX_ITERATIONS 1000
+#define BENCH_WARMUP 10
+
+typedef void (*bench_request_t)(int depth, uint64_t hold_cycles, uint64_t * entered, uint64_t * exiting);
+
+struct Bench_Target {
+    const char * name;
+    bench_request_t request;
+    bool nested;
+    bool released;
+};
+
+static const struct Bench_Target targets[] = {
+    {"baseline", baseline_null, false, false},
+    {"propagated", propagated_null, true, false},
+    {"pip", pip_null, true, false},
+    {"pip_contended", pip_contended_null, true, true},
+    {"ipcp", ipcp_null, true, false},
+    {"npcs", npcs_null, true, false},
+};
+
+static uint64_t round_trips[BENCH_MAX_ITERATIONS];
+static uint64_t request_paths[BENCH_MAX_ITERATIONS];
+static uint64_t reply_paths[BENCH_MAX_ITERATIONS];
+
+//Median request and reply paths of the baseline, to which each protocol is compared
+static uint64_t baseline_request = 0;
+static uint64_t baseline_reply = 0;
+
+static int compare_cycles(const void * a, const void * b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+//Value at the given percentile of sorted samples
+static uint64_t percentile(uint64_t * samples, unsigned n, unsigned p) {
+    return samples[(n - 1) * p / 100];
+}
+
+static void measure(const struct Bench_Target * target, int depth, unsigned n) {
+
+    uint64_t sent, entered, exiting, replied;
+    seL4_Word badge;
+
+    if (target->released) {
+        timeout_periodic(0, release_us * NS_IN_US);
+    }
+
+    for (unsigned i = 0; i < BENCH_WARMUP + n; i++) {
+
+        if (target->released) {
+            seL4_Wait(timeout_notification(), &badge);
+        }
+
+        sent = priority_clock_cycles();
+        target->request(depth, 0, &entered, &exiting);
+        replied = priority_clock_cycles();
+
+        if (i >= BENCH_WARMUP) {
+            round_trips[i - BENCH_WARMUP] = replied - sent;
+            request_paths[i - BENCH_WARMUP] = entered - sent;
+            reply_paths[i - BENCH_WARMUP] = replied - exiting;
+        }
+    }
+
+    if (target->released) {
+        timeout_stop(0);
+    }
+
+    uint64_t total = 0;
+    for (unsigned i = 0; i < n; i++) {
+        total += round_trips[i];
+    }
+
+    qsort(round_trips, n, sizeof(uint64_t), compare_cycles);
+    qsort(request_paths, n, sizeof(uint64_t), compare_cycles);
+    qsort(reply_paths, n, sizeof(uint64_t), compare_cycles);
+
+    uint64_t request_median = percentile(request_paths, n, 50);
+    uint64_t reply_median = percentile(reply_paths, n, 50);
+    if (target->request == baseline_null) {
+        baseline_request = request_median;
+        baseline_reply = reply_median;
+    }
+
+    PRIORITY_STATS_PRINT("benchmark", target->name,
+            "threads=%d,contenders=%d,depth=%d,samples=%u,"
+            "rtt_min=%llu,rtt_mean=%llu,rtt_median=%llu,rtt_p99=%llu,rtt_max=%llu,"
+            "request_median=%llu,reply_median=%llu,pre_overhead=%lld,post_overhead=%lld",
+            num_threads, contenders, depth, n,
+            (unsigned long long) round_trips[0],
+            (unsigned long long) (total / n),
+            (unsigned long long) percentile(round_trips, n, 50),
+            (unsigned long long) percentile(round_trips, n, 99),
+            (unsigned long long) round_trips[n - 1],
+            (unsigned long long) request_median,
+            (unsigned long long) reply_median,
+            (long long) (request_median - baseline_request),
+            (long long) (reply_median - baseline_reply));
+}
+
+int run(void) {
+
+    priority_clock_init(clock_cycles_per_us);
+
+    unsigned n = MIN(MAX(iterations, 1), BENCH_MAX_ITERATIONS);
+
+    //The baseline is measured first, and only without nesting
+    for (unsigned t = 0; t < ARRAY_SIZE(targets); t++) {
+        for (int depth = 0; depth <= (targets[t].nested ? max_depth : 0); depth++) {
+            measure(&targets[t], depth, n);
+        }
+    }
+
+    PRIORITY_STATS_PRINT("benchmark", "done", "targets=%u", (unsigned) ARRAY_SIZE(targets));
+
+    return 0;
+}
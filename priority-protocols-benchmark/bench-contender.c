@@ -0,0 +1,26 @@
+/*
+
+    bench-contender.c
+
+    Implements a contender task of the benchmark application,
+    which repeatedly sends requests to the pip_contended CPI,
+    each holding its lock for hold_us.
+
+*/
+
+#include <camkes.h>
+
+#include "../priority-aware-camkes/priority-protocols/priority-clock.h"
+
+int run(void) {
+
+    priority_clock_init(clock_cycles_per_us);
+
+    uint64_t hold_cycles = priority_clock_us_to_cycles(hold_us);
+    uint64_t entered, exiting;
+
+    while(1) {
+        pip_contended_null(0, hold_cycles, &entered, &exiting);
+    }
+
+}
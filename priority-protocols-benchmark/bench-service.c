@@ -0,0 +1,37 @@
+/*
+
+    bench-service.c
+
+    Implements functionality for the BenchService and BenchTerminator components.
+    Provides a null procedure, which holds the CPI for the requested number of cycles,
+    then, if the requested depth is nonzero, forwards a nested request with one less depth.
+    Returns cycle counter timestamps taken on entering and leaving the procedure.
+
+    BenchTerminator is compiled with BENCH_TERMINATOR defined, and has no nested interface.
+
+*/
+
+#include <camkes.h>
+
+#include "../priority-aware-camkes/priority-protocols/priority-clock.h"
+
+void b_init(void) {
+    priority_clock_init(clock_cycles_per_us);
+}
+
+void b_null(int depth, uint64_t hold_cycles, uint64_t * entered, uint64_t * exiting) {
+
+    *entered = priority_clock_cycles();
+
+    while (priority_clock_cycles() - *entered < hold_cycles);
+
+#ifndef BENCH_TERMINATOR
+    if (depth > 0) {
+        //The nested request inherits the priority of the request being handled
+        uint64_t nest_entered, nest_exiting;
+        b_nest_null(depth - 1, 0, &nest_entered, &nest_exiting);
+    }
+#endif
+
+    *exiting = priority_clock_cycles();
+}
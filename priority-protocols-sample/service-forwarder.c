@@ -15,6 +15,7 @@ void r_init(void) {
 
 }
 
-int r_pow(const int base, const int exp, const int priority) {
-    return r_nest_pow(base, exp, priority);
+int r_pow(const int base, const int exp) {
+    //The nested request inherits the priority of the request being handled
+    return r_nest_pow(base, exp);
 }
\ No newline at end of file
@@ -16,7 +16,7 @@ void r_init(void) {
 
 }
 
-int r_pow(const int base, int exp, const int priority) {
+int r_pow(const int base, int exp) {
     int res = 1;
     while (exp > 0) {
         res *= base;
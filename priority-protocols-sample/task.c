@@ -5,7 +5,9 @@
     Registers a periodic timeout with a CAmkES TimeServer global component.
     At each release, increments a global iterations variable,
     then prints the result of raising task priority to that number of iterations.
-    The power is implemented as a request to a ServiceForwarder component.
+    The power is implemented as a request to a ServiceForwarder component,
+    which is handled at the task's priority
+    (inserted into the request by the prioritized from-template).
 
 */
 
@@ -19,7 +21,7 @@ void task(void) {
     printf("Task %s: %d^%d=%d\n",
         get_instance_name(), _priority,
         release_count,
-        r_pow(_priority, release_count, _priority));
+        r_pow(_priority, release_count));
 
     release_count++;
 
@@ -0,0 +1,21 @@
+/*
+
+    camkes.h
+
+    Simulator stand-in for the CAmkES component header,
+    providing what the priority protocols library uses from it.
+
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sel4/sel4.h>
+#include <camkes/tls.h>
+
+//Names the component instance in reported statistics
+const char * get_instance_name(void);
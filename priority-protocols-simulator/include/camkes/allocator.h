@@ -0,0 +1,2 @@
+/* Simulator stand-in: the library does not use the CAmkES allocator at run time */
+#pragma once
@@ -0,0 +1,20 @@
+/*
+
+    camkes/tls.h
+
+    Simulator stand-in for CAmkES thread-local storage.
+    Each simulated thread has its own camkes_tls_t,
+    whose tcb_cap identifies the thread to the simulated system calls.
+
+*/
+
+#pragma once
+
+#include <sel4/sel4.h>
+
+typedef struct camkes_tls {
+    seL4_CPtr tcb_cap;
+    unsigned thread_index;
+} camkes_tls_t;
+
+camkes_tls_t * camkes_get_tls(void);
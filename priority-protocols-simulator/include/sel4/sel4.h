@@ -0,0 +1,25 @@
+/*
+
+    sel4/sel4.h
+
+    Simulator stand-in for the seL4 system call interface.
+    Declares only the types and system calls used by the priority protocols library;
+    the system calls are implemented by the simulator (see simulator.c),
+    which applies them to simulated threads and notification objects.
+
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned long seL4_Word;
+typedef seL4_Word seL4_CPtr;
+
+#define seL4_NoError 0
+
+int seL4_TCB_SetPriority(seL4_CPtr tcb, seL4_CPtr authority, seL4_Word priority);
+void seL4_Wait(seL4_CPtr ntfn, seL4_Word * badge);
+void seL4_Signal(seL4_CPtr ntfn);
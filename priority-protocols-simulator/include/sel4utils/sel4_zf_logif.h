@@ -0,0 +1,25 @@
+/*
+
+    sel4utils/sel4_zf_logif.h
+
+    Simulator stand-in for the seL4 logging macros used by the library.
+    A fatal error aborts the simulation.
+
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ZF_LOGF_IFERR(err, ...) \
+    do { \
+        if (err) { \
+            fprintf(stderr, __VA_ARGS__); \
+            abort(); \
+        } \
+    } while (0)
+
+#define ZF_LOGF_IF(cond, ...) ZF_LOGF_IFERR(cond, __VA_ARGS__)
+
+#define ZF_LOGF(...) ZF_LOGF_IFERR(1, __VA_ARGS__)
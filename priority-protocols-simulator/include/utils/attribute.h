@@ -0,0 +1,2 @@
+/* Simulator stand-in for libutils attributes */
+#pragma once
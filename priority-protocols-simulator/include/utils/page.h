@@ -0,0 +1,4 @@
+/* Simulator stand-in for libutils page sizes */
+#pragma once
+
+#define PAGE_SIZE_4K 4096
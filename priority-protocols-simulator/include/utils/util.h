@@ -0,0 +1,6 @@
+/* Simulator stand-in for libutils utility macros */
+#pragma once
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define ROUND_UP_UNSAFE(n, b) ((((n) + (b) - 1) / (b)) * (b))
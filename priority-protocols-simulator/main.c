@@ -0,0 +1,58 @@
+/*
+
+    main.c
+
+    Command-line driver for the priority protocols simulator.
+    Simulates each task system given on the command line in turn,
+    so candidate configurations can be compared side by side.
+
+    Usage: priority-protocols-simulator [--csv] <task-system.sim>...
+
+*/
+
+#include "task-system.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char * name) {
+    fprintf(stderr, "Usage: %s [--csv] <task-system.sim>...\n", name);
+}
+
+int main(int argc, char * argv[]) {
+
+    bool csv = false;
+    int first = 1;
+
+    if (argc > 1 && !strcmp(argv[1], "--csv")) {
+        csv = true;
+        first = 2;
+    }
+
+    if (first >= argc) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (csv) {
+        task_system_csv_header(stdout);
+    }
+
+    //Task systems are large, so only one is held at a time
+    static struct Task_System system;
+    int status = EXIT_SUCCESS;
+
+    for (int i = first; i < argc; i++) {
+        if (task_system_load(&system, argv[i])) {
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        task_system_run(&system);
+        task_system_report(&system, stdout, csv);
+        task_system_free(&system);
+    }
+
+    return status;
+}
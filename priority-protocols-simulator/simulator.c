@@ -0,0 +1,418 @@
+/*
+
+    simulator.c
+
+    The implementation of the discrete-event simulator,
+    and of the seL4 system calls used by the priority protocols library.
+    See simulator.h for more details.
+
+*/
+
+#include "simulator.h"
+#include "../priority-protocols/priority-context.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_STACK_SIZE (64 * 1024)
+
+struct Sim_Notification {
+    bool pending;
+    struct Sim_Queue waiters;
+};
+
+struct Sim_Event {
+    sim_time_t time;
+    sim_event_fn fn;
+    void * arg;
+};
+
+static struct {
+
+    sim_time_t now;
+    sim_time_t horizon;
+    sim_time_t syscall_cost;
+    sim_account_fn account;
+
+    //Threads, indexed by TCB CPtr - 1
+    struct Sim_Thread ** threads;
+    unsigned num_threads;
+    unsigned threads_size;
+
+    //Notification objects, indexed by CPtr - 1
+    struct Sim_Notification * ntfns;
+    unsigned num_ntfns;
+    unsigned ntfns_size;
+
+    //Pending events, sorted by time then insertion order
+    struct Sim_Event * events;
+    unsigned num_events;
+    unsigned events_size;
+
+    //The running thread, and the context of the scheduler loop
+    struct Sim_Thread * current;
+    ucontext_t scheduler;
+
+    //Ready threads are ordered by priority, then by sched_order
+    long long head_order;
+    long long tail_order;
+
+} sim;
+
+static void * sim_alloc(size_t size) {
+    void * ptr = calloc(1, size);
+    if (!ptr) {
+        fprintf(stderr, "simulator: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+//Grow a dynamic array to hold at least one more element
+static void * sim_grow(void * arr, unsigned * size, unsigned num, size_t elem_size) {
+    if (num < *size) return arr;
+    *size = *size ? *size * 2 : 16;
+    arr = realloc(arr, *size * elem_size);
+    if (!arr) {
+        fprintf(stderr, "simulator: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return arr;
+}
+
+
+/*
+    Queues
+*/
+
+static void sim_enqueue(struct Sim_Queue * queue, struct Sim_Thread * thread) {
+    thread->next = NULL;
+    if (queue->tail) {
+        queue->tail->next = thread;
+    }
+    else {
+        queue->head = thread;
+    }
+    queue->tail = thread;
+    queue->length++;
+}
+
+static struct Sim_Thread * sim_dequeue(struct Sim_Queue * queue) {
+    struct Sim_Thread * thread = queue->head;
+    if (thread) {
+        queue->head = thread->next;
+        if (!queue->head) queue->tail = NULL;
+        queue->length--;
+        thread->next = NULL;
+    }
+    return thread;
+}
+
+
+/*
+    Set-up and teardown
+*/
+
+void sim_init(sim_time_t horizon, sim_time_t syscall_cost, sim_account_fn account) {
+    memset(&sim, 0, sizeof(sim));
+    sim.horizon = horizon;
+    sim.syscall_cost = syscall_cost;
+    sim.account = account;
+}
+
+void sim_destroy(void) {
+    for (unsigned i = 0; i < sim.num_threads; i++) {
+        free(sim.threads[i]->stack);
+        free(sim.threads[i]);
+    }
+    free(sim.threads);
+    free(sim.ntfns);
+    free(sim.events);
+    memset(&sim, 0, sizeof(sim));
+}
+
+//Entry point of each thread's coroutine, which is started by the scheduler loop
+static void sim_thread_start(void) {
+    struct Sim_Thread * thread = sim.current;
+    thread->fn(thread);
+
+    //Return to the scheduler loop through uc_link
+    thread->state = sim_finished;
+}
+
+struct Sim_Thread * sim_thread_create(const char * name, int priority, sim_thread_fn fn, void * arg) {
+
+    struct Sim_Thread * thread = sim_alloc(sizeof(*thread));
+    thread->name = name;
+    thread->arg = arg;
+    thread->fn = fn;
+    thread->priority = priority;
+    thread->origin = -1;
+    thread->effective_priority = PRIORITY_CONTEXT_UNSET;
+
+    sim.threads = sim_grow(sim.threads, &sim.threads_size, sim.num_threads, sizeof(*sim.threads));
+    sim.threads[sim.num_threads] = thread;
+    thread->tls.thread_index = sim.num_threads;
+    thread->tls.tcb_cap = ++sim.num_threads;
+
+    thread->stack = sim_alloc(SIM_STACK_SIZE);
+    getcontext(&thread->context);
+    thread->context.uc_stack.ss_sp = thread->stack;
+    thread->context.uc_stack.ss_size = SIM_STACK_SIZE;
+    thread->context.uc_link = &sim.scheduler;
+    makecontext(&thread->context, sim_thread_start, 0);
+
+    sim_wake(thread);
+    return thread;
+}
+
+seL4_CPtr sim_notification_create(void) {
+    sim.ntfns = sim_grow(sim.ntfns, &sim.ntfns_size, sim.num_ntfns, sizeof(*sim.ntfns));
+    memset(&sim.ntfns[sim.num_ntfns], 0, sizeof(*sim.ntfns));
+    return ++sim.num_ntfns;
+}
+
+void sim_schedule_event(sim_time_t time, sim_event_fn fn, void * arg) {
+
+    sim.events = sim_grow(sim.events, &sim.events_size, sim.num_events, sizeof(*sim.events));
+
+    //Insertion sort: there are few pending events at any time
+    unsigned i = sim.num_events++;
+    while (i > 0 && sim.events[i - 1].time > time) {
+        sim.events[i] = sim.events[i - 1];
+        i--;
+    }
+    sim.events[i].time = time;
+    sim.events[i].fn = fn;
+    sim.events[i].arg = arg;
+}
+
+
+/*
+    Scheduling
+*/
+
+sim_time_t sim_now(void) {
+    return sim.now;
+}
+
+struct Sim_Thread * sim_self(void) {
+    return sim.current;
+}
+
+//Choose the highest-priority ready thread
+static struct Sim_Thread * sim_pick(void) {
+    struct Sim_Thread * best = NULL;
+    for (unsigned i = 0; i < sim.num_threads; i++) {
+        struct Sim_Thread * t = sim.threads[i];
+        if (t->state != sim_ready) continue;
+        if (!best || t->priority > best->priority) {
+            best = t;
+        }
+        else if (t->priority == best->priority && best != sim.current &&
+                (t == sim.current || t->sched_order < best->sched_order)) {
+            //The running thread is not preempted by threads of equal priority
+            best = t;
+        }
+    }
+    return best;
+}
+
+//Switch from the scheduler loop to a thread, until it makes a system call
+static void sim_switch_to(struct Sim_Thread * thread) {
+    set_effective_priority(thread->effective_priority);
+    swapcontext(&sim.scheduler, &thread->context);
+    thread->effective_priority = get_effective_priority();
+}
+
+//Switch from the running thread back to the scheduler loop
+static void sim_yield(void) {
+    swapcontext(&sim.current->context, &sim.scheduler);
+}
+
+void sim_run(void) {
+
+    while (sim.now < sim.horizon) {
+
+        //Fire all events that are due
+        while (sim.num_events && sim.events[0].time <= sim.now) {
+            struct Sim_Event event = sim.events[0];
+            sim.num_events--;
+            memmove(sim.events, sim.events + 1, sim.num_events * sizeof(*sim.events));
+            event.fn(event.arg, event.time);
+        }
+
+        //Simulated time advances to the next event at most
+        sim_time_t until = sim.horizon;
+        if (sim.num_events && sim.events[0].time < until) {
+            until = sim.events[0].time;
+        }
+
+        struct Sim_Thread * next = sim_pick();
+
+        //Idle
+        if (!next) {
+            sim.now = until;
+            continue;
+        }
+
+        //A preempted thread returns to the head of its priority level
+        if (sim.current && sim.current != next && sim.current->state == sim_ready) {
+            sim.current->sched_order = --sim.head_order;
+        }
+        sim.current = next;
+
+        //Execute, until done or until the next event
+        if (next->work) {
+            sim_time_t end = sim.now + next->work;
+            if (end > until) end = until;
+            if (sim.account) sim.account(next, sim.now, end);
+            next->work -= end - sim.now;
+            sim.now = end;
+            continue;
+        }
+
+        sim_switch_to(next);
+    }
+
+    sim.current = NULL;
+}
+
+void sim_block(void) {
+    sim.current->state = sim_blocked;
+    sim_yield();
+}
+
+void sim_wake(struct Sim_Thread * thread) {
+    thread->state = sim_ready;
+    thread->sched_order = sim.tail_order++;
+}
+
+void sim_compute(sim_time_t time) {
+    if (time <= 0) return;
+    sim.current->work = time;
+    sim_yield();
+}
+
+
+/*
+    System calls
+
+    Each system call first executes for the configured system call cost,
+    then takes effect, then returns to the scheduler loop
+    so that any thread it made ready can preempt the caller.
+*/
+
+static void sim_kernel_entry(void) {
+    sim_compute(sim.syscall_cost);
+}
+
+void sim_call(struct Sim_Endpoint * ep, struct Sim_Message * msg) {
+
+    struct Sim_Thread * self = sim.current;
+    sim_kernel_entry();
+
+    self->msg = *msg;
+
+    //Transfer to the first waiting receiver, otherwise queue in FIFO order
+    struct Sim_Thread * receiver = sim_dequeue(&ep->receivers);
+    if (receiver) {
+        receiver->msg = self->msg;
+        receiver->caller = self;
+        sim_wake(receiver);
+    }
+    else {
+        sim_enqueue(&ep->senders, self);
+        if (ep->senders.length > ep->max_senders) {
+            ep->max_senders = ep->senders.length;
+        }
+    }
+
+    //Wait for the reply
+    sim_block();
+    *msg = self->msg;
+}
+
+void sim_recv(struct Sim_Endpoint * ep, struct Sim_Message * msg) {
+
+    struct Sim_Thread * self = sim.current;
+    sim_kernel_entry();
+
+    //Take the first queued sender, otherwise wait in FIFO order
+    struct Sim_Thread * sender = sim_dequeue(&ep->senders);
+    if (sender) {
+        self->msg = sender->msg;
+        self->caller = sender;
+        sim_yield();
+    }
+    else {
+        sim_enqueue(&ep->receivers, self);
+        sim_block();
+    }
+
+    *msg = self->msg;
+}
+
+//Reply to the caller, without rescheduling: always followed by sim_recv, as for seL4_ReplyRecv
+void sim_reply(struct Sim_Message * msg) {
+    struct Sim_Thread * caller = sim.current->caller;
+    sim.current->caller = NULL;
+    caller->msg = *msg;
+    sim_wake(caller);
+}
+
+int seL4_TCB_SetPriority(seL4_CPtr tcb, seL4_CPtr authority, seL4_Word priority) {
+
+    (void) authority;
+    sim_kernel_entry();
+
+    if (tcb == 0 || tcb > sim.num_threads) {
+        return 1;
+    }
+    sim.threads[tcb - 1]->priority = (int) priority;
+
+    sim_yield();
+    return seL4_NoError;
+}
+
+void seL4_Wait(seL4_CPtr ntfn, seL4_Word * badge) {
+
+    sim_kernel_entry();
+
+    struct Sim_Notification * n = &sim.ntfns[ntfn - 1];
+    if (n->pending) {
+        n->pending = false;
+        sim_yield();
+    }
+    else {
+        sim_enqueue(&n->waiters, sim.current);
+        sim_block();
+    }
+
+    if (badge) *badge = 0;
+}
+
+void seL4_Signal(seL4_CPtr ntfn) {
+
+    sim_kernel_entry();
+
+    struct Sim_Notification * n = &sim.ntfns[ntfn - 1];
+    struct Sim_Thread * waiter = sim_dequeue(&n->waiters);
+    if (waiter) {
+        sim_wake(waiter);
+    }
+    else {
+        n->pending = true;
+    }
+
+    sim_yield();
+}
+
+camkes_tls_t * camkes_get_tls(void) {
+    return &sim.current->tls;
+}
+
+const char * get_instance_name(void) {
+    return sim.current ? sim.current->name : "simulator";
+}
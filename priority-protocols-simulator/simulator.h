@@ -0,0 +1,143 @@
+/*
+
+    simulator.h
+
+    A discrete-event simulator for fixed-priority preemptive scheduling on a uniprocessor,
+    modeling the parts of the seL4 kernel used by our priority protocols:
+
+        * Threads, scheduled at their (dynamically changeable) seL4 priorities.
+          Equal-priority threads run in FIFO order;
+          a preempted thread is returned to the head of its priority level, as in seL4.
+
+        * FIFO endpoints, on which clients call and threadpool threads receive and reply.
+          As in the non-MCS kernel, neither queue is ordered by priority.
+
+        * FIFO notification objects.
+
+    Each simulated thread runs as a coroutine on the host thread,
+    so the simulated code is ordinary C:
+    it advances simulated time only by calling sim_compute,
+    and everything else (including the priority protocols library) takes zero simulated time,
+    unless a system call cost is configured.
+
+    The seL4 system calls used by the priority protocols library
+    (seL4_TCB_SetPriority, seL4_Wait, seL4_Signal, and camkes_get_tls)
+    are implemented here against the simulated threads,
+    so priority-protocols.c, priority-inheritance.c and notification-manager.c
+    are compiled unmodified into the simulator (see include/ for the stand-in headers).
+
+    Times are in nanoseconds.
+
+*/
+
+#pragma once
+
+#include <camkes.h>
+#include <camkes/tls.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <ucontext.h>
+
+typedef int64_t sim_time_t;
+
+#define SIM_US ((sim_time_t) 1000)
+#define SIM_MS ((sim_time_t) 1000000)
+
+enum sim_thread_states {
+    sim_ready,
+    sim_blocked,
+    sim_finished
+};
+
+//The contents of a simulated IPC message
+struct Sim_Message {
+    int priority;
+    int origin;
+};
+
+struct Sim_Thread;
+
+typedef void (*sim_thread_fn)(struct Sim_Thread * thread);
+
+struct Sim_Thread {
+
+    const char * name;
+    void * arg;
+    sim_thread_fn fn;
+
+    //Scheduling state
+    int priority;
+    int state;
+    long long sched_order;
+
+    //Remaining execution time of the current sim_compute call
+    sim_time_t work;
+
+    //The task on whose behalf the thread currently executes, -1 if none
+    int origin;
+
+    //Per-thread state of the simulated code
+    camkes_tls_t tls;
+    int effective_priority;
+
+    //IPC state
+    struct Sim_Message msg;
+    struct Sim_Thread * caller;
+
+    //Link for endpoint and notification queues
+    struct Sim_Thread * next;
+
+    ucontext_t context;
+    void * stack;
+
+};
+
+struct Sim_Queue {
+    struct Sim_Thread * head;
+    struct Sim_Thread * tail;
+    unsigned length;
+};
+
+struct Sim_Endpoint {
+    struct Sim_Queue senders;
+    struct Sim_Queue receivers;
+
+    //Statistics
+    unsigned max_senders;
+};
+
+//Called for each interval of simulated time during which a thread executes
+typedef void (*sim_account_fn)(struct Sim_Thread * thread, sim_time_t start, sim_time_t end);
+
+//Called when a scheduled event fires
+typedef void (*sim_event_fn)(void * arg, sim_time_t time);
+
+
+//Set up a simulation up to the given horizon; only one simulation exists at a time
+void sim_init(sim_time_t horizon, sim_time_t syscall_cost, sim_account_fn account);
+
+//Run the simulation to its horizon, then tear it down
+void sim_run(void);
+void sim_destroy(void);
+
+//Set-up functions, called before sim_run (or from simulated code and events)
+struct Sim_Thread * sim_thread_create(const char * name, int priority, sim_thread_fn fn, void * arg);
+seL4_CPtr sim_notification_create(void);
+void sim_schedule_event(sim_time_t time, sim_event_fn fn, void * arg);
+
+//The current simulated time, and the running thread
+sim_time_t sim_now(void);
+struct Sim_Thread * sim_self(void);
+
+//Block and wake threads, for models of kernel objects outside this file
+void sim_block(void);
+void sim_wake(struct Sim_Thread * thread);
+
+//Execute for the given amount of simulated time, subject to preemption
+void sim_compute(sim_time_t time);
+
+//Endpoints
+void sim_call(struct Sim_Endpoint * ep, struct Sim_Message * msg);
+void sim_recv(struct Sim_Endpoint * ep, struct Sim_Message * msg);
+void sim_reply(struct Sim_Message * msg);
@@ -0,0 +1,661 @@
+/*
+
+    task-system.c
+
+    The implementation of the simulated task system model.
+    See task-system.h for more details.
+
+*/
+
+#include "task-system.h"
+#include "simulator.h"
+#include "../priority-protocols/priority-protocols.h"
+#include "../priority-protocols/notification-manager.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TASK_SYSTEM_LINE_SIZE 1024
+
+//The task system being simulated, for the accounting callback
+static struct Task_System * simulated;
+
+//Random number generator state for execution times (xorshift64*)
+static uint64_t rng;
+
+static sim_time_t sample(struct Sim_Range * range) {
+    if (range->max <= range->min) return range->min;
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    uint64_t r = rng * 2685821657736338717ULL;
+    return range->min + (sim_time_t) (r % (uint64_t) (range->max - range->min + 1));
+}
+
+
+/*
+    Configuration
+
+    A configuration file contains one declaration per line; # starts a comment.
+
+        horizon_s <seconds>          (or horizon_ms)
+        syscall_ns <nanoseconds>     cost of each simulated system call, default 0
+        seed <integer>               seed for execution times drawn from ranges
+
+        cpi <name> protocol=<propagated|inherited|fixed|threshold> priority=<p> threads=<n>
+                   [threshold=<p>] [pre_us=<t>] [call=<cpi>] [post_us=<t>]
+
+        task <name> priority=<p> period_ms=<t> [deadline_ms=<t>] [offset_ms=<t>]
+                    [pre_us=<t>] [call=<cpi>] [post_us=<t>]
+
+    Execution times may be a single value, or a range min-max drawn uniformly per job.
+    Fractional values are allowed.
+*/
+
+static int config_error(const char * path, unsigned line, const char * message, const char * token) {
+    fprintf(stderr, "%s:%u: %s \"%s\"\n", path, line, message, token);
+    return -1;
+}
+
+static int parse_time(const char * value, sim_time_t unit, sim_time_t * time) {
+    char * end;
+    errno = 0;
+    double t = strtod(value, &end);
+    if (errno || end == value || *end || t < 0) return -1;
+    *time = (sim_time_t) (t * unit + 0.5);
+    return 0;
+}
+
+static int parse_range(const char * value, sim_time_t unit, struct Sim_Range * range) {
+
+    //The separator is the first '-' after the first character
+    const char * dash = strchr(value + 1, '-');
+    if (!dash) {
+        if (parse_time(value, unit, &range->min)) return -1;
+        range->max = range->min;
+        return 0;
+    }
+
+    char min[64];
+    size_t len = dash - value;
+    if (len >= sizeof(min)) return -1;
+    memcpy(min, value, len);
+    min[len] = '\0';
+
+    if (parse_time(min, unit, &range->min) || parse_time(dash + 1, unit, &range->max)) return -1;
+    if (range->max < range->min) return -1;
+    return 0;
+}
+
+static int parse_int(const char * value, long min, long max, long * result) {
+    char * end;
+    errno = 0;
+    long l = strtol(value, &end, 0);
+    if (errno || end == value || *end || l < min || l > max) return -1;
+    *result = l;
+    return 0;
+}
+
+static int parse_protocol(const char * value) {
+    if (!strcmp(value, "propagated")) return propagated;
+    if (!strcmp(value, "inherited")) return inherited;
+    if (!strcmp(value, "fixed")) return fixed;
+    if (!strcmp(value, "threshold")) return threshold;
+    return -1;
+}
+
+static const char * protocol_name(int protocol) {
+    switch (protocol) {
+        case propagated: return "propagated";
+        case inherited: return "inherited";
+        case fixed: return "fixed";
+        case threshold: return "threshold";
+        default: return "unknown";
+    }
+}
+
+static int set_name(char * name, const char * value) {
+    if (strlen(value) >= TASK_SYSTEM_NAME_SIZE) return -1;
+    strcpy(name, value);
+    return 0;
+}
+
+static struct Sim_CPI * find_cpi(struct Task_System * system, const char * name) {
+    for (unsigned i = 0; i < system->num_cpis; i++) {
+        if (!strcmp(system->cpis[i].name, name)) return &system->cpis[i];
+    }
+    return NULL;
+}
+
+//Parse the key=value attributes of a cpi declaration
+static int parse_cpi_attribute(struct Sim_CPI * cpi, const char * key, const char * value) {
+    long l;
+    if (!strcmp(key, "protocol")) {
+        cpi->protocol = parse_protocol(value);
+        return cpi->protocol < 0 ? -1 : 0;
+    }
+    if (!strcmp(key, "priority")) {
+        if (parse_int(value, 0, 255, &l)) return -1;
+        cpi->priority = (int) l;
+        return 0;
+    }
+    if (!strcmp(key, "threads")) {
+        if (parse_int(value, 1, 1024, &l)) return -1;
+        cpi->num_threads = (unsigned) l;
+        return 0;
+    }
+    if (!strcmp(key, "threshold")) {
+        if (parse_int(value, 0, 255, &l)) return -1;
+        cpi->threshold = (int) l;
+        return 0;
+    }
+    if (!strcmp(key, "pre_us")) return parse_range(value, SIM_US, &cpi->pre);
+    if (!strcmp(key, "post_us")) return parse_range(value, SIM_US, &cpi->post);
+    if (!strcmp(key, "call")) return set_name(cpi->call_name, value);
+    return -1;
+}
+
+//Parse the key=value attributes of a task declaration
+static int parse_task_attribute(struct Sim_Task * task, const char * key, const char * value) {
+    long l;
+    if (!strcmp(key, "priority")) {
+        if (parse_int(value, 0, 255, &l)) return -1;
+        task->priority = (int) l;
+        return 0;
+    }
+    if (!strcmp(key, "period_ms")) return parse_time(value, SIM_MS, &task->period);
+    if (!strcmp(key, "deadline_ms")) return parse_time(value, SIM_MS, &task->deadline);
+    if (!strcmp(key, "offset_ms")) return parse_time(value, SIM_MS, &task->offset);
+    if (!strcmp(key, "pre_us")) return parse_range(value, SIM_US, &task->pre);
+    if (!strcmp(key, "post_us")) return parse_range(value, SIM_US, &task->post);
+    if (!strcmp(key, "call")) return set_name(task->call_name, value);
+    return -1;
+}
+
+//Resolve and check requests between CPIs once all declarations are read
+static int task_system_resolve(struct Task_System * system) {
+
+    for (unsigned i = 0; i < system->num_cpis; i++) {
+        struct Sim_CPI * cpi = &system->cpis[i];
+
+        if (cpi->protocol < 0 || cpi->priority < 0 || !cpi->num_threads) {
+            fprintf(stderr, "%s: cpi %s requires protocol, priority and threads\n", system->path, cpi->name);
+            return -1;
+        }
+
+        if (cpi->protocol == threshold && (cpi->threshold < 0 || cpi->threshold > cpi->priority)) {
+            fprintf(stderr, "%s: cpi %s requires a threshold of at most its priority\n", system->path, cpi->name);
+            return -1;
+        }
+
+        if (cpi->call_name[0]) {
+            cpi->call = find_cpi(system, cpi->call_name);
+            if (!cpi->call) {
+                fprintf(stderr, "%s: cpi %s calls unknown cpi %s\n", system->path, cpi->name, cpi->call_name);
+                return -1;
+            }
+
+            //Currently, our framework does not support nested PIP
+            if (cpi->protocol == inherited && cpi->call->protocol == inherited) {
+                fprintf(stderr, "%s: cpi %s implements PIP and calls cpi %s, which also implements PIP\n",
+                        system->path, cpi->name, cpi->call->name);
+                return -1;
+            }
+        }
+    }
+
+    //A cycle of requests would deadlock
+    for (unsigned i = 0; i < system->num_cpis; i++) {
+        struct Sim_CPI * cpi = &system->cpis[i];
+        for (unsigned depth = 0; cpi; depth++, cpi = cpi->call) {
+            if (depth > system->num_cpis) {
+                fprintf(stderr, "%s: cpi %s is part of a cycle of requests\n", system->path, system->cpis[i].name);
+                return -1;
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < system->num_tasks; i++) {
+        struct Sim_Task * task = &system->tasks[i];
+
+        if (task->priority < 0 || !task->period) {
+            fprintf(stderr, "%s: task %s requires priority and period_ms\n", system->path, task->name);
+            return -1;
+        }
+
+        //Implicit deadlines by default
+        if (!task->deadline) task->deadline = task->period;
+
+        if (task->call_name[0]) {
+            task->call = find_cpi(system, task->call_name);
+            if (!task->call) {
+                fprintf(stderr, "%s: task %s calls unknown cpi %s\n", system->path, task->name, task->call_name);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int task_system_load(struct Task_System * system, const char * path) {
+
+    memset(system, 0, sizeof(*system));
+    system->path = path;
+    system->horizon = 60 * 1000 * SIM_MS;
+    system->seed = 1;
+
+    FILE * file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+
+    char buffer[TASK_SYSTEM_LINE_SIZE];
+    unsigned line = 0;
+    int error = 0;
+
+    while (!error && fgets(buffer, sizeof(buffer), file)) {
+        line++;
+
+        char * comment = strchr(buffer, '#');
+        if (comment) *comment = '\0';
+
+        char * keyword = strtok(buffer, " \t\r\n");
+        if (!keyword) continue;
+
+        char * value = strtok(NULL, " \t\r\n");
+        if (!value) {
+            error = config_error(path, line, "missing value for", keyword);
+            break;
+        }
+
+        long l;
+        if (!strcmp(keyword, "horizon_s") || !strcmp(keyword, "horizon_ms")) {
+            sim_time_t unit = keyword[8] == 's' ? 1000 * SIM_MS : SIM_MS;
+            if (parse_time(value, unit, &system->horizon) || !system->horizon) {
+                error = config_error(path, line, "invalid horizon", value);
+            }
+        }
+        else if (!strcmp(keyword, "syscall_ns")) {
+            if (parse_time(value, 1, &system->syscall_cost)) {
+                error = config_error(path, line, "invalid system call cost", value);
+            }
+        }
+        else if (!strcmp(keyword, "seed")) {
+            if (parse_int(value, 1, __LONG_MAX__, &l)) {
+                error = config_error(path, line, "invalid seed", value);
+            }
+            else {
+                system->seed = (uint64_t) l;
+            }
+        }
+        else if (!strcmp(keyword, "cpi") || !strcmp(keyword, "task")) {
+
+            bool is_cpi = keyword[0] == 'c';
+            struct Sim_CPI * cpi = NULL;
+            struct Sim_Task * task = NULL;
+
+            if (is_cpi && find_cpi(system, value)) {
+                error = config_error(path, line, "duplicate cpi", value);
+                break;
+            }
+
+            if (is_cpi) {
+                if (system->num_cpis == TASK_SYSTEM_MAX_CPIS) {
+                    error = config_error(path, line, "too many cpis at", value);
+                    break;
+                }
+                cpi = &system->cpis[system->num_cpis++];
+                cpi->protocol = -1;
+                cpi->priority = -1;
+                cpi->threshold = -1;
+                if (set_name(cpi->name, value)) error = config_error(path, line, "name too long", value);
+            }
+            else {
+                if (system->num_tasks == TASK_SYSTEM_MAX_TASKS) {
+                    error = config_error(path, line, "too many tasks at", value);
+                    break;
+                }
+                task = &system->tasks[system->num_tasks++];
+                task->priority = -1;
+                if (set_name(task->name, value)) error = config_error(path, line, "name too long", value);
+            }
+
+            char * attribute;
+            while (!error && (attribute = strtok(NULL, " \t\r\n"))) {
+                char * equals = strchr(attribute, '=');
+                if (!equals) {
+                    error = config_error(path, line, "expected key=value, got", attribute);
+                    break;
+                }
+                *equals = '\0';
+                int result = is_cpi ? parse_cpi_attribute(cpi, attribute, equals + 1)
+                                    : parse_task_attribute(task, attribute, equals + 1);
+                if (result) {
+                    *equals = '=';
+                    error = config_error(path, line, "invalid attribute", attribute);
+                }
+            }
+        }
+        else {
+            error = config_error(path, line, "unknown declaration", keyword);
+        }
+    }
+
+    fclose(file);
+
+    if (!error) {
+        error = task_system_resolve(system);
+    }
+
+    return error;
+}
+
+
+/*
+    Simulated threads
+*/
+
+/*
+    Send a request to a CPI, as the prioritized from-template does:
+    the request carries the sender's effective priority,
+    falling back to the component's priority if the sender never set one
+*/
+static void cpi_request(struct Sim_CPI * cpi, int default_priority) {
+    int priority = get_effective_priority();
+    if (priority == PRIORITY_CONTEXT_UNSET) {
+        priority = default_priority;
+    }
+
+    struct Sim_Message msg = {
+        .priority = priority,
+        .origin = sim_self()->origin
+    };
+    sim_call(&cpi->ep, &msg);
+}
+
+//A CPI threadpool thread, following the receive loop of the to-template
+static void cpi_thread(struct Sim_Thread * thread) {
+
+    struct Sim_CPI * cpi = thread->arg;
+    struct Sim_Message msg;
+
+    for (;;) {
+        sim_recv(&cpi->ep, &msg);
+
+        //Work for this request is on behalf of the requesting task
+        thread->origin = msg.origin;
+        cpi->requests++;
+        if (++cpi->busy > cpi->max_busy) {
+            cpi->max_busy = cpi->busy;
+        }
+
+        priority_pre(msg.priority, &cpi->info);
+
+        sim_compute(sample(&cpi->pre));
+        if (cpi->call) {
+            cpi_request(cpi->call, cpi->priority);
+        }
+        sim_compute(sample(&cpi->post));
+
+        priority_post(&cpi->info);
+
+        cpi->busy--;
+        sim_reply(&msg);
+        thread->origin = -1;
+    }
+}
+
+//A task's control thread, executing one job per release
+static void task_thread(struct Sim_Thread * thread) {
+
+    struct Sim_Task * task = thread->arg;
+
+    for (;;) {
+
+        //Wait for a release
+        while (task->completed == task->released) {
+            task->waiting = true;
+            sim_block();
+        }
+
+        thread->origin = (int) (task - simulated->tasks);
+
+        sim_compute(sample(&task->pre));
+        if (task->call) {
+            cpi_request(task->call, task->priority);
+        }
+        sim_compute(sample(&task->post));
+
+        thread->origin = -1;
+
+        //Record the job
+        sim_time_t release = task->offset + (sim_time_t) task->completed * task->period;
+        sim_time_t response = sim_now() - release;
+        if (response > task->deadline) {
+            task->misses++;
+        }
+
+        if (task->num_responses == task->responses_size) {
+            task->responses_size = task->responses_size ? task->responses_size * 2 : 1024;
+            task->responses = realloc(task->responses, task->responses_size * sizeof(*task->responses));
+            if (!task->responses) {
+                fprintf(stderr, "simulator: out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        task->responses[task->num_responses++] = response;
+
+        task->total_blocking += task->job_blocking;
+        if (task->job_blocking > task->max_blocking) {
+            task->max_blocking = task->job_blocking;
+        }
+        task->job_blocking = 0;
+
+        task->completed++;
+    }
+}
+
+//Periodic job release, as dispatched by the TimeServer
+static void task_release(void * arg, sim_time_t time) {
+    struct Sim_Task * task = arg;
+
+    task->released++;
+    if (task->waiting) {
+        task->waiting = false;
+        sim_wake(task->thread);
+    }
+
+    sim_schedule_event(time + task->period, task_release, task);
+}
+
+/*
+    Blocking accounting.
+    Time the processor spends on behalf of a task is blocking
+    for every pending job of a higher-priority task.
+*/
+static void task_system_account(struct Sim_Thread * thread, sim_time_t start, sim_time_t end) {
+
+    if (thread->origin < 0) return;
+
+    int priority = simulated->tasks[thread->origin].priority;
+    for (unsigned i = 0; i < simulated->num_tasks; i++) {
+        struct Sim_Task * task = &simulated->tasks[i];
+        if (task->priority > priority && task->released > task->completed) {
+            task->job_blocking += end - start;
+        }
+    }
+}
+
+
+/*
+    Simulation
+*/
+
+//Set up a CPI as the to-template's __init function does
+static void cpi_init(struct Sim_CPI * cpi) {
+
+    priority_protocol_init(&cpi->info, cpi->protocol, cpi->priority);
+
+    if (cpi->protocol == threshold) {
+        priority_threshold_init(&cpi->info, cpi->threshold);
+    }
+
+    if (cpi->protocol == inherited) {
+        priority_inheritance_init(&cpi->info, &cpi->lock, cpi->num_threads);
+
+        cpi->ntfn_nodes = calloc(cpi->num_threads, sizeof(*cpi->ntfn_nodes));
+        cpi->prio_queue = calloc(cpi->num_threads, sizeof(*cpi->prio_queue));
+        cpi->ntfn_objs = calloc(cpi->num_threads, sizeof(*cpi->ntfn_objs));
+        if (!cpi->ntfn_nodes || !cpi->prio_queue || !cpi->ntfn_objs) {
+            fprintf(stderr, "simulator: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+
+        for (unsigned i = 0; i < cpi->num_threads; i++) {
+            cpi->ntfn_objs[i] = sim_notification_create();
+        }
+        ntfn_mgr_init(&cpi->lock.ntfn_mgr, cpi->ntfn_nodes, cpi->prio_queue,
+                cpi->ntfn_objs, cpi->num_threads);
+    }
+
+    for (unsigned i = 0; i < cpi->num_threads; i++) {
+        sim_thread_create(cpi->name, cpi->priority, cpi_thread, cpi);
+    }
+}
+
+static void cpi_free(struct Sim_CPI * cpi) {
+    free(cpi->ntfn_nodes);
+    free(cpi->prio_queue);
+    free(cpi->ntfn_objs);
+    cpi->ntfn_nodes = NULL;
+    cpi->prio_queue = NULL;
+    cpi->ntfn_objs = NULL;
+}
+
+void task_system_run(struct Task_System * s) {
+
+    simulated = s;
+    rng = s->seed;
+
+    sim_init(s->horizon, s->syscall_cost, task_system_account);
+
+    //Threadpool threads are created first, so they are waiting on their endpoints before any requests
+    for (unsigned i = 0; i < s->num_cpis; i++) {
+        cpi_init(&s->cpis[i]);
+    }
+
+    for (unsigned i = 0; i < s->num_tasks; i++) {
+        struct Sim_Task * task = &s->tasks[i];
+        task->thread = sim_thread_create(task->name, task->priority, task_thread, task);
+        sim_schedule_event(task->offset, task_release, task);
+    }
+
+    sim_run();
+
+    //Jobs still pending at the horizon have missed their deadlines if those have passed
+    for (unsigned i = 0; i < s->num_tasks; i++) {
+        struct Sim_Task * task = &s->tasks[i];
+        for (unsigned long long n = task->completed; n < task->released; n++) {
+            if (task->offset + (sim_time_t) n * task->period + task->deadline <= s->horizon) {
+                task->misses++;
+            }
+        }
+    }
+
+    sim_destroy();
+
+    for (unsigned i = 0; i < s->num_cpis; i++) {
+        cpi_free(&s->cpis[i]);
+    }
+
+    simulated = NULL;
+}
+
+
+/*
+    Reporting
+*/
+
+static int compare_times(const void * lhs, const void * rhs) {
+    sim_time_t l = *(const sim_time_t *) lhs;
+    sim_time_t r = *(const sim_time_t *) rhs;
+    return (l > r) - (l < r);
+}
+
+//Nearest-rank percentile of sorted response times
+static sim_time_t percentile(struct Sim_Task * task, unsigned p) {
+    if (!task->num_responses) return 0;
+    unsigned long long rank = (task->num_responses * p + 99) / 100;
+    if (rank == 0) rank = 1;
+    return task->responses[rank - 1];
+}
+
+static double to_us(sim_time_t time) {
+    return (double) time / SIM_US;
+}
+
+void task_system_csv_header(FILE * out) {
+    fprintf(out, "system,task,priority,period_ms,jobs,misses,"
+            "resp_min_us,resp_mean_us,resp_p50_us,resp_p99_us,resp_max_us,"
+            "block_mean_us,block_max_us\n");
+}
+
+void task_system_report(struct Task_System * s, FILE * out, bool csv) {
+
+    if (!csv) {
+        fprintf(out, "%s: horizon %.3f s\n\n", s->path, (double) s->horizon / (1000 * SIM_MS));
+        fprintf(out, "%-12s %5s %10s %9s %7s %12s %12s %12s %12s %12s %13s %12s\n",
+                "task", "prio", "period_ms", "jobs", "misses",
+                "resp_min_us", "resp_mean_us", "resp_p50_us", "resp_p99_us", "resp_max_us",
+                "block_mean_us", "block_max_us");
+    }
+
+    for (unsigned i = 0; i < s->num_tasks; i++) {
+        struct Sim_Task * task = &s->tasks[i];
+
+        qsort(task->responses, task->num_responses, sizeof(*task->responses), compare_times);
+
+        sim_time_t total = 0;
+        for (unsigned long long n = 0; n < task->num_responses; n++) {
+            total += task->responses[n];
+        }
+
+        unsigned long long jobs = task->num_responses;
+        double mean = jobs ? to_us(total) / jobs : 0;
+        double block_mean = jobs ? to_us(task->total_blocking) / jobs : 0;
+        double min = jobs ? to_us(task->responses[0]) : 0;
+        double max = jobs ? to_us(task->responses[jobs - 1]) : 0;
+
+        if (csv) {
+            fprintf(out, "%s,", s->path);
+        }
+        fprintf(out, csv ? "%s,%d,%.3f,%llu,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n"
+                         : "%-12s %5d %10.3f %9llu %7llu %12.3f %12.3f %12.3f %12.3f %12.3f %13.3f %12.3f\n",
+                task->name, task->priority, (double) task->period / SIM_MS,
+                jobs, task->misses,
+                min, mean, to_us(percentile(task, 50)), to_us(percentile(task, 99)), max,
+                block_mean, to_us(task->max_blocking));
+    }
+
+    if (csv) return;
+
+    fprintf(out, "\n%-12s %10s %5s %7s %12s %9s %11s\n",
+            "cpi", "protocol", "prio", "threads", "requests", "max_busy", "max_queued");
+    for (unsigned i = 0; i < s->num_cpis; i++) {
+        struct Sim_CPI * cpi = &s->cpis[i];
+        fprintf(out, "%-12s %10s %5d %7u %12llu %9u %11u\n",
+                cpi->name, protocol_name(cpi->protocol), cpi->priority, cpi->num_threads,
+                cpi->requests, cpi->max_busy, cpi->ep.max_senders);
+    }
+    fprintf(out, "\n");
+}
+
+void task_system_free(struct Task_System * s) {
+    for (unsigned i = 0; i < s->num_tasks; i++) {
+        free(s->tasks[i].responses);
+        s->tasks[i].responses = NULL;
+    }
+}
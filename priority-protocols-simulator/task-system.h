@@ -0,0 +1,139 @@
+/*
+
+    task-system.h
+
+    A model of a CAmkES task system, as described by task-system.camkes in the sample application,
+    simulated with the discrete-event simulator of simulator.h.
+
+    A task system consists of:
+
+        * Periodic tasks, each with a priority, a period, and an implicit deadline.
+          Each job executes for some time, optionally sends one request to a CPI,
+          then executes for some more time.
+
+        * CPIs, each with a priority protocol, a priority, and a threadpool size.
+          Each request executes for some time, optionally sends a nested request to another CPI,
+          then executes for some more time.
+
+    CPI threadpool threads follow the receive loop of rpc-priority-connector-common-to.c,
+    calling priority_pre and priority_post from the priority protocols library,
+    and requests carry their priority as the prioritized from-template does.
+
+    For each task, the simulation records the response time of every job,
+    deadline misses, and the blocking each job observed:
+    time during which the processor executed work on behalf of a lower-priority task
+    while the job was pending.
+
+    Task systems are read from a configuration file; the format is documented in task-system.c,
+    and task-system.sim describes the sample application.
+
+*/
+
+#pragma once
+
+#include "simulator.h"
+#include "../priority-protocols/priority-protocols.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define TASK_SYSTEM_NAME_SIZE 32
+#define TASK_SYSTEM_MAX_TASKS 64
+#define TASK_SYSTEM_MAX_CPIS 64
+
+//An execution time, drawn uniformly from [min, max]
+struct Sim_Range {
+    sim_time_t min;
+    sim_time_t max;
+};
+
+struct Sim_CPI {
+
+    //Configuration
+    char name[TASK_SYSTEM_NAME_SIZE];
+    int protocol;
+    int priority;
+    int threshold;
+    unsigned num_threads;
+    struct Sim_Range pre;
+    struct Sim_Range post;
+    char call_name[TASK_SYSTEM_NAME_SIZE];
+    struct Sim_CPI * call;
+
+    //Priority protocol state, as set up by the to-template's __init function
+    struct Priority_Protocol info;
+    struct Priority_Inheritance lock;
+    struct Notification_Node * ntfn_nodes;
+    struct Notification_Node ** prio_queue;
+    seL4_CPtr * ntfn_objs;
+
+    struct Sim_Endpoint ep;
+
+    //Statistics
+    unsigned long long requests;
+    unsigned busy;
+    unsigned max_busy;
+
+};
+
+struct Sim_Task {
+
+    //Configuration
+    char name[TASK_SYSTEM_NAME_SIZE];
+    int priority;
+    sim_time_t period;
+    sim_time_t deadline;
+    sim_time_t offset;
+    struct Sim_Range pre;
+    struct Sim_Range post;
+    char call_name[TASK_SYSTEM_NAME_SIZE];
+    struct Sim_CPI * call;
+
+    struct Sim_Thread * thread;
+    bool waiting;
+
+    //Jobs are released periodically, so job n is released at offset + n * period
+    unsigned long long released;
+    unsigned long long completed;
+
+    //Blocking observed by the oldest pending job
+    sim_time_t job_blocking;
+
+    //Statistics
+    unsigned long long misses;
+    sim_time_t * responses;
+    unsigned long long num_responses;
+    unsigned long long responses_size;
+    sim_time_t max_blocking;
+    sim_time_t total_blocking;
+
+};
+
+struct Task_System {
+
+    const char * path;
+
+    sim_time_t horizon;
+    sim_time_t syscall_cost;
+    uint64_t seed;
+
+    struct Sim_Task tasks[TASK_SYSTEM_MAX_TASKS];
+    unsigned num_tasks;
+
+    struct Sim_CPI cpis[TASK_SYSTEM_MAX_CPIS];
+    unsigned num_cpis;
+
+};
+
+//Read a task system from a configuration file, returns 0 on success
+int task_system_load(struct Task_System * system, const char * path);
+
+//Simulate a task system to its horizon
+void task_system_run(struct Task_System * system);
+
+//Report the results of a simulated task system, as a table or as CSV
+void task_system_report(struct Task_System * system, FILE * out, bool csv);
+void task_system_csv_header(FILE * out);
+
+//Free the results of a simulated task system
+void task_system_free(struct Task_System * system);
@@ -53,10 +53,389 @@
 #define rpc_token(num_threads) seL4RPCCallPrioritized##num_threads
 #define rpc(num_threads) rpc_token(num_threads)
 
+/*
+    Likewise for the prioritized event connectors (see priority-events.h).
+    A consuming interface takes the same attributes as a procedure interface:
+
+    component Filter {
+        consumes Sample sensor;
+        interface_priority_attributes(sensor)
+    }
+
+    connection prioritized_event(2) conn_sensor(from t1.sensor, from t2.sensor, to filter.sensor);
+*/
+#define prioritized_event_token(num_threads) seL4NotificationPrioritized##num_threads
+#define prioritized_event(num_threads) prioritized_event_token(num_threads)
+
+/*
+    Likewise for the priority ring connectors (see priority-ring.h),
+    which share a dataport between producers and a consuming threadpool.
+    The consuming interface takes the ring's ceiling and threadpool size,
+    and optionally the number and size (in bytes) of the ring's slots:
+
+    component Logger {
+        dataport Buf(65536) records;
+        interface_ring_attributes(records)
+    }
+
+    logger.records_priority = 41;
+    logger.records_num_threads = 2;
+    logger.records_ring_slots = 32;
+    logger.records_ring_slot_size = 1024;
+
+    connection priority_ring(2) conn_records(from t1.records, from t2.records, to logger.records);
+*/
+#define priority_ring_token(num_threads) seL4PriorityRing##num_threads
+#define priority_ring(num_threads) priority_ring_token(num_threads)
+
+/*
+    Likewise for the routed RPC connectors (see replica-routing.h),
+    which route requests across replicas of a stateless CPI, each with a threadpool of the given size.
+    Each replica takes the same attributes as any other CPI:
+
+    connection routed_rpc(2) conn_a(from t1.a, from t2.a, to service1.a, to service2.a);
+    conn_a.routing_priority = 30;
+*/
+#define routed_rpc_token(num_threads) seL4RPCCallPrioritizedRouted##num_threads
+#define routed_rpc(num_threads) routed_rpc_token(num_threads)
+
+#define interface_ring_attributes(name) \
+    attribute int name##_num_threads; \
+    attribute int name##_priority; \
+    attribute int name##_ring_slots; \
+    attribute int name##_ring_slot_size;
+
 #define interface_priority_attributes(name) \
     attribute int name##_num_threads; \
     attribute int name##_priority; \
     attribute string name##_priority_protocol;
 
+/*
+    Attribute giving the preemption threshold of a CPI using the "threshold" protocol,
+    between the priorities of its requests and its ceiling:
+
+    service1.a_priority_protocol = "threshold";
+    service1.a_priority = 41;
+    service1.a_threshold = 35;
+*/
+#define interface_threshold_attributes(name) \
+    attribute int name##_threshold;
+
+/*
+    Optional attributes to split the lock of a PIP interface into independent domains.
+    Methods are mapped to the domains they use (acquired in ascending order),
+    or use the domain given by an integer key argument, modulo the number of domains;
+    any other method uses every domain:
+
+    component Registry {
+        provides Devices d;
+        interface_priority_attributes(d)
+        interface_lock_domain_attributes(d)
+    }
+
+    registry.d_lock_domains = 4;
+    registry.d_method_domains = "list:0+1+2+3";
+    registry.d_lock_key = "device";
+*/
+#define interface_lock_domain_attributes(name) \
+    attribute int name##_lock_domains; \
+    attribute string name##_method_domains; \
+    attribute string name##_lock_key;
+
+/*
+    Optional component attribute to draw the waiters of all of a component's PIP interfaces
+    from one pool of notification objects (see notification-manager.h),
+    sized by the threads of all of them, minus one,
+    rather than a notification object per thread of each interface:
+
+    component Registry {
+        provides Devices d;
+        provides Names n;
+        interface_priority_attributes(d)
+        interface_priority_attributes(n)
+        component_notification_pool_attributes()
+    }
+
+    registry.notification_pool = 1;
+*/
+#define component_notification_pool_attributes() \
+    attribute int notification_pool;
+
+/*
+    Optional attributes to cache the replies of pure methods of a CPI,
+    i.e., methods whose results depend only on their inputs:
+
+    component Service {
+        provides CPIA a;
+        interface_priority_attributes(a)
+        interface_memo_attributes(a)
+    }
+
+    service1.a_pure_methods = "pow,sqrt";
+    service1.a_memo_entries = 16;
+*/
+#define interface_memo_attributes(name) \
+    attribute string name##_pure_methods; \
+    attribute int name##_memo_entries;
+
+/*
+    Optional attribute to coalesce identical concurrent requests to idempotent methods of a PIP CPI,
+    i.e., methods for which one request's reply may be sent to every identical request in progress:
+
+    component Service {
+        provides CPIA a;
+        interface_priority_attributes(a)
+        interface_coalescing_attributes(a)
+    }
+
+    service1.a_idempotent_methods = "lookup";
+*/
+#define interface_coalescing_attributes(name) \
+    attribute string name##_idempotent_methods;
+
+/*
+    Optional attributes for per-client admission control on a CPI.
+    Times are in microseconds; a limit of 0 is disabled.
+    The policy is either "reject" (the default) or "background".
+
+    component Service {
+        provides CPIA a;
+        interface_priority_attributes(a)
+        interface_admission_attributes(a)
+    }
+
+    service1.a_admission_budget_us = 500;
+    service1.a_admission_period_us = 10000;
+    service1.a_admission_policy = "background";
+    service1.a_admission_background_priority = 2;
+
+    The limits can be overridden for a single client on its uses interface:
+
+    component Task {
+        uses CPIA a;
+        client_admission_attributes(a)
+    }
+
+    task1.a_admission_min_interarrival_us = 1000;
+*/
+#define interface_admission_attributes(name) \
+    attribute int name##_admission_min_interarrival_us; \
+    attribute int name##_admission_budget_us; \
+    attribute int name##_admission_period_us; \
+    attribute string name##_admission_policy; \
+    attribute int name##_admission_background_priority;
+
+#define client_admission_attributes(name) \
+    attribute int name##_admission_min_interarrival_us; \
+    attribute int name##_admission_budget_us; \
+    attribute int name##_admission_period_us;
+
+/*
+    Optional attribute to handle a CPI's requests with continuations (see continuations.h),
+    giving the number of requests that may be in flight at once.
+    The threadpool then consists of a receiver thread and NAME_num_threads - 1 workers:
+
+    component Service {
+        provides CPIA a;
+        interface_priority_attributes(a)
+        interface_continuation_attributes(a)
+    }
+
+    #define service1_a_num_threads 3
+    service1.a_num_threads = service1_a_num_threads;
+    service1.a_continuations = 32;
+*/
+#define interface_continuation_attributes(name) \
+    attribute int name##_continuations;
+
+/*
+    Optional attributes for futures (see priority-futures.h), letting a CPI's threads
+    make nested requests in parallel.
+    A uses interface declaring client_future_attributes() gains non-blocking variants of its methods,
+    whose calls are made by workers taken from the threadpool of a CPI
+    declaring interface_future_attributes():
+
+    component ServiceAggregator {
+        provides CPIA a;
+        uses CPIB b;
+        uses CPIC c;
+        interface_priority_attributes(a)
+        interface_future_attributes(a)
+        client_future_attributes(b)
+        client_future_attributes(c)
+    }
+
+    #define aggregator_a_num_threads 4
+    aggregator.a_num_threads = aggregator_a_num_threads;
+    aggregator.a_future_workers = 2;
+    aggregator.b_futures = 1;
+    aggregator.c_futures = 1;
+*/
+#define interface_future_attributes(name) \
+    attribute int name##_future_workers;
+
+#define client_future_attributes(name) \
+    attribute int name##_futures;
+
+/*
+    Optional attribute giving a CPI's ceiling in each of the system's operating modes,
+    switched at runtime by calling NAME_set_mode(mode) from any thread of the component:
+
+    component Service {
+        provides CPIA a;
+        interface_priority_attributes(a)
+        interface_mode_attributes(a)
+    }
+
+    service1.a_priority = 41;
+    service1.a_mode_ceilings = "41,31";
+*/
+#define interface_mode_attributes(name) \
+    attribute string name##_mode_ceilings;
+
+/*
+    Attributes of a periodic task released by a ReleaseServer component
+    (see priority-release-server) over the seL4PriorityRelease connector.
+    Times are in microseconds; the offset of the first release defaults to 0:
+
+    component Task {
+        control;
+        consumes Release release;
+        task_priority_attributes()
+        release_attributes(release)
+    }
+
+    t1.release_period_us = 100000;
+    t1.release_offset_us = 2000;
+*/
+#define release_attributes(name) \
+    attribute int name##_period_us; \
+    attribute int name##_offset_us;
+
+/*
+    Optional attribute to monitor the blocking and priority inversions
+    observed by a CPI's requests at runtime (see inversion-monitor.h),
+    reported by NAME_report_stats():
+
+    component Service {
+        provides CPIA a;
+        interface_priority_attributes(a)
+        interface_inversion_attributes(a)
+    }
+
+    service1.a_inversion_monitor = 1;
+*/
+#define interface_inversion_attributes(name) \
+    attribute int name##_inversion_monitor;
+
+/*
+    Optional attribute to measure the stack high-water marks of a CPI's threadpool threads
+    by stack painting (see stack-watermark.h), reported by NAME_report_stats()
+    with the CPI's other sizing figures:
+
+    component Service {
+        provides CPIA a;
+        interface_priority_attributes(a)
+        interface_sizing_attributes(a)
+    }
+
+    service1.a_stack_watermarks = 1;
+*/
+#define interface_sizing_attributes(name) \
+    attribute int name##_stack_watermarks;
+
+/*
+    Optional attribute to account for the CPU time consumed by a CPI's requests,
+    per threadpool thread, client and request priority (see utilisation-accounting.h),
+    reported by NAME_report_stats(). Requires a kernel built with CONFIG_BENCHMARK_TRACK_UTILISATION:
+
+    component Service {
+        provides CPIA a;
+        interface_priority_attributes(a)
+        interface_utilisation_attributes(a)
+    }
+
+    service1.a_utilisation_accounting = 1;
+*/
+#define interface_utilisation_attributes(name) \
+    attribute int name##_utilisation_accounting;
+
+/*
+    Optional attribute to capture a CPI's requests for offline replay (see request-capture.h),
+    naming a dataport of the component to hold the captured requests:
+
+    component Service {
+        provides CPIA a;
+        interface_priority_attributes(a)
+        interface_capture_attributes(a)
+        dataport Buf(1048576) a_requests;
+    }
+
+    service1.a_capture_dataport = "a_requests";
+*/
+#define interface_capture_attributes(name) \
+    attribute string name##_capture_dataport;
+
+/*
+    Dataport of a component's deferred log (see priority-log.h),
+    shared with a PriorityLogger component (see priority-logger).
+    The size must match PRIORITY_LOG_SIZE as seen by the component's C code:
+
+    component Service {
+        provides CPIA a;
+        interface_priority_attributes(a)
+        priority_log_dataport(trace)
+    }
+
+    connection seL4SharedData conn_trace(from task1.trace, from service1.trace, to logger.trace);
+*/
+#ifndef PRIORITY_LOG_SIZE
+#define PRIORITY_LOG_SIZE 65536
+#endif
+
+#define priority_log_dataport(name) \
+    dataport Buf(PRIORITY_LOG_SIZE) name;
+
+/*
+    Optional attribute giving the frequency of the cycle counter,
+    used by features that take timestamps (e.g., admission control)
+*/
+#define clock_attributes() \
+    attribute int clock_cycles_per_us;
+
+/*
+    Priority-aware synchronization objects shared by the threads of a single component
+    (see priority-sync.h), declared by name within a component specification:
+
+    component Worker {
+        control;
+        provides Work w;
+        priority_pip_mutex(table_lock)
+        priority_semaphore(items)
+    }
+
+    Each object has a ceiling (the highest priority of any thread that uses it, plus one),
+    and a maximum number of waiters (at most the number of threads that use it, minus one):
+
+    worker.table_lock_ceiling = 41;
+    worker.table_lock_max_waiters = 2;
+    worker.items_ceiling = 41;
+    worker.items_max_waiters = 1;
+    worker.items_count = 0;
+
+    The objects are created by the priority-sync.template.c component template.
+*/
+#define priority_sync_object(name, type) \
+    attribute string name##_sync_type = type; \
+    attribute int name##_ceiling; \
+    attribute int name##_max_waiters;
+
+#define priority_pip_mutex(name) priority_sync_object(name, "pip_mutex")
+#define priority_ipcp_mutex(name) priority_sync_object(name, "ipcp_mutex")
+#define priority_condition(name) priority_sync_object(name, "condition")
+#define priority_semaphore(name) \
+    priority_sync_object(name, "semaphore") \
+    attribute int name##_count;
+
 #define task_priority_attributes() \
     attribute int _priority;
\ No newline at end of file
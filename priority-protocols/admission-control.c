@@ -0,0 +1,171 @@
+/*
+
+    admission-control.c
+
+    The implementation of per-client admission control.
+    See admission-control.h for more details.
+
+*/
+
+#include "admission-control.h"
+#include "priority-stats.h"
+#include "priority-clock.h"
+
+#include <camkes.h>
+
+#ifdef CONFIG_BENCHMARK_TRACK_UTILISATION
+#include <camkes/tls.h>
+#include <sel4/benchmark_utilisation_types.h>
+#include <string.h>
+
+//Words of the IPC buffer the kernel overwrites with a thread's utilisation
+#define ADMISSION_UTILISATION_IPC_WORDS \
+    ((BENCHMARK_TCB_NUMBER_KERNEL_ENTRIES + 1) * sizeof(uint64_t) / sizeof(seL4_Word))
+#endif
+
+//Initialize an Admission_Control structure over a statically-assigned array of clients
+void admission_control_init(struct Admission_Control * admission, struct Admission_Client * clients,
+        unsigned num_clients, int policy, int background_priority) {
+
+    //Only run on first thread
+    if(!admission->initialized) {
+
+        admission->initialized = true;
+
+        admission->policy = policy;
+        admission->background_priority = background_priority;
+        admission->clients = clients;
+        admission->num_clients = num_clients;
+
+        //Convert limits to cycles, and start each client with a full budget
+        for (unsigned i = 0; i < num_clients; i++) {
+            struct Admission_Client * c = &clients[i];
+            c->min_interarrival = priority_clock_us_to_cycles(c->min_interarrival_us);
+            c->budget = (int64_t) priority_clock_us_to_cycles(c->budget_us);
+            c->period = priority_clock_us_to_cycles(c->period_us);
+            c->remaining = c->budget;
+            c->arrived = false;
+            c->replenishment_head = 0;
+            c->num_replenishments = 0;
+        }
+
+#ifdef CONFIG_BENCHMARK_TRACK_UTILISATION
+        //Budgets are charged the cycles counted by the kernel, which only counts once enabled
+        for (unsigned i = 0; i < num_clients; i++) {
+            if (clients[i].budget) {
+                seL4_BenchmarkResetLog();
+                break;
+            }
+        }
+#endif
+    }
+}
+
+//Apply all replenishments that are due
+static void admission_replenish(struct Admission_Client * c, uint64_t now) {
+    while (c->num_replenishments) {
+        struct Admission_Replenishment * r = &c->replenishments[c->replenishment_head];
+        if (r->time > now) return;
+
+        c->remaining += r->amount;
+
+        c->replenishment_head = (c->replenishment_head + 1) % ADMISSION_MAX_REPLENISHMENTS;
+        c->num_replenishments--;
+    }
+}
+
+//Check whether a request from a client arriving at a given time is admitted
+int admission_check(struct Admission_Control * admission, unsigned client, uint64_t arrival) {
+
+    struct Admission_Client * c = &admission->clients[client];
+    bool excess = false;
+
+    //Minimum inter-arrival time
+    if (c->min_interarrival && c->arrived &&
+            arrival - c->last_arrival < c->min_interarrival) {
+        excess = true;
+    }
+
+    //Sporadic-server budget
+    if (c->budget) {
+        admission_replenish(c, arrival);
+        if (c->remaining <= 0) {
+            excess = true;
+        }
+    }
+
+    if (!excess) {
+        c->arrived = true;
+        c->last_arrival = arrival;
+        c->admitted++;
+        return admission_admit;
+    }
+
+    if (admission->policy == admission_background) {
+        c->deferred++;
+        return admission_defer;
+    }
+
+    c->rejected++;
+    return admission_refuse;
+}
+
+//Charge the time consumed by an admitted request to its client's budget
+void admission_charge(struct Admission_Control * admission, unsigned client,
+        uint64_t arrival, uint64_t consumed) {
+
+    struct Admission_Client * c = &admission->clients[client];
+
+    if (!c->budget || !consumed) return;
+
+    c->remaining -= (int64_t) consumed;
+
+    //Consumed time is replenished one period after the request arrived
+    uint64_t time = arrival + c->period;
+
+    //If the queue is full, merge into the latest replenishment (delaying part of it)
+    if (c->num_replenishments == ADMISSION_MAX_REPLENISHMENTS) {
+        unsigned last = (c->replenishment_head + c->num_replenishments - 1) % ADMISSION_MAX_REPLENISHMENTS;
+        c->replenishments[last].amount += (int64_t) consumed;
+        if (c->replenishments[last].time < time) {
+            c->replenishments[last].time = time;
+        }
+        return;
+    }
+
+    unsigned tail = (c->replenishment_head + c->num_replenishments) % ADMISSION_MAX_REPLENISHMENTS;
+    c->replenishments[tail].time = time;
+    c->replenishments[tail].amount = (int64_t) consumed;
+    c->num_replenishments++;
+}
+
+//Report each client's statistics, named by the CPI and the client's badge
+void admission_report(struct Admission_Control * admission, const char * name) {
+    for (unsigned i = 0; i < admission->num_clients; i++) {
+        struct Admission_Client * client = &admission->clients[i];
+        PRIORITY_STATS_PRINT("admission", name, "badge=%lu,admitted=%llu,deferred=%llu,rejected=%llu",
+                (unsigned long) client->badge, client->admitted, client->deferred, client->rejected);
+    }
+}
+
+/*
+    CPU time consumed by the calling thread, in cycles.
+    The kernel returns it in the IPC buffer, which may hold a request still to be unmarshalled,
+    so the overwritten words are preserved.
+    Without utilisation tracking, wall-clock time is used instead.
+*/
+uint64_t admission_thread_cycles(void) {
+#ifdef CONFIG_BENCHMARK_TRACK_UTILISATION
+    seL4_Word saved[ADMISSION_UTILISATION_IPC_WORDS];
+    seL4_Word * msg = seL4_GetIPCBuffer()->msg;
+    memcpy(saved, msg, sizeof(saved));
+
+    seL4_BenchmarkGetThreadUtilisation(camkes_get_tls()->tcb_cap);
+    uint64_t cycles = ((uint64_t *) msg)[BENCHMARK_TCB_UTILISATION];
+
+    memcpy(msg, saved, sizeof(saved));
+    return cycles;
+#else
+    return priority_clock_cycles();
+#endif
+}
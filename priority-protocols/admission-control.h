@@ -0,0 +1,141 @@
+/*
+
+    admission-control.h
+
+    Per-client admission control for prioritized CPIs.
+
+    Any client of a CPI can otherwise flood it with requests,
+    and nothing bounds how much time a misbehaving client consumes
+    at the CPI's ceiling (or inherited) priority.
+    Admission control bounds each client (identified by its badge) independently,
+    so one noisy client cannot break the blocking bounds of the other tasks sharing the CPI.
+
+    Two limits are supported, each disabled if zero:
+
+        * A minimum inter-arrival time between admitted requests
+
+        * A sporadic-server budget:
+          each client may consume at most budget time in the CPI per period.
+          The CPU time consumed by an admitted request (from priority_pre to priority_post)
+          is charged against the client's budget,
+          and replenished one period after the request arrived.
+          A request arriving while the client's budget is exhausted is in excess.
+
+    On a kernel built with CONFIG_BENCHMARK_TRACK_UTILISATION,
+    the CPU time charged is read from the cycles the kernel counts for the threadpool thread
+    (see utilisation-accounting.h), so time the thread spends preempted or blocked is not charged.
+    Initialization then enables the kernel's utilisation tracking with seL4_BenchmarkResetLog,
+    which restarts the system-wide benchmark log for any other component reading it.
+    Otherwise, it is approximated by the wall-clock time from priority_pre to priority_post,
+    which also includes time the thread spends preempted, e.g., by other clients' requests
+    at a higher priority under the propagated and threshold protocols,
+    so a noisy client would exhaust a quiet client's budget.
+    The approximation is only valid under the fixed priority protocol,
+    where no other request of the CPI preempts the thread.
+
+    A request in excess of either limit is handled according to the interface's policy:
+
+        * admission_reject: the request is refused without entering the priority protocol.
+          The client receives an empty reply, which the sender's unmarshalling reports as an error
+          for any method with a return value or output parameters.
+
+        * admission_background: the request is deferred, by handling it at a background priority
+          instead of its request priority, so it only runs when no other work is pending.
+          Deferred requests are not charged against the budget they exceeded.
+          This would have no effect on CPIs with a fixed priority protocol,
+          so the connector template only allows admission_reject for them.
+
+    Admission is checked in the receive loop before priority_pre,
+    while the threadpool thread runs at the ceiling priority,
+    so (as for the Priority_Inheritance lock) the client state needs no atomic lock.
+
+    Timestamps are taken from the cycle counter (see priority-clock.h).
+*/
+
+#pragma once
+
+#include "priority-clock.h"
+
+#include <autoconf.h>
+#include <camkes.h>
+#include <stdint.h>
+
+//Maximum number of pending replenishments per client, later ones are merged
+#ifndef ADMISSION_MAX_REPLENISHMENTS
+#define ADMISSION_MAX_REPLENISHMENTS 8
+#endif
+
+//Policies for requests in excess of a client's limits
+enum admission_policies {
+    admission_reject,
+    admission_background
+};
+
+//Results of an admission check
+enum admission_decisions {
+    admission_admit,
+    admission_defer,
+    admission_refuse
+};
+
+struct Admission_Replenishment {
+    uint64_t time;
+    int64_t amount;
+};
+
+struct Admission_Client {
+
+    //Limits, in microseconds, assigned statically by the connector template
+    seL4_Word badge;
+    uint64_t min_interarrival_us;
+    uint64_t budget_us;
+    uint64_t period_us;
+
+    //Limits converted to cycles at initialization
+    uint64_t min_interarrival;
+    int64_t budget;
+    uint64_t period;
+
+    //Remaining budget, may be negative after an overrun
+    int64_t remaining;
+
+    //Arrival time of the last admitted request
+    bool arrived;
+    uint64_t last_arrival;
+
+    //Pending replenishments, in the order they were charged
+    struct Admission_Replenishment replenishments[ADMISSION_MAX_REPLENISHMENTS];
+    unsigned replenishment_head;
+    unsigned num_replenishments;
+
+    //Statistics
+    unsigned long long admitted;
+    unsigned long long deferred;
+    unsigned long long rejected;
+
+};
+
+struct Admission_Control {
+    bool initialized;
+    int policy;
+    int background_priority;
+    struct Admission_Client * clients;
+    unsigned num_clients;
+};
+
+//Initialize an Admission_Control structure over a statically-assigned array of clients
+void admission_control_init(struct Admission_Control * admission, struct Admission_Client * clients,
+        unsigned num_clients, int policy, int background_priority);
+
+//Check whether a request from a client arriving at a given time is admitted
+int admission_check(struct Admission_Control * admission, unsigned client, uint64_t arrival);
+
+//Charge the time consumed by an admitted request to its client's budget
+void admission_charge(struct Admission_Control * admission, unsigned client,
+        uint64_t arrival, uint64_t consumed);
+
+//CPU time consumed by the calling thread, in cycles, to measure the time charged to a request (see above)
+uint64_t admission_thread_cycles(void);
+
+//Report each client's statistics, in the format of priority-stats.h
+void admission_report(struct Admission_Control * admission, const char * name);
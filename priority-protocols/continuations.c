@@ -0,0 +1,185 @@
+/*
+
+    continuations.c
+
+    The implementation of continuations.
+    See continuations.h for more details.
+
+*/
+
+#include "continuations.h"
+#include "notification-manager.h"
+#include "priority-context.h"
+
+#include <camkes.h>
+#include <sel4utils/sel4_zf_logif.h>
+#include <string.h>
+#include <utils/util.h>
+
+void continuation_pool_init(struct Continuation_Pool * pool, struct Continuation * conts,
+        struct Continuation ** queue, struct Continuation ** free_stack, seL4_CPtr * reply_slots,
+        unsigned num_conts, seL4_CPtr cnode, seL4_CPtr receiver_ntfn, int ceiling) {
+
+    //Only run on first thread
+    if(!pool->initialized) {
+
+        pool->initialized = true;
+
+        pool->cnode = cnode;
+        pool->conts = conts;
+        pool->num_conts = num_conts;
+        pool->queue = queue;
+        pool->num_queued = 0;
+        pool->insert_order = 0;
+        pool->free_stack = free_stack;
+        pool->receiver_started = false;
+        pool->receiver_waiting = false;
+        pool->receiver_ntfn = receiver_ntfn;
+        pool->ceiling = ceiling;
+
+        //Each Continuation has its own slot for a reply capability, and starts free
+        for (unsigned i = 0; i < num_conts; i++) {
+            conts[i].reply = reply_slots[i];
+            free_stack[i] = &conts[i];
+        }
+        pool->num_free = num_conts;
+    }
+}
+
+/*
+    Threadpool threads start at the ceiling priority,
+    so the receiver is not chosen concurrently
+*/
+bool continuation_is_receiver(struct Continuation_Pool * pool) {
+    if (pool->receiver_started) return false;
+    pool->receiver_started = true;
+    return true;
+}
+
+
+/*
+    Priority queue of parked Continuations, implemented as a binary max-heap,
+    ordered by priority, with ties broken by earliest insertion
+*/
+
+static bool cont_greater_than(struct Continuation * lhs, struct Continuation * rhs) {
+    if (lhs->priority != rhs->priority) return lhs->priority > rhs->priority;
+    return lhs->insert_order < rhs->insert_order;
+}
+
+static void cont_insert(struct Continuation_Pool * pool, struct Continuation * cont) {
+    cont->insert_order = pool->insert_order++;
+    unsigned i = pool->num_queued++;
+    while (i > 0) {
+        unsigned parent = (i - 1) / 2;
+        if (!cont_greater_than(cont, pool->queue[parent])) break;
+        pool->queue[i] = pool->queue[parent];
+        i = parent;
+    }
+    pool->queue[i] = cont;
+}
+
+static struct Continuation * cont_remove_head(struct Continuation_Pool * pool) {
+    struct Continuation * head = pool->queue[0];
+    struct Continuation * last = pool->queue[--pool->num_queued];
+    unsigned i = 0;
+    while (2 * i + 1 < pool->num_queued) {
+        unsigned child = 2 * i + 1;
+        if (child + 1 < pool->num_queued && cont_greater_than(pool->queue[child + 1], pool->queue[child])) {
+            child++;
+        }
+        if (!cont_greater_than(pool->queue[child], last)) break;
+        pool->queue[i] = pool->queue[child];
+        i = child;
+    }
+    if (pool->num_queued) pool->queue[i] = last;
+    return head;
+}
+
+static void cont_free(struct Continuation_Pool * pool, struct Continuation * cont) {
+
+    pool->free_stack[pool->num_free++] = cont;
+
+    //Let the receiver accept its pending request
+    if (pool->receiver_waiting) {
+        pool->receiver_waiting = false;
+        seL4_Signal(pool->receiver_ntfn);
+    }
+}
+
+
+/*
+    Receiver
+*/
+
+/*
+    The receiver only receives while a Continuation is free,
+    so it never waits while holding a request it has yet to copy:
+    waiting on a notification overwrites the message registers in the IPC buffer
+*/
+void continuation_park(struct Continuation_Pool * pool, seL4_Word badge, void * buffer, unsigned size) {
+
+    struct Continuation * cont = pool->free_stack[--pool->num_free];
+
+    //Save the caller's reply capability, and the marshalled request
+    int error = seL4_CNode_SaveCaller(pool->cnode, cont->reply, CONFIG_WORD_SIZE);
+    ZF_LOGF_IFERR(error, "Failed to save reply capability.\n");
+
+    cont->badge = badge;
+    cont->size = MIN(size, (unsigned) sizeof(cont->msg));
+    memcpy(cont->msg, buffer, cont->size);
+
+    //The from-template sends the request priority first
+    cont->priority = (int) cont->msg[0];
+
+    cont_insert(pool, cont);
+
+    //Wake a waiting worker, if any
+    ntfn_mgr_signal_handoff(&pool->ntfn_mgr);
+
+    //If every Continuation is now in flight, stop receiving until a worker frees one
+    while (!pool->num_free) {
+        pool->receiver_waiting = true;
+        seL4_Wait(pool->receiver_ntfn, NULL);
+    }
+}
+
+
+/*
+    Workers
+*/
+
+struct Continuation * continuation_resume(struct Continuation_Pool * pool,
+        seL4_Word * badge, void * buffer, unsigned * size) {
+
+    /*
+        A worker finishing a request may resume a Continuation
+        before a woken worker runs, in which case the woken worker waits again
+    */
+    while (!pool->num_queued) {
+        ntfn_mgr_wait_handoff(pool->ceiling, &pool->ntfn_mgr);
+    }
+    struct Continuation * cont = cont_remove_head(pool);
+
+    *badge = cont->badge;
+    *size = cont->size;
+    memcpy(buffer, cont->msg, cont->size);
+
+    return cont;
+}
+
+void continuation_reply(struct Continuation_Pool * pool, struct Continuation * cont, unsigned length) {
+
+    //Sending on the saved reply capability consumes it
+    seL4_Send(cont->reply, seL4_MessageInfo_new(0, 0, 0, ROUND_UP_UNSAFE(length, sizeof(seL4_Word)) / sizeof(seL4_Word)));
+
+    cont_free(pool, cont);
+}
+
+void continuation_discard(struct Continuation_Pool * pool, struct Continuation * cont) {
+
+    int error = seL4_CNode_Delete(pool->cnode, cont->reply, CONFIG_WORD_SIZE);
+    ZF_LOGF_IFERR(error, "Failed to delete reply capability.\n");
+
+    cont_free(pool, cont);
+}
@@ -0,0 +1,127 @@
+/*
+
+    continuations.h
+
+    Continuations, for priority-ordered admission of the requests to a CPI.
+
+    Under the "propagated" and "inherited" protocols,
+    a CPI needs a threadpool thread for each request that may be in flight at once,
+    each with its own TCB, stack, IPC buffer, and (for PIP) notification object.
+    Clients beyond the threadpool's size queue on the endpoint in FIFO order.
+
+    With continuations, the threadpool instead consists of a receiver thread and a few worker threads.
+    The receiver waits on the endpoint at the CPI's ceiling priority.
+    For each request, it saves the client's reply capability to a CNode slot,
+    and the marshalled request (including its priority) to a free Continuation,
+    then parks the Continuation in a priority queue and returns to the endpoint.
+    Workers, waiting at the ceiling in a Notification Manager, resume parked Continuations
+    highest-priority first (ties broken by arrival),
+    handle them as any threadpool thread would, according to the CPI's priority protocol,
+    then reply through the saved reply capability.
+
+    A Continuation is a few hundred bytes and a CNode slot,
+    so requests that have not yet started are parked cheaply, and admitted in priority order,
+    rather than queueing on the endpoint in FIFO order.
+    A Continuation is captured before its request begins,
+    so a request that blocks (e.g., on a nested request, or the PIP lock) still holds a worker;
+    the number of workers bounds the number of requests executing at once,
+    and the number of Continuations the number in flight.
+    A CPI whose requests block therefore still needs a worker for each request blocked at once,
+    so continuations do not reduce its threads.
+    If every Continuation is in use, the receiver stops receiving,
+    and further clients queue on the endpoint as before.
+
+    As for the Notification Manager,
+    continuations are only manipulated by threads running at the CPI's ceiling,
+    so on a uniprocessor no atomic lock is needed.
+*/
+
+#pragma once
+
+#include "notification-manager.h"
+
+#include <camkes.h>
+#include <sel4/sel4.h>
+#include <stdint.h>
+
+struct Continuation {
+    int priority;
+    unsigned long long insert_order;
+    seL4_Word badge;
+    unsigned size;
+
+    //CNode slot holding the client's saved reply capability
+    seL4_CPtr reply;
+
+    //The marshalled request, including its priority
+    seL4_Word msg[seL4_MsgMaxLength];
+};
+
+struct Continuation_Pool {
+
+    bool initialized;
+
+    //This component's CNode, in which reply capabilities are saved
+    seL4_CPtr cnode;
+
+    //Array of Continuations, passed at initialization
+    struct Continuation * conts;
+    unsigned num_conts;
+
+    //Priority queue (a binary max-heap) of parked Continuations
+    struct Continuation ** queue;
+    unsigned num_queued;
+    unsigned long long insert_order;
+
+    //Stack of free Continuations
+    struct Continuation ** free_stack;
+    unsigned num_free;
+
+    //The receiver waits on its own notification object for a free Continuation
+    bool receiver_started;
+    bool receiver_waiting;
+    seL4_CPtr receiver_ntfn;
+
+    //Workers wait for a parked Continuation
+    struct Notification_Manager ntfn_mgr;
+    int ceiling;
+
+};
+
+/*
+    Continuation Pool Init
+
+    Allocates static memory for the Continuations, their priority queue and free stack.
+    Even though it's in the init function scope,
+    these arrays are accessible through the pointers in the Continuation_Pool object.
+    The Notification Manager for workers is initialized separately.
+*/
+#define CONTINUATION_POOL_INIT(CONTINUATION_POOL_PTR, NUM_CONTS, REPLY_SLOTS, CNODE, RECEIVER_NTFN, CEILING) \
+    static struct Continuation conts[NUM_CONTS]; \
+    static struct Continuation * cont_queue[NUM_CONTS]; \
+    static struct Continuation * cont_free_stack[NUM_CONTS]; \
+    continuation_pool_init(CONTINUATION_POOL_PTR, conts, cont_queue, cont_free_stack, \
+            REPLY_SLOTS, NUM_CONTS, CNODE, RECEIVER_NTFN, CEILING);
+
+void continuation_pool_init(struct Continuation_Pool * pool, struct Continuation * conts,
+        struct Continuation ** queue, struct Continuation ** free_stack, seL4_CPtr * reply_slots,
+        unsigned num_conts, seL4_CPtr cnode, seL4_CPtr receiver_ntfn, int ceiling);
+
+//Returns true for the first threadpool thread to start, which becomes the receiver
+bool continuation_is_receiver(struct Continuation_Pool * pool);
+
+//Receiver: park the request just received, with the caller's reply capability, then wait for a free Continuation
+void continuation_park(struct Continuation_Pool * pool, seL4_Word badge, void * buffer, unsigned size);
+
+/*
+    Worker: resume the highest-priority parked Continuation, waiting if there are none.
+    Copies its request to the buffer, and its size and badge to the given pointers.
+*/
+struct Continuation * continuation_resume(struct Continuation_Pool * pool,
+        seL4_Word * badge, void * buffer, unsigned * size);
+
+//Worker: reply through the Continuation's saved reply capability and free it
+void continuation_reply(struct Continuation_Pool * pool, struct Continuation * cont, unsigned length);
+
+//Worker: free a Continuation without replying
+void continuation_discard(struct Continuation_Pool * pool, struct Continuation * cont);
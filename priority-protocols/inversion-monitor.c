@@ -0,0 +1,161 @@
+/*
+
+    inversion-monitor.c
+
+    The implementation of the runtime blocking and priority inversion monitor.
+    See inversion-monitor.h for more details.
+
+*/
+
+#include "inversion-monitor.h"
+#include "priority-stats.h"
+
+#include <camkes.h>
+#include <string.h>
+#include <utils/util.h>
+
+
+//Histogram bucket of a number of cycles
+static unsigned bucket_of(uint64_t cycles) {
+
+    if (cycles < INVERSION_MONITOR_SUB_BUCKETS) {
+        return (unsigned) cycles;
+    }
+
+    unsigned msb = 63 - __builtin_clzll(cycles);
+    unsigned sub = (unsigned) (cycles >> (msb - 2)) & (INVERSION_MONITOR_SUB_BUCKETS - 1);
+    return (msb - 1) * INVERSION_MONITOR_SUB_BUCKETS + sub;
+}
+
+//Largest number of cycles in a histogram bucket
+static uint64_t bucket_limit(unsigned bucket) {
+
+    if (bucket < INVERSION_MONITOR_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    unsigned msb = bucket / INVERSION_MONITOR_SUB_BUCKETS + 1;
+    uint64_t sub = bucket % INVERSION_MONITOR_SUB_BUCKETS;
+    uint64_t lower = (INVERSION_MONITOR_SUB_BUCKETS | sub) << (msb - 2);
+    return lower + (1ull << (msb - 2)) - 1;
+}
+
+void inversion_monitor_init(struct Inversion_Monitor * monitor,
+        struct Inversion_Client * clients, unsigned num_clients, bool exclusive) {
+
+    memset(monitor, 0, sizeof(*monitor));
+
+    monitor->clients = clients;
+    monitor->num_clients = num_clients;
+    monitor->exclusive = exclusive;
+    monitor->last_client = INVERSION_MONITOR_NO_CLIENT;
+}
+
+unsigned inversion_monitor_client(struct Inversion_Monitor * monitor, seL4_Word badge) {
+    for (unsigned i = 0; i < monitor->num_clients; i++) {
+        if (monitor->clients[i].badge == badge) {
+            return i;
+        }
+    }
+    return INVERSION_MONITOR_NO_CLIENT;
+}
+
+void inversion_monitor_entered(struct Inversion_Monitor * monitor, struct Inversion_Timestamps * ts) {
+
+    ts->entered = priority_clock_cycles();
+    ts->blocker = INVERSION_MONITOR_NO_CLIENT;
+
+    if (!monitor->exclusive || monitor->last_client == INVERSION_MONITOR_NO_CLIENT) {
+        return;
+    }
+
+    //The request holds the CPI, so the last release is stable: was it while the request waited?
+    seL4_Word waited = (seL4_Word) ts->entered - ts->sent;
+    seL4_Word since_release = (seL4_Word) monitor->last_release - ts->sent;
+    if (since_release <= waited) {
+        ts->blocker = monitor->last_client;
+        ts->blocker_priority = monitor->last_priority;
+    }
+}
+
+void inversion_monitor_release(struct Inversion_Monitor * monitor, struct Inversion_Timestamps * ts) {
+    if (monitor->exclusive) {
+        monitor->last_client = ts->client;
+        monitor->last_priority = ts->priority;
+        monitor->last_release = priority_clock_cycles();
+    }
+}
+
+void inversion_monitor_record(struct Inversion_Monitor * monitor, struct Inversion_Timestamps * ts) {
+
+    uint64_t queue = (seL4_Word) ((seL4_Word) ts->received - ts->sent);
+    uint64_t ceiling = ts->entering - ts->received;
+    uint64_t lock = ts->entered - ts->entering;
+    uint64_t blocking = queue + ceiling + lock;
+
+    monitor->requests++;
+    monitor->max_queue = MAX(monitor->max_queue, queue);
+    monitor->max_ceiling = MAX(monitor->max_ceiling, ceiling);
+    monitor->max_lock = MAX(monitor->max_lock, lock);
+    monitor->max_blocking = MAX(monitor->max_blocking, blocking);
+    monitor->histogram[bucket_of(blocking)]++;
+
+    if (ts->client != INVERSION_MONITOR_NO_CLIENT) {
+        struct Inversion_Client * client = &monitor->clients[ts->client];
+        client->requests++;
+        client->max_blocking = MAX(client->max_blocking, blocking);
+    }
+
+    //Blocked by a lower-priority request: a priority inversion
+    if (ts->blocker != INVERSION_MONITOR_NO_CLIENT && ts->blocker_priority < ts->priority) {
+        struct Inversion_Client * blocker = &monitor->clients[ts->blocker];
+        monitor->inversions++;
+        monitor->max_inversion = MAX(monitor->max_inversion, blocking);
+        blocker->inversions_caused++;
+        blocker->max_inversion_caused = MAX(blocker->max_inversion_caused, blocking);
+    }
+}
+
+uint64_t inversion_monitor_percentile(struct Inversion_Monitor * monitor, unsigned per_mille) {
+
+    //Rank of the request at the percentile, rounded up
+    unsigned long long rank = (monitor->requests * per_mille + 999) / 1000;
+    unsigned long long seen = 0;
+
+    for (unsigned i = 0; i < INVERSION_MONITOR_BUCKETS; i++) {
+        seen += monitor->histogram[i];
+        if (seen && seen >= rank) {
+            return MIN(bucket_limit(i), monitor->max_blocking);
+        }
+    }
+
+    return 0;
+}
+
+void inversion_monitor_report(struct Inversion_Monitor * monitor, const char * name) {
+
+    PRIORITY_STATS_PRINT("inversion", name,
+            "requests=%llu,inversions=%llu,max_queue_cycles=%llu,max_ceiling_cycles=%llu,max_lock_cycles=%llu,"
+            "max_blocking_cycles=%llu,max_inversion_cycles=%llu,"
+            "p50_blocking_cycles=%llu,p90_blocking_cycles=%llu,p99_blocking_cycles=%llu,p999_blocking_cycles=%llu",
+            monitor->requests, monitor->inversions,
+            (unsigned long long) monitor->max_queue,
+            (unsigned long long) monitor->max_ceiling,
+            (unsigned long long) monitor->max_lock,
+            (unsigned long long) monitor->max_blocking,
+            (unsigned long long) monitor->max_inversion,
+            (unsigned long long) inversion_monitor_percentile(monitor, 500),
+            (unsigned long long) inversion_monitor_percentile(monitor, 900),
+            (unsigned long long) inversion_monitor_percentile(monitor, 990),
+            (unsigned long long) inversion_monitor_percentile(monitor, 999));
+
+    for (unsigned i = 0; i < monitor->num_clients; i++) {
+        struct Inversion_Client * client = &monitor->clients[i];
+        PRIORITY_STATS_PRINT("inversion", name,
+                "badge=%lu,requests=%llu,max_blocking_cycles=%llu,inversions_caused=%llu,max_inversion_caused_cycles=%llu",
+                (unsigned long) client->badge, client->requests,
+                (unsigned long long) client->max_blocking,
+                client->inversions_caused,
+                (unsigned long long) client->max_inversion_caused);
+    }
+}
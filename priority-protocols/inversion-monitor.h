@@ -0,0 +1,128 @@
+/*
+
+    inversion-monitor.h
+
+    A runtime monitor of the blocking observed by the requests of a prioritized CPI,
+    to check analytical blocking bounds against a running system.
+
+    Each request is timestamped with the cycle counter (see priority-clock.h):
+
+        * sent: by the client, before it sends the request
+          (the from-template adds the timestamp to the request after its priority)
+        * received: as the threadpool thread reads the request's priority, at the ceiling priority
+        * entering: before priority_pre
+        * entered: after priority_pre, once the request runs at its own priority
+
+    so that its blocking, from sent to entered, is split into:
+
+        * queue: time in the endpoint queue, while the threadpool was busy
+        * ceiling: time reading the request at the ceiling priority
+          (including admission control and the memo cache lookup)
+        * lock: time in priority_pre, waiting in ntfn_mgr_wait
+          while the lock holder runs at the inherited priority
+
+    For the lock-based protocols (inherited with a single lock domain, and fixed),
+    each request is also attributed to the blocking client:
+    the client whose request last left the CPI's critical section while the request waited.
+    A request blocked by a lower-priority client suffered a priority inversion,
+    charged to that client.
+
+    Timestamps are only comparable on a single core.
+    The client's timestamp is sent as a seL4_Word, so on 32-bit platforms
+    blocking is measured modulo 2^32 cycles.
+
+    Statistics are updated after priority_post, back at the ceiling priority,
+    so (as for the Priority_Inheritance lock) they need no atomic lock.
+    The last releasing client is updated before priority_post, in the critical section.
+*/
+
+#pragma once
+
+#include "priority-clock.h"
+
+#include <camkes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+//Blocking is recorded in a histogram of 4 buckets per power of two of cycles
+#define INVERSION_MONITOR_SUB_BUCKETS 4
+#define INVERSION_MONITOR_BUCKETS (64 * INVERSION_MONITOR_SUB_BUCKETS)
+
+//A request that no other request blocked, or from an unknown badge
+#define INVERSION_MONITOR_NO_CLIENT UINT_MAX
+
+struct Inversion_Client {
+
+    //Assigned statically by the connector template
+    seL4_Word badge;
+
+    //Requests from this client, and the worst blocking they observed
+    unsigned long long requests;
+    uint64_t max_blocking;
+
+    //Inversions this client caused to higher-priority requests, and the worst of them
+    unsigned long long inversions_caused;
+    uint64_t max_inversion_caused;
+};
+
+//Timestamps of a single request, kept by its threadpool thread
+struct Inversion_Timestamps {
+    seL4_Word sent;
+    uint64_t received;
+    uint64_t entering;
+    uint64_t entered;
+    unsigned client;
+    int priority;
+    unsigned blocker;
+    int blocker_priority;
+};
+
+struct Inversion_Monitor {
+
+    struct Inversion_Client * clients;
+    unsigned num_clients;
+
+    //Whether requests are mutually exclusive, so can be attributed to a blocking client
+    bool exclusive;
+
+    //The client whose request last left the critical section, at what priority, and when
+    unsigned last_client;
+    int last_priority;
+    uint64_t last_release;
+
+    //Statistics
+    unsigned long long requests;
+    unsigned long long inversions;
+    uint64_t max_queue;
+    uint64_t max_ceiling;
+    uint64_t max_lock;
+    uint64_t max_blocking;
+    uint64_t max_inversion;
+    unsigned long long histogram[INVERSION_MONITOR_BUCKETS];
+};
+
+//Initialize an Inversion_Monitor with its clients, in the order of the connection's from ends
+void inversion_monitor_init(struct Inversion_Monitor * monitor,
+        struct Inversion_Client * clients, unsigned num_clients, bool exclusive);
+
+//Index of the client with the given badge, or INVERSION_MONITOR_NO_CLIENT
+unsigned inversion_monitor_client(struct Inversion_Monitor * monitor, seL4_Word badge);
+
+//Timestamp a request once it has entered the priority protocol, and find its blocking client
+void inversion_monitor_entered(struct Inversion_Monitor * monitor, struct Inversion_Timestamps * ts);
+
+//Record that a request is leaving the critical section, before priority_post
+void inversion_monitor_release(struct Inversion_Monitor * monitor, struct Inversion_Timestamps * ts);
+
+//Record a request's blocking, after priority_post
+void inversion_monitor_record(struct Inversion_Monitor * monitor, struct Inversion_Timestamps * ts);
+
+/*
+    Blocking at the given percentile (e.g., 99.9 as 999 per mille) of all recorded requests,
+    as the upper bound of its histogram bucket
+*/
+uint64_t inversion_monitor_percentile(struct Inversion_Monitor * monitor, unsigned per_mille);
+
+//Report the monitor's statistics, and those of each client, in the format of priority-stats.h
+void inversion_monitor_report(struct Inversion_Monitor * monitor, const char * name);
@@ -0,0 +1,104 @@
+/*
+
+    memo-cache.c
+
+    The implementation of the result cache for pure CPI methods.
+    See memo-cache.h for more details.
+
+*/
+
+#include "memo-cache.h"
+#include "priority-stats.h"
+
+#include <camkes.h>
+#include <string.h>
+
+
+//Initialize a Memo_Cache
+void memo_cache_init(struct Memo_Cache * cache, struct Memo_Entry * entries, unsigned num_entries) {
+
+    //Only run on first thread
+    if(!cache->initialized) {
+
+        cache->initialized = true;
+
+        //Set pointer to array of entries
+        cache->entries = entries;
+        cache->num_entries = num_entries;
+        cache->use_order = 0;
+
+        cache->hits = 0;
+        cache->misses = 0;
+
+        //All entries start empty
+        for (unsigned i = 0; i < num_entries; i++) {
+            entries[i].valid = false;
+        }
+
+    }
+}
+
+//Find the entry matching a tag and key, or NULL on a miss
+struct Memo_Entry * memo_cache_lookup(struct Memo_Cache * cache, unsigned tag,
+        const void * key, unsigned key_len) {
+
+    for (unsigned i = 0; i < cache->num_entries; i++) {
+        struct Memo_Entry * entry = &cache->entries[i];
+
+        if (entry->valid && entry->tag == tag && entry->key_len == key_len &&
+                !memcmp(entry->key, key, key_len)) {
+
+            //Hit: mark as most recently used
+            entry->last_used = cache->use_order;
+            cache->use_order++;
+            cache->hits++;
+            return entry;
+        }
+    }
+
+    cache->misses++;
+    return NULL;
+}
+
+//Insert a reply for a tag and key, replacing the least-recently-used entry
+void memo_cache_insert(struct Memo_Cache * cache, unsigned tag,
+        const void * key, unsigned key_len, const void * reply, unsigned reply_len) {
+
+    //Do not cache anything that does not fit in an entry
+    if (key_len > MEMO_CACHE_KEY_SIZE || reply_len > MEMO_CACHE_REPLY_SIZE) return;
+
+    //Prefer an empty entry, otherwise take the least recently used
+    struct Memo_Entry * victim = &cache->entries[0];
+    for (unsigned i = 0; i < cache->num_entries; i++) {
+        struct Memo_Entry * entry = &cache->entries[i];
+
+        if (!entry->valid) {
+            victim = entry;
+            break;
+        }
+
+        if (entry->last_used < victim->last_used) {
+            victim = entry;
+        }
+    }
+
+    //Invalidate while the entry is rewritten
+    victim->valid = false;
+
+    victim->tag = tag;
+    victim->key_len = key_len;
+    memcpy(victim->key, key, key_len);
+    victim->reply_len = reply_len;
+    memcpy(victim->reply, reply, reply_len);
+
+    victim->last_used = cache->use_order;
+    cache->use_order++;
+
+    victim->valid = true;
+}
+
+//Report a cache's statistics
+void memo_cache_report(struct Memo_Cache * cache, const char * name) {
+    PRIORITY_STATS_PRINT("memo", name, "entries=%u,hits=%llu,misses=%llu",
+            cache->num_entries, cache->hits, cache->misses);
+}
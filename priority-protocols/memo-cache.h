@@ -0,0 +1,94 @@
+/*
+
+    memo-cache.h
+
+    A bounded result cache for CPI methods declared pure
+    (i.e., deterministic functions of their inputs, with no side effects).
+
+    The cache is keyed by the marshalled input bytes of a request
+    (the method index followed by its input parameters),
+    and stores the marshalled output bytes of the reply.
+    On a hit, the receive loop replies immediately,
+    without entering the priority protocol or calling the procedure.
+    For IPCP and NPCS CPIs, this also removes the blocking
+    that the request would otherwise impose on other tasks.
+
+    Each entry is tagged, so that a single cache can serve an interface
+    connected to different from-interface types,
+    whose method indices may not agree.
+
+    Entries are replaced in least-recently-used order.
+    Keys and replies larger than MEMO_CACHE_KEY_SIZE and MEMO_CACHE_REPLY_SIZE
+    are not cached.
+
+    Like the Priority_Inheritance lock, the cache is not protected by an atomic lock.
+    It is only accessed by threadpool threads while they run at the ceiling priority
+    (before priority_pre and after priority_post),
+    so the same laddering argument applies.
+*/
+
+#pragma once
+
+#include <camkes.h>
+
+//Maximum size, in bytes, of the marshalled inputs of a cached request
+#ifndef MEMO_CACHE_KEY_SIZE
+#define MEMO_CACHE_KEY_SIZE 64
+#endif
+
+//Maximum size, in bytes, of the marshalled outputs of a cached reply
+#ifndef MEMO_CACHE_REPLY_SIZE
+#define MEMO_CACHE_REPLY_SIZE 64
+#endif
+
+struct Memo_Entry {
+    bool valid;
+    unsigned tag;
+    unsigned key_len;
+    unsigned reply_len;
+    unsigned long long last_used;
+    unsigned char key[MEMO_CACHE_KEY_SIZE];
+    unsigned char reply[MEMO_CACHE_REPLY_SIZE];
+};
+
+struct Memo_Cache {
+
+    bool initialized;
+
+    //Array of entries, passed at initialization
+    struct Memo_Entry * entries;
+    unsigned num_entries;
+
+    //Monotonic counter used to order entries by most recent use
+    unsigned long long use_order;
+
+    //Statistics
+    unsigned long long hits;
+    unsigned long long misses;
+
+};
+
+/*
+    Memo Cache Init
+
+    Allocates static memory for the cache entries.
+    Even though it's in the init function scope,
+    this array is accessible through the pointer in the Memo_Cache object.
+*/
+#define MEMO_CACHE_INIT(MEMO_CACHE_PTR, NUM_ENTRIES) \
+    static struct Memo_Entry memo_entries[NUM_ENTRIES]; \
+    memo_cache_init(MEMO_CACHE_PTR, memo_entries, NUM_ENTRIES);
+
+//Initialize a Memo_Cache
+void memo_cache_init(struct Memo_Cache * cache, struct Memo_Entry * entries, unsigned num_entries);
+
+//Find the entry matching a tag and key, or NULL on a miss
+struct Memo_Entry * memo_cache_lookup(struct Memo_Cache * cache, unsigned tag,
+        const void * key, unsigned key_len);
+
+//Insert a reply for a tag and key, replacing the least-recently-used entry
+void memo_cache_insert(struct Memo_Cache * cache, unsigned tag,
+        const void * key, unsigned key_len, const void * reply, unsigned reply_len);
+
+//Report a cache's statistics, in the format of priority-stats.h
+void memo_cache_report(struct Memo_Cache * cache, const char * name);
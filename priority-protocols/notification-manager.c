@@ -8,12 +8,17 @@
 */
 
 #include "notification-manager.h"
+#include "priority-stats.h"
 
 #include <camkes.h>
 #include <camkes/allocator.h>
+#include <camkes/tls.h>
+#include <sel4utils/sel4_zf_logif.h>
 #include <utils/attribute.h>
 
 
+struct Notification_Pool priority_notification_pool;
+
 
 //Initialize the Notification Manager
 void ntfn_mgr_init(struct Notification_Manager * ntfn_mgr, struct Notification_Node * node_arr,
@@ -32,6 +37,7 @@ void ntfn_mgr_init(struct Notification_Manager * ntfn_mgr, struct Notification_N
         ntfn_mgr->prio_queue = prio_queue;
         ntfn_mgr->num_waiters = 0;
         ntfn_mgr->insert_order = 0;
+        ntfn_mgr->max_waiters = 0;
 
         //Initialize free list
         ntfn_mgr->free_list = node_arr;
@@ -47,6 +53,103 @@ void ntfn_mgr_init(struct Notification_Manager * ntfn_mgr, struct Notification_N
     }
 }
 
+//Initialize a Notification Pool
+void ntfn_pool_init(struct Notification_Pool * pool, struct Notification_Node * node_arr,
+        unsigned long * used, seL4_CPtr * ntfn_objs, unsigned arr_size) {
+
+    //Only run on first thread
+    if(!pool->initialized) {
+
+        pool->initialized = true;
+
+        pool->node_arr = node_arr;
+        pool->arr_size = arr_size;
+        pool->used = used;
+        pool->num_words = (arr_size + NOTIFICATION_POOL_WORD_BITS - 1) / NOTIFICATION_POOL_WORD_BITS;
+
+        // Assign CAmkES-created notification objects
+        for (unsigned i = 0; i < arr_size; i++) {
+            node_arr[i].ntfn_obj = ntfn_objs[i];
+        }
+
+        //Mark the bits beyond the last node as in use, so they are never claimed
+        unsigned spare = pool->num_words * NOTIFICATION_POOL_WORD_BITS - arr_size;
+        if (spare) {
+            used[pool->num_words - 1] = ~0UL << (NOTIFICATION_POOL_WORD_BITS - spare);
+        }
+    }
+}
+
+//Initialize a Notification Manager whose nodes come from a Notification Pool
+void ntfn_mgr_init_shared(struct Notification_Manager * ntfn_mgr, struct Notification_Node ** prio_queue,
+        struct Notification_Pool * pool, unsigned arr_size) {
+
+    //Only run on first thread
+    if(!ntfn_mgr->initialized) {
+
+        ntfn_mgr->initialized = true;
+        ntfn_mgr->pool = pool;
+        ntfn_mgr->arr_size = arr_size;
+
+        //Initialize priority queue
+        ntfn_mgr->prio_queue = prio_queue;
+        ntfn_mgr->num_waiters = 0;
+        ntfn_mgr->insert_order = 0;
+        ntfn_mgr->max_waiters = 0;
+
+    }
+}
+
+//Claim a node from a Notification Pool
+static struct Notification_Node * ntfn_pool_get(struct Notification_Pool * pool) {
+
+    for (unsigned w = 0; w < pool->num_words; w++) {
+        unsigned long used = __atomic_load_n(&pool->used[w], __ATOMIC_RELAXED);
+        while (~used) {
+            unsigned bit = __builtin_ctzl(~used);
+            if (__atomic_compare_exchange_n(&pool->used[w], &used, used | (1UL << bit),
+                        false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+
+                //The high-water mark is only approximate under preemption
+                unsigned in_use = __atomic_add_fetch(&pool->in_use, 1, __ATOMIC_RELAXED);
+                if (in_use > pool->max_in_use) {
+                    pool->max_in_use = in_use;
+                }
+                return &pool->node_arr[w * NOTIFICATION_POOL_WORD_BITS + bit];
+            }
+        }
+    }
+
+    ZF_LOGF("Notification pool of %u nodes exhausted.\n", pool->arr_size);
+    return NULL;
+}
+
+//Return a node to a Notification Pool
+static void ntfn_pool_free(struct Notification_Pool * pool, struct Notification_Node * node) {
+    unsigned index = node - pool->node_arr;
+    __atomic_sub_fetch(&pool->in_use, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_and(&pool->used[index / NOTIFICATION_POOL_WORD_BITS],
+            ~(1UL << (index % NOTIFICATION_POOL_WORD_BITS)), __ATOMIC_RELEASE);
+}
+
+void ntfn_pool_report(struct Notification_Pool * pool, const char * name) {
+    PRIORITY_STATS_PRINT("notification_pool", name, "nodes=%u,max_in_use=%u",
+        pool->arr_size, pool->max_in_use);
+}
+
+//Take a node for a waiting thread, from the free list or the shared pool
+static struct Notification_Node * ntfn_mgr_get(struct Notification_Manager * ntfn_mgr) {
+
+    if (ntfn_mgr->pool) {
+        return ntfn_pool_get(ntfn_mgr->pool);
+    }
+
+    //Obtain notification object from head of free list
+    struct Notification_Node * node = ntfn_mgr->free_list;
+    ntfn_mgr->free_list = node->next;
+    return node;
+}
+
 //Check if a node is greater than another node
 bool ntfn_greater_than(struct Notification_Node * lhs, struct Notification_Node * rhs) {
 
@@ -159,6 +262,9 @@ void ntfn_mgr_insert(struct Notification_Manager * ntfn_mgr, struct Notification
 
     unsigned index = ntfn_mgr->num_waiters;
     ntfn_mgr->num_waiters++;
+    if (ntfn_mgr->num_waiters > ntfn_mgr->max_waiters) {
+        ntfn_mgr->max_waiters = ntfn_mgr->num_waiters;
+    }
 
     //Insert node at end of binary heap
     ntfn_mgr->prio_queue[index] = node;
@@ -168,18 +274,15 @@ void ntfn_mgr_insert(struct Notification_Manager * ntfn_mgr, struct Notification
     
 }
 
-//Remove head node from priority queue
-void ntfn_mgr_pop(struct Notification_Manager * ntfn_mgr) {
+//Remove head node from priority queue, without returning it to the free list
+struct Notification_Node * ntfn_mgr_remove_head(struct Notification_Manager * ntfn_mgr) {
 
     //Don't do anything if the heap is empty
-    if (!ntfn_mgr->num_waiters) return;
+    if (!ntfn_mgr->num_waiters) return NULL;
 
     ntfn_mgr->num_waiters--;
     struct Notification_Node ** prio_queue = ntfn_mgr->prio_queue;
-
-    //Return head node to free list
-    prio_queue[0]->next = ntfn_mgr->free_list;
-    ntfn_mgr->free_list = prio_queue[0];
+    struct Notification_Node * head = prio_queue[0];
 
     //There are still waiters in the heap, sort accordingly
     if(ntfn_mgr->num_waiters) {
@@ -196,16 +299,61 @@ void ntfn_mgr_pop(struct Notification_Manager * ntfn_mgr) {
         prio_queue[0] = NULL;
     }
 
+    return head;
 }
 
-void ntfn_mgr_wait(int priority, struct Notification_Manager * ntfn_mgr) {
+//Return a node to the free list, or the shared pool
+void ntfn_mgr_free(struct Notification_Manager * ntfn_mgr, struct Notification_Node * node) {
+    if (ntfn_mgr->pool) {
+        ntfn_pool_free(ntfn_mgr->pool, node);
+        return;
+    }
+    node->next = ntfn_mgr->free_list;
+    ntfn_mgr->free_list = node;
+}
 
-    //Obtain notification object from head of free list
-    struct Notification_Node * node = ntfn_mgr->free_list;
-    ntfn_mgr->free_list = node->next;
+//Remove head node from priority queue
+void ntfn_mgr_pop(struct Notification_Manager * ntfn_mgr) {
+
+    struct Notification_Node * head = ntfn_mgr_remove_head(ntfn_mgr);
+
+    //Return head node to free list
+    if (head) {
+        ntfn_mgr_free(ntfn_mgr, head);
+    }
+
+}
+
+//Remove a node from anywhere in the priority queue, and return it to the free list
+static void ntfn_mgr_remove(struct Notification_Manager * ntfn_mgr, struct Notification_Node * node) {
+
+    struct Notification_Node ** prio_queue = ntfn_mgr->prio_queue;
+
+    for (unsigned i = 0; i < ntfn_mgr->num_waiters; i++) {
+        if (prio_queue[i] != node) continue;
+
+        //Replace the node with the last node, which may belong above or below it
+        ntfn_mgr->num_waiters--;
+        if (i != ntfn_mgr->num_waiters) {
+            prio_queue[i] = prio_queue[ntfn_mgr->num_waiters];
+            swap_parent(ntfn_mgr, i);
+            swap_children(ntfn_mgr, i);
+        }
+        prio_queue[ntfn_mgr->num_waiters] = NULL;
+        break;
+    }
+
+    ntfn_mgr_free(ntfn_mgr, node);
+}
+
+int ntfn_mgr_wait(int priority, struct Notification_Manager * ntfn_mgr) {
+
+    //Obtain a notification object
+    struct Notification_Node * node = ntfn_mgr_get(ntfn_mgr);
 
     //Set notification object priority
     node->priority = priority;
+    node->waiter = camkes_get_tls()->tcb_cap;
 
     //Insert into priority queue
     ntfn_mgr_insert(ntfn_mgr, node);
@@ -213,12 +361,41 @@ void ntfn_mgr_wait(int priority, struct Notification_Manager * ntfn_mgr) {
     //Wait on notification object    
     seL4_Wait(node->ntfn_obj, NULL);
 
-    //Once a thread wakes up, pop from head of priority queue
-    ntfn_mgr_pop(ntfn_mgr);
+    //Our priority may have been raised while we waited
+    priority = node->priority;
+
+    /*
+        Once a thread wakes up, remove its own node from the priority queue.
+        This is the head it was signalled as,
+        unless another waiter has since been inserted or raised (see ntfn_mgr_raise) above it.
+    */
+    ntfn_mgr_remove(ntfn_mgr, node);
 
+    return priority;
 
 }
 
+/*
+    Raise the priority of a waiting thread.
+    The heap is not indexed by thread, so its node is found by a linear search,
+    bounded by the number of waiters, then swapped with its parents as on insertion.
+*/
+bool ntfn_mgr_raise(struct Notification_Manager * ntfn_mgr, seL4_CPtr waiter, int priority) {
+
+    for (unsigned i = 0; i < ntfn_mgr->num_waiters; i++) {
+        struct Notification_Node * node = ntfn_mgr->prio_queue[i];
+        if (node->waiter == waiter) {
+            if (priority > (int) node->priority) {
+                node->priority = priority;
+                swap_parent(ntfn_mgr, i);
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void ntfn_mgr_signal(struct Notification_Manager * ntfn_mgr) {
     struct Notification_Node * head = ntfn_mgr->prio_queue[0];
     if(head) {
@@ -226,12 +403,49 @@ void ntfn_mgr_signal(struct Notification_Manager * ntfn_mgr) {
     }
 }
 
+/*
+    Hand-off variants of wait and signal.
+
+    ntfn_mgr_signal leaves the head node in the priority queue until the woken thread pops it,
+    so two signals before the woken thread runs would both wake the same thread.
+    ntfn_mgr_signal_handoff instead removes the head node as it signals it,
+    so each signal wakes a distinct waiter,
+    and the woken thread (waiting in ntfn_mgr_wait_handoff) only returns its node to the free list.
+*/
+void ntfn_mgr_wait_handoff(int priority, struct Notification_Manager * ntfn_mgr) {
+
+    //Obtain a notification object
+    struct Notification_Node * node = ntfn_mgr_get(ntfn_mgr);
+
+    //Set notification object priority
+    node->priority = priority;
+    node->waiter = camkes_get_tls()->tcb_cap;
+
+    //Insert into priority queue
+    ntfn_mgr_insert(ntfn_mgr, node);
+
+    //Wait on notification object
+    seL4_Wait(node->ntfn_obj, NULL);
+
+    //The signaller already removed our node from the priority queue
+    ntfn_mgr_free(ntfn_mgr, node);
+
+}
+
+bool ntfn_mgr_signal_handoff(struct Notification_Manager * ntfn_mgr) {
+    struct Notification_Node * head = ntfn_mgr_remove_head(ntfn_mgr);
+    if(head) {
+        seL4_Signal(head->ntfn_obj);
+        return true;
+    }
+    return false;
+}
+
 //The following are for testing purposes
 void ntfn_mgr_simulate_wait(int priority, struct Notification_Manager * ntfn_mgr) {
 
-    //Obtain notification object from head of free list
-    struct Notification_Node * node = ntfn_mgr->free_list;
-    ntfn_mgr->free_list = node->next;
+    //Obtain a notification object
+    struct Notification_Node * node = ntfn_mgr_get(ntfn_mgr);
 
     //Set notification object priority
     node->priority = priority;
@@ -243,9 +457,8 @@ void ntfn_mgr_simulate_wait(int priority, struct Notification_Manager * ntfn_mgr
 
 void ntfn_mgr_simulate_wait_wake(int priority, struct Notification_Manager * ntfn_mgr) {
 
-    //Obtain notification object from head of free list
-    struct Notification_Node * node = ntfn_mgr->free_list;
-    ntfn_mgr->free_list = node->next;
+    //Obtain a notification object
+    struct Notification_Node * node = ntfn_mgr_get(ntfn_mgr);
 
     //Set notification object priority
     node->priority = priority;
@@ -262,10 +475,12 @@ void ntfn_mgr_simulate_reset(struct Notification_Manager * ntfn_mgr) {
 
     unsigned arr_size = ntfn_mgr->arr_size;
 
-    //Reset free list
-    ntfn_mgr->free_list = ntfn_mgr->node_arr;
-    for (unsigned i = 0; i < arr_size - 1; i++) {
-        ntfn_mgr->node_arr[i].next = ntfn_mgr->node_arr + i + 1;
+    //Reset free list (a shared pool's nodes are returned as their waiters wake)
+    if (!ntfn_mgr->pool) {
+        ntfn_mgr->free_list = ntfn_mgr->node_arr;
+        for (unsigned i = 0; i < arr_size - 1; i++) {
+            ntfn_mgr->node_arr[i].next = ntfn_mgr->node_arr + i + 1;
+        }
     }
 
     //Reset priority queue
@@ -273,7 +488,8 @@ void ntfn_mgr_simulate_reset(struct Notification_Manager * ntfn_mgr) {
         ntfn_mgr->prio_queue[i] = NULL;
     }
 
-    //Reset num_waiters and insert order
+    //Reset num_waiters, insert order and high-water mark
     ntfn_mgr->num_waiters = 0;
     ntfn_mgr->insert_order = 0;
+    ntfn_mgr->max_waiters = 0;
 }
\ No newline at end of file
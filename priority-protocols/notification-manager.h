@@ -34,7 +34,8 @@
     it sends a signal to the notification object bound to the head node.
 
     Once a thread wakes from waiting,
-    it pops its Notification Node from the head of the priority queue.
+    it removes its Notification Node from the priority queue
+    (usually its head, unless a higher-priority waiter has since arrived).
 
     For more details, see the associated paper
     (available at https://www.sudvarg.com/priority-aware-camkes/)
@@ -50,12 +51,48 @@ struct Notification_Node {
     unsigned long long insert_order;
     seL4_CPtr ntfn_obj;
     struct Notification_Node * next;
+
+    //TCB of the thread waiting on the node, so its priority can be raised while it waits
+    seL4_CPtr waiter;
+};
+
+/*
+    A pool of Notification Nodes shared by the Notification Managers of a component.
+
+    A thread can only wait in one place at a time,
+    so rather than each Notification Manager holding a node for every thread that may wait on it,
+    the managers of a component's PIP interfaces may draw nodes from a single pool,
+    sized by the number of threads that may wait at once across all of them.
+    Managers sharing a pool run at different ceilings,
+    so nodes are claimed and released atomically, in a bitmap of the nodes in use.
+*/
+#define NOTIFICATION_POOL_WORD_BITS (sizeof(unsigned long) * 8)
+
+struct Notification_Pool {
+
+    bool initialized;
+
+    //Array of Notification Nodes, passed at initialization
+    struct Notification_Node * node_arr;
+    unsigned arr_size;
+
+    //Bitmap of the nodes in use
+    unsigned long * used;
+    unsigned num_words;
+
+    //Nodes currently in use, and their high-water mark
+    unsigned in_use;
+    unsigned max_in_use;
+
 };
 
 struct Notification_Manager {
 
     bool initialized;
 
+    //Pool of shared nodes, or NULL if the manager has its own
+    struct Notification_Pool * pool;
+
     //Array of Notification Nodes, passed at initialization
     struct Notification_Node * node_arr;
 
@@ -65,6 +102,9 @@ struct Notification_Manager {
     unsigned num_waiters;
     unsigned long long insert_order;
 
+    //High-water mark of num_waiters, for sizing the node array
+    unsigned max_waiters;
+
     //Pointer to head of singly-linked of available Notification Nodes, NULL if all waiting
     struct Notification_Node * free_list;
 
@@ -95,16 +135,70 @@ struct Notification_Manager {
             prio_queue, NTFN_OBJ_ARR, ARR_SIZE);
 
 
+//The component's shared pool, initialized by the to-template of its first PIP interface
+extern struct Notification_Pool priority_notification_pool;
+
+/*
+    Notification Pool Init
+
+    Allocates static memory for the pool's Notification_Nodes and its bitmap.
+*/
+#define NOTIFICATION_POOL_INIT(NOTIFICATION_POOL_PTR, NTFN_OBJ_ARR, ARR_SIZE) \
+    static struct Notification_Node pool_ntfns[ARR_SIZE]; \
+    static unsigned long pool_used[(ARR_SIZE + NOTIFICATION_POOL_WORD_BITS - 1) / NOTIFICATION_POOL_WORD_BITS]; \
+    ntfn_pool_init(NOTIFICATION_POOL_PTR, pool_ntfns, pool_used, NTFN_OBJ_ARR, ARR_SIZE);
+
+/*
+    Shared Notification Manager Init
+
+    Allocates static memory for the priority queue only;
+    waiting threads take their nodes from the given pool.
+*/
+#define NOTIFICATION_MANAGER_INIT_SHARED(NOTIFICATION_MANAGER_PTR, NOTIFICATION_POOL_PTR, ARR_SIZE) \
+    static struct Notification_Node * prio_queue[ARR_SIZE]; \
+    ntfn_mgr_init_shared(NOTIFICATION_MANAGER_PTR, prio_queue, NOTIFICATION_POOL_PTR, ARR_SIZE);
+
+//Initialize a Notification Pool
+void ntfn_pool_init(struct Notification_Pool * pool, struct Notification_Node * node_arr,
+        unsigned long * used, seL4_CPtr * ntfn_objs, unsigned arr_size);
+
+//Initialize a Notification Manager whose nodes come from a Notification Pool
+void ntfn_mgr_init_shared(struct Notification_Manager * ntfn_mgr, struct Notification_Node ** prio_queue,
+        struct Notification_Pool * pool, unsigned arr_size);
+
+//Report a Notification Pool's usage, in the format of priority-stats.h
+void ntfn_pool_report(struct Notification_Pool * pool, const char * name);
+
 //Initialize Notification Manager
 void ntfn_mgr_init(struct Notification_Manager * ntfn_mgr, struct Notification_Node * node_arr,
         struct Notification_Node ** prio_queue, seL4_CPtr * ntfn_objs, unsigned arr_size);
 
-//Wait on the Notification Manager as if it's a Notification Object
-void ntfn_mgr_wait(int priority, struct Notification_Manager * ntfn_mgr);
+/*
+    Wait on the Notification Manager as if it's a Notification Object.
+    Returns the priority the waiter was woken at, which ntfn_mgr_raise may have raised.
+*/
+int ntfn_mgr_wait(int priority, struct Notification_Manager * ntfn_mgr);
+
+/*
+    Raise the priority of the given thread while it waits on the Notification Manager,
+    restoring the heap property (increase-key).
+    Returns false if the thread is not waiting.
+*/
+bool ntfn_mgr_raise(struct Notification_Manager * ntfn_mgr, seL4_CPtr waiter, int priority);
 
 //Signal on the Notification Manager as if it's a Notification Object
 void ntfn_mgr_signal(struct Notification_Manager * ntfn_mgr);
 
+/*
+    Hand-off variants of wait and signal,
+    for which the signaller removes the highest-priority waiter from the priority queue.
+    Each signal therefore wakes a distinct waiter, even if it has not yet run.
+    ntfn_mgr_signal_handoff returns false if there were no waiters.
+    A Notification Manager should use either the standard or hand-off variants, not both.
+*/
+void ntfn_mgr_wait_handoff(int priority, struct Notification_Manager * ntfn_mgr);
+bool ntfn_mgr_signal_handoff(struct Notification_Manager * ntfn_mgr);
+
 //The following are for testing purposes
 void ntfn_mgr_simulate_wait(int priority, struct Notification_Manager * ntfn_mgr);
 void ntfn_mgr_simulate_wait_wake(int priority, struct Notification_Manager * ntfn_mgr);
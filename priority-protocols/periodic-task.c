@@ -0,0 +1,123 @@
+/*
+
+    periodic-task.c
+
+    The implementation of the periodic task runtime.
+    See periodic-task.h for more details.
+
+*/
+
+#include "periodic-task.h"
+#include "priority-clock.h"
+#include "priority-stats.h"
+
+#include <camkes.h>
+#include <string.h>
+
+
+//Initialize a Periodic_Task
+void periodic_task_init(struct Periodic_Task * task, const char * name,
+        uint64_t period_us, uint64_t deadline_us) {
+
+    if(!task->initialized) {
+
+        memset(task, 0, sizeof(*task));
+        task->initialized = true;
+        task->name = name;
+        task->period = priority_clock_us_to_cycles(period_us);
+        task->deadline = priority_clock_us_to_cycles(deadline_us ? deadline_us : period_us);
+    }
+}
+
+void periodic_task_release(struct Periodic_Task * task) {
+
+    uint64_t now = priority_clock_cycles();
+
+    if (!task->released) {
+        task->first_release = now;
+        task->release_index = 0;
+    }
+    else {
+        task->release_index++;
+
+        //Releases that passed while the previous job overran were coalesced into this one
+        while (task->period &&
+                task->first_release + (task->release_index + 1) * task->period <= now) {
+            task->release_index++;
+            task->skipped++;
+        }
+    }
+
+    task->release = task->first_release + task->release_index * task->period;
+    task->pending = true;
+    task->released++;
+}
+
+void periodic_task_complete(struct Periodic_Task * task) {
+
+    if (!task->pending) return;
+    task->pending = false;
+
+    uint64_t response = priority_clock_cycles() - task->release;
+
+    task->completed++;
+    task->total_response += response;
+    if (response > task->max_response) {
+        task->max_response = response;
+    }
+
+    if (response > task->deadline) {
+        task->misses++;
+    }
+    if (response > task->period) {
+        task->overruns++;
+    }
+
+    uint64_t bin = task->deadline ? response * PERIODIC_TASK_BINS_PER_DEADLINE / task->deadline : 0;
+    if (bin >= PERIODIC_TASK_HISTOGRAM_BINS) {
+        bin = PERIODIC_TASK_HISTOGRAM_BINS - 1;
+    }
+    task->histogram[bin]++;
+}
+
+void periodic_task_run(struct Periodic_Task * task, void (*job)(void),
+        seL4_CPtr notification, unsigned report_every) {
+
+    seL4_Word badge;
+
+    while (1) {
+
+        unsigned long long misses = task->misses;
+
+        periodic_task_release(task);
+        job();
+        periodic_task_complete(task);
+
+        if (report_every && (task->misses != misses || task->completed % report_every == 0)) {
+            periodic_task_report(task);
+        }
+
+        seL4_Wait(notification, &badge);
+    }
+}
+
+void periodic_task_report(struct Periodic_Task * task) {
+
+    //Histogram bins, separated by spaces within a single field
+    char histogram[PERIODIC_TASK_HISTOGRAM_BINS * 21];
+    int offset = 0;
+    for (unsigned i = 0; i < PERIODIC_TASK_HISTOGRAM_BINS; i++) {
+        offset += snprintf(histogram + offset, sizeof(histogram) - offset, i ? " %llu" : "%llu",
+                task->histogram[i]);
+    }
+
+    PRIORITY_STATS_PRINT("task", task->name,
+            "period_us=%llu,deadline_us=%llu,released=%llu,completed=%llu,misses=%llu,overruns=%llu,skipped=%llu,"
+            "mean_response_us=%llu,max_response_us=%llu,histogram=%s",
+            (unsigned long long) priority_clock_cycles_to_us(task->period),
+            (unsigned long long) priority_clock_cycles_to_us(task->deadline),
+            task->released, task->completed, task->misses, task->overruns, task->skipped,
+            (unsigned long long) priority_clock_cycles_to_us(task->completed ? task->total_response / task->completed : 0),
+            (unsigned long long) priority_clock_cycles_to_us(task->max_response),
+            histogram);
+}
@@ -0,0 +1,85 @@
+/*
+
+    periodic-task.h
+
+    A runtime for periodic tasks, such as those of the sample application,
+    which monitors each task's jobs for deadline misses and overruns.
+
+    A task timestamps each job's release and completion with the cycle counter (see priority-clock.h).
+    Jobs are released every period from the first release,
+    so the response time of a job is measured from its nominal release time,
+    and includes both release jitter and any blocking on CPIs.
+    For each task, the runtime counts:
+
+        * Deadline misses: jobs whose response time exceeded the task's deadline.
+
+        * Overruns: jobs that completed after the task's next release.
+
+        * Skipped releases: releases that passed while the previous job overran.
+          A periodic timeout signals a notification object, so these are coalesced into one wakeup.
+
+    It also records each job's response time in a histogram,
+    with PERIODIC_TASK_HISTOGRAM_BINS bins, each an eighth of the deadline wide;
+    the last bin counts every response time beyond its lower bound.
+
+    Statistics are reported in the format of priority-stats.h.
+*/
+
+#pragma once
+
+#include <camkes.h>
+#include <sel4/sel4.h>
+#include <stdint.h>
+
+#define PERIODIC_TASK_HISTOGRAM_BINS 16
+#define PERIODIC_TASK_BINS_PER_DEADLINE 8
+
+struct Periodic_Task {
+
+    bool initialized;
+    const char * name;
+
+    //Period and relative deadline, in cycles
+    uint64_t period;
+    uint64_t deadline;
+
+    //Releases are counted from the first
+    uint64_t first_release;
+    unsigned long long release_index;
+    uint64_t release;
+    bool pending;
+
+    //Statistics
+    unsigned long long released;
+    unsigned long long completed;
+    unsigned long long misses;
+    unsigned long long overruns;
+    unsigned long long skipped;
+    uint64_t max_response;
+    uint64_t total_response;
+    unsigned long long histogram[PERIODIC_TASK_HISTOGRAM_BINS];
+
+};
+
+//Initialize a Periodic_Task, with its period and relative deadline in microseconds
+void periodic_task_init(struct Periodic_Task * task, const char * name,
+        uint64_t period_us, uint64_t deadline_us);
+
+//Record the release of a job, at the start of the job
+void periodic_task_release(struct Periodic_Task * task);
+
+//Record the completion of a job
+void periodic_task_complete(struct Periodic_Task * task);
+
+/*
+    Run a periodic task forever,
+    executing the job at every release signalled on the notification object
+    (e.g., by a periodic timeout), starting immediately.
+    If report_every is nonzero, statistics are reported after every report_every jobs,
+    and after every deadline miss.
+*/
+void periodic_task_run(struct Periodic_Task * task, void (*job)(void),
+        seL4_CPtr notification, unsigned report_every);
+
+//Report a task's statistics
+void periodic_task_report(struct Periodic_Task * task);
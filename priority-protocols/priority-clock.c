@@ -0,0 +1,46 @@
+/*
+
+    priority-clock.c
+
+    The implementation of the cycle-counter timestamp source.
+    See priority-clock.h for more details.
+
+*/
+
+#include "priority-clock.h"
+
+#include <camkes.h>
+#include <sel4bench/sel4bench.h>
+
+
+static bool clock_initialized = false;
+static uint64_t clock_cycles_per_us = PRIORITY_CLOCK_DEFAULT_CYCLES_PER_US;
+
+//Initialize the cycle counter and record the clock frequency
+void priority_clock_init(uint64_t cycles_per_us) {
+
+    //A frequency given by any call replaces the default, even if the counter is already initialized
+    if (cycles_per_us) {
+        clock_cycles_per_us = cycles_per_us;
+    }
+
+    //Only run on first thread
+    if(!clock_initialized) {
+        clock_initialized = true;
+        sel4bench_init();
+    }
+}
+
+//Current value of the cycle counter
+uint64_t priority_clock_cycles(void) {
+    return (uint64_t) sel4bench_get_cycle_count();
+}
+
+//Convert between cycles and microseconds
+uint64_t priority_clock_us_to_cycles(uint64_t us) {
+    return us * clock_cycles_per_us;
+}
+
+uint64_t priority_clock_cycles_to_us(uint64_t cycles) {
+    return cycles / clock_cycles_per_us;
+}
@@ -0,0 +1,39 @@
+/*
+
+    priority-clock.h
+
+    A lightweight timestamp source for the priority protocols library,
+    read directly from the CPU cycle counter through libsel4bench,
+    so taking a timestamp does not require a system call or a request to a timer component.
+
+    Components that use it must link the sel4bench library,
+    and on ARM the kernel must export the PMU to user level
+    (KernelArmExportPMUUser).
+
+    Cycle counts are converted to and from microseconds using the
+    cycles_per_us value supplied at initialization
+    (typically from the component's clock_cycles_per_us attribute).
+*/
+
+#pragma once
+
+#include <camkes.h>
+#include <stdint.h>
+
+//Cycles per microsecond assumed if a component does not specify its clock frequency
+#define PRIORITY_CLOCK_DEFAULT_CYCLES_PER_US 1000
+
+/*
+    Initialize the cycle counter and record the clock frequency.
+    The counter is only initialized by the first call,
+    but any call with a non-zero cycles_per_us sets the frequency,
+    so a call with 0 (keeping the default, or an earlier frequency) may come first.
+*/
+void priority_clock_init(uint64_t cycles_per_us);
+
+//Current value of the cycle counter
+uint64_t priority_clock_cycles(void);
+
+//Convert between cycles and microseconds
+uint64_t priority_clock_us_to_cycles(uint64_t us);
+uint64_t priority_clock_cycles_to_us(uint64_t cycles);
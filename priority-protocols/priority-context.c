@@ -0,0 +1,26 @@
+/*
+
+    priority-context.c
+
+    The implementation of the per-thread priority context.
+    See priority-context.h for more details.
+
+*/
+
+#include "priority-context.h"
+
+#include <camkes.h>
+
+
+//The caller's effective priority, private to each thread
+static __thread int effective_priority = PRIORITY_CONTEXT_UNSET;
+
+//Returns the caller's effective priority, or PRIORITY_CONTEXT_UNSET
+int get_effective_priority(void) {
+    return effective_priority;
+}
+
+//Sets the caller's effective priority
+void set_effective_priority(int priority) {
+    effective_priority = priority;
+}
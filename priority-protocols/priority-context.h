@@ -0,0 +1,49 @@
+/*
+
+    priority-context.h
+
+    Per-thread priority context for priority-aware intercomponent requests.
+
+    Each thread carries an effective priority in thread-local storage:
+    the priority at which any request it sends should be handled.
+    The prioritized from-template (seL4RPCCallPrioritized-from.template.c)
+    reads it and inserts it into the first message register of every request,
+    so procedure signatures no longer need to carry a priority parameter.
+
+    The effective priority is maintained by the library itself:
+        * priority_pre sets it for a CPI thread before the procedure runs,
+          so nested requests inherit it without user code
+        * priority_post restores it once the request completes
+        * If a thread never set it (e.g., a task's control thread),
+          the from-template falls back to the component's _priority attribute
+
+    A thread that is neither a task's control thread nor a CPI threadpool thread
+    may call set_effective_priority directly before sending requests.
+
+    Tasks only need to link priority-context.c;
+    CPIs link it alongside priority-protocols.c.
+*/
+
+#pragma once
+
+#include <camkes.h>
+
+//Value returned by get_effective_priority if the caller has not set a priority
+#define PRIORITY_CONTEXT_UNSET (-1)
+
+/*
+    Message layout for prioritized requests.
+
+    The request priority occupies the first message register,
+    and the marshalled method index and parameters follow.
+    Requests to an interface with an inversion monitor (see inversion-monitor.h)
+    also carry the time they were sent, in the second message register.
+*/
+#define PRIORITY_MSG_SIZE (sizeof(seL4_Word))
+#define PRIORITY_MONITORED_MSG_SIZE (2 * sizeof(seL4_Word))
+
+//Returns the caller's effective priority, or PRIORITY_CONTEXT_UNSET
+int get_effective_priority(void);
+
+//Sets the caller's effective priority
+void set_effective_priority(int priority);
@@ -0,0 +1,60 @@
+/*
+
+    priority-events.c
+
+    The implementation of priority-aware event dispatch.
+    See priority-events.h for more details.
+
+*/
+
+#include "priority-events.h"
+#include "priority-protocols.h"
+#include "notification-manager.h"
+
+#include <camkes.h>
+
+
+//Initialize a Priority_Events structure
+void priority_events_init(struct Priority_Events * events) {
+
+    //Only run on first thread
+    if(!events->initialized) {
+        events->initialized = true;
+        events->dispatching = false;
+    }
+}
+
+void priority_event_pre(int event_priority, struct Priority_Protocol * info, struct Priority_Events * events) {
+
+    if (info->priority_protocol == fixed) {
+
+        //Wait for the running handler to hand off to us, in order of event priority
+        if (events->dispatching) {
+            ntfn_mgr_wait_handoff(event_priority, &events->ntfn_mgr);
+        }
+        events->dispatching = true;
+
+        //Requests from the handler are at the priority assigned to the interface
+        set_effective_priority(info->priority_ceiling);
+    }
+
+    //Propagated and inherited events follow the same protocol as requests
+    else {
+        priority_pre(event_priority, info);
+    }
+}
+
+void priority_event_post(struct Priority_Protocol * info, struct Priority_Events * events) {
+
+    if (info->priority_protocol == fixed) {
+
+        //Hand off to the highest-priority waiting event, if any
+        if (!ntfn_mgr_signal_handoff(&events->ntfn_mgr)) {
+            events->dispatching = false;
+        }
+    }
+
+    else {
+        priority_post(info);
+    }
+}
@@ -0,0 +1,68 @@
+/*
+
+    priority-events.h
+
+    Priority-aware dispatch of CAmkES events,
+    for the seL4NotificationPrioritized connectors.
+
+    A standard CAmkES event is delivered through a notification object
+    to a single consumer thread at a fixed priority,
+    so an event emitted by a high-priority task can wait behind low-priority work,
+    and carries no priority of its own.
+
+    Instead, the prioritized event connectors deliver each event as a short request on an endpoint,
+    carrying the emitter's effective priority in the first message register
+    (as the prioritized RPC connectors do).
+    The consumer interface has a threadpool waiting on the endpoint at the interface's ceiling priority.
+    The receiving thread replies immediately, releasing the emitter,
+    then runs the component's handler according to the interface's priority protocol:
+
+        * propagated: the handler runs at the event's priority,
+          so pending events are handled concurrently, highest-priority first,
+          and each is preempted by the events of higher-priority emitters
+
+        * inherited: handlers are mutually exclusive under the Priority Inheritance Protocol,
+          and waiting events acquire the handler in order of priority
+
+        * fixed: handlers are mutually exclusive and run at the ceiling priority.
+          Waiting events wait in a Notification Manager,
+          so they are dispatched in order of priority (ties broken by arrival),
+          rather than in the FIFO order of the endpoint
+
+    Unlike notifications, events are not coalesced:
+    each emit is handled once, and holds a threadpool thread until handled.
+    The threadpool should be sized to the maximum number of events pending at once;
+    beyond that, emitters block on the endpoint until a thread is free.
+
+    As for our CPIs, the dispatch state is manipulated at the ceiling priority,
+    so no atomic lock is needed.
+*/
+
+#pragma once
+
+#include "priority-protocols.h"
+#include "notification-manager.h"
+
+#include <camkes.h>
+
+struct Priority_Events {
+    bool initialized;
+
+    //Whether a handler is running, for the fixed protocol
+    bool dispatching;
+
+    //Events waiting for the handler, for the fixed protocol
+    struct Notification_Manager ntfn_mgr;
+};
+
+//Initialize a Priority_Events structure; the Notification_Manager is initialized separately
+void priority_events_init(struct Priority_Events * events);
+
+/*
+    Pre and Post functions,
+    which run before and after the component's event handler,
+    in place of priority_pre and priority_post
+*/
+void priority_event_pre(int event_priority, struct Priority_Protocol * info, struct Priority_Events * events);
+
+void priority_event_post(struct Priority_Protocol * info, struct Priority_Events * events);
@@ -0,0 +1,148 @@
+/*
+
+    priority-futures.c
+
+    The implementation of futures for parallel nested requests.
+    See priority-futures.h for more details.
+
+*/
+
+#include "priority-futures.h"
+#include "priority-protocols.h"
+#include "priority-stats.h"
+
+#include <camkes.h>
+#include <sel4utils/sel4_zf_logif.h>
+
+
+struct Future_Pool priority_future_pool;
+
+//This thread's notification object for joining futures, if it has claimed one
+static __thread seL4_CPtr join_ntfn = seL4_CapNull;
+
+
+void future_pool_init(unsigned num_workers, seL4_CPtr * join_ntfns, unsigned num_join_ntfns, int ceiling) {
+
+    struct Future_Pool * pool = &priority_future_pool;
+
+    //Only run on first thread
+    if(!pool->initialized) {
+        pool->initialized = true;
+        pool->ceiling = ceiling;
+        pool->num_workers = num_workers;
+        pool->join_ntfns = join_ntfns;
+        pool->num_join_ntfns = num_join_ntfns;
+    }
+}
+
+bool future_pool_is_worker(void) {
+    struct Future_Pool * pool = &priority_future_pool;
+    if (pool->workers_started == pool->num_workers) return false;
+    pool->workers_started++;
+    return true;
+}
+
+//Insert a future after any of the same or higher priority
+static void future_insert(struct Future_Pool * pool, struct Priority_Future * future) {
+    struct Priority_Future ** link = &pool->queue;
+    while (*link && (*link)->priority >= future->priority) {
+        link = &(*link)->next;
+    }
+    future->next = *link;
+    *link = future;
+
+    pool->num_queued++;
+    if (pool->num_queued > pool->max_queued) {
+        pool->max_queued = pool->num_queued;
+    }
+}
+
+void future_worker_run(void) {
+
+    struct Future_Pool * pool = &priority_future_pool;
+
+    while (1) {
+
+        /*
+            A worker finishing a call may take a future
+            before a woken worker runs, in which case the woken worker waits again
+        */
+        while (!pool->queue) {
+            ntfn_mgr_wait_handoff(pool->ceiling, &pool->ntfn_mgr);
+        }
+        struct Priority_Future * future = pool->queue;
+        pool->queue = future->next;
+        pool->num_queued--;
+
+        //Make the call at the future's priority
+        set_effective_priority(future->priority);
+        demote_priority(future->priority);
+        future->length = future->call(future->msg, future->length);
+        promote_priority(pool->ceiling);
+
+        future->done = true;
+        if (future->waiter) {
+            seL4_Signal(future->waiter);
+        }
+    }
+}
+
+void priority_future_submit(struct Priority_Future * future, priority_future_call_t call,
+        int priority, unsigned length) {
+
+    struct Future_Pool * pool = &priority_future_pool;
+
+    future->call = call;
+    future->priority = priority;
+    future->length = length;
+    future->done = false;
+    future->waiter = seL4_CapNull;
+
+    //Without workers, complete the future now
+    if (!pool->initialized) {
+        future->length = call(future->msg, length);
+        future->done = true;
+        return;
+    }
+
+    promote_priority(pool->ceiling);
+
+    pool->submitted++;
+    future_insert(pool, future);
+    ntfn_mgr_signal_handoff(&pool->ntfn_mgr);
+
+    demote_priority(priority);
+}
+
+unsigned priority_future_wait(struct Priority_Future * future, int priority) {
+
+    struct Future_Pool * pool = &priority_future_pool;
+
+    if (future->done) return future->length;
+
+    promote_priority(pool->ceiling);
+
+    if (!join_ntfn) {
+        ZF_LOGF_IF(pool->join_ntfns_claimed == pool->num_join_ntfns,
+                "No notification object left for joining futures.\n");
+        join_ntfn = pool->join_ntfns[pool->join_ntfns_claimed++];
+    }
+
+    while (!future->done) {
+        future->waiter = join_ntfn;
+        seL4_Wait(join_ntfn, NULL);
+    }
+    future->waiter = seL4_CapNull;
+
+    demote_priority(priority);
+
+    return future->length;
+}
+
+void future_pool_report(const char * name) {
+
+    struct Future_Pool * pool = &priority_future_pool;
+
+    PRIORITY_STATS_PRINT("futures", name, "workers=%u,submitted=%llu,max_queued=%u,max_idle_workers=%u",
+        pool->num_workers, pool->submitted, pool->max_queued, pool->ntfn_mgr.max_waiters);
+}
@@ -0,0 +1,110 @@
+/*
+
+    priority-futures.h
+
+    Futures, for CPIs that fan a request out to several downstream CPIs.
+
+    On seL4, a request is a synchronous call, so a thread can only wait on one reply at a time,
+    and a CPI thread making nested requests one after another
+    holds its threadpool thread for the sum of their latencies.
+    With futures, the thread instead marshals each nested request into a Priority_Future,
+    carrying its effective priority as any nested request does,
+    and hands it to a Future_Pool of worker threads, which make the calls in parallel.
+    The thread then joins on each future, and unmarshals its reply,
+    so a fan-out takes as long as its slowest request.
+
+    Workers are taken from the threadpool of one of the component's CPIs
+    (the first NAME_future_workers threads of the interface to start),
+    and wait for futures at the CPI's ceiling in a Notification Manager.
+    A worker takes the highest-priority pending future (ties broken by submission),
+    and makes its call at the future's priority, as propagated,
+    so a fan-out only uses workers at the priority of the request that issued it.
+    Threads joining a future wait on a notification object of their own.
+
+    As for the Notification Manager, the pool's state is only manipulated at its ceiling,
+    so on a uniprocessor no atomic lock is needed.
+    Since a thread's own priority is not readable from seL4,
+    each operation takes the caller's priority, which it returns to when the operation completes.
+
+    If the component has no Future_Pool, futures are completed synchronously as they are submitted.
+*/
+
+#pragma once
+
+#include "notification-manager.h"
+
+#include <camkes.h>
+#include <sel4/sel4.h>
+
+/*
+    Sends a future's marshalled request from the calling (worker) thread,
+    and replaces it with the marshalled reply, returning its size.
+    Generated by the from-template for each interface with futures.
+*/
+typedef unsigned (*priority_future_call_t)(seL4_Word * msg, unsigned length);
+
+struct Priority_Future {
+    priority_future_call_t call;
+    int priority;
+
+    //Size of the marshalled request, then of the reply
+    unsigned length;
+
+    bool done;
+    seL4_CPtr waiter;
+    struct Priority_Future * next;
+
+    //The marshalled request, including its priority, then the marshalled reply
+    seL4_Word msg[seL4_MsgMaxLength];
+};
+
+struct Future_Pool {
+
+    bool initialized;
+    int ceiling;
+
+    //Pending futures, highest-priority first
+    struct Priority_Future * queue;
+    unsigned num_queued;
+
+    //Idle workers wait on a Notification Manager
+    unsigned num_workers;
+    unsigned workers_started;
+    struct Notification_Manager ntfn_mgr;
+
+    //Notification objects for joining threads, each claimed by a thread on its first join
+    seL4_CPtr * join_ntfns;
+    unsigned num_join_ntfns;
+    unsigned join_ntfns_claimed;
+
+    //Statistics
+    unsigned long long submitted;
+    unsigned max_queued;
+
+};
+
+//The component's Future_Pool, initialized by the to-template of the interface providing its workers
+extern struct Future_Pool priority_future_pool;
+
+/*
+    Future Pool Init
+
+    The Notification Manager for workers is initialized separately.
+*/
+void future_pool_init(unsigned num_workers, seL4_CPtr * join_ntfns, unsigned num_join_ntfns, int ceiling);
+
+//Returns true for the first num_workers threadpool threads to start, which become workers
+bool future_pool_is_worker(void);
+
+//Worker: make the calls of pending futures, never returns
+void future_worker_run(void);
+
+//Submit a marshalled request, at the caller's priority, which is also the request's priority
+void priority_future_submit(struct Priority_Future * future, priority_future_call_t call,
+        int priority, unsigned length);
+
+//Wait for a future's reply, returning its size
+unsigned priority_future_wait(struct Priority_Future * future, int priority);
+
+//Report the pool's statistics, in the format of priority-stats.h
+void future_pool_report(const char * name);
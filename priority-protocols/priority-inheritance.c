@@ -8,6 +8,7 @@
 
 #include "priority-protocols.h"
 #include "notification-manager.h"
+#include "priority-log.h"
 
 #include <camkes.h>
 #include <camkes/tls.h>
@@ -28,14 +29,13 @@ void priority_inheritance_init(struct Priority_Protocol * info,
 
         //Set pointer to function-scope static Priority_Inheritance object
         info->pip = lock;
+        info->num_domains = 1;
 
         //Initialize fields of Priority_Inheritance object
         lock->locked = false;
         lock->num_threads = num_threads;
 
-#ifdef DEBUG
-        printf("initialized priority inheritance lock with %d threads\n", num_threads);
-#endif
+        PRIORITY_TRACE(pip_init, num_threads);
 
     }
 }
@@ -58,15 +58,18 @@ void priority_inheritance_enter(int request_priority, struct Priority_Protocol *
         //Allow running thread to inherit waiter's priority
         if(request_priority > lock->inherited_priority) {
             lock->inherited_priority = request_priority;
-#ifdef DEBUG
-            printf("Setting priority of runner TCB %d\n", lock->runner_tcb);
-#endif
+            PRIORITY_TRACE(pip_inherit, lock->runner_tcb, request_priority);
             int error = seL4_TCB_SetPriority(lock->runner_tcb, lock->runner_tcb, request_priority);
             ZF_LOGF_IFERR(error, "Failed to set runner's priority to %d.\n", request_priority);
+            *lock->runner_running = request_priority;
         }
 
-        //Wait on a notification object
-        ntfn_mgr_wait(request_priority, &lock->ntfn_mgr);
+        //Wait on a notification object, at any priority inherited while waiting (see ntfn_mgr_raise)
+        int woken_priority = ntfn_mgr_wait(request_priority, &lock->ntfn_mgr);
+        if (woken_priority > request_priority) {
+            request_priority = woken_priority;
+            set_effective_priority(request_priority);
+        }
 
     }
 
@@ -76,8 +79,10 @@ void priority_inheritance_enter(int request_priority, struct Priority_Protocol *
     //Set the inherited priority and TCB to our parameters
     lock->inherited_priority = request_priority;
     lock->runner_tcb = camkes_get_tls()->tcb_cap;
+    lock->runner_running = running_priority_record();
 
     //Demote priority to run request code
+    priority_mode_demoted(info, true);
     demote_priority(request_priority);
 
     //Component-defined interface function now runs
@@ -94,7 +99,7 @@ void priority_inheritance_enter(int request_priority, struct Priority_Protocol *
 void priority_inheritance_exit(struct Priority_Protocol * info) {
 
     //Promote priority
-    promote_priority(info->priority_ceiling);
+    promote_to_ceiling(info);
 
     //Mark unlocked
     info->pip->locked = false;
@@ -104,3 +109,157 @@ void priority_inheritance_exit(struct Priority_Protocol * info) {
 
     //Reply and wait implicit after function return
 }
+
+
+/*
+    priority_inheritance_raise_request
+
+    Raises a request that is waiting for, or holds, the lock
+    to a priority inherited from outside the lock,
+    e.g., from requests attached to it (see request-coalescing.h).
+    Runs at the ceiling priority, as does priority_inheritance_enter.
+*/
+void priority_inheritance_raise_request(struct Priority_Protocol * info, seL4_CPtr tcb, int priority) {
+
+    struct Priority_Inheritance * lock = info->pip;
+
+    //The request holds the lock, and inherits the priority directly
+    if (lock->locked && lock->runner_tcb == tcb) {
+        if (priority > (int) lock->inherited_priority) {
+            lock->inherited_priority = priority;
+            PRIORITY_TRACE(pip_inherit, tcb, priority);
+            int error = seL4_TCB_SetPriority(tcb, tcb, priority);
+            ZF_LOGF_IFERR(error, "Failed to set runner's priority to %d.\n", priority);
+            *lock->runner_running = priority;
+        }
+        return;
+    }
+
+    /*
+        The request is waiting for the lock: it is woken earlier,
+        and the lock's holder, if any, inherits its priority
+        (once the lock is released, runner_tcb no longer holds it)
+    */
+    if (ntfn_mgr_raise(&lock->ntfn_mgr, tcb, priority) && lock->locked &&
+            priority > (int) lock->inherited_priority) {
+        lock->inherited_priority = priority;
+        PRIORITY_TRACE(pip_inherit, lock->runner_tcb, priority);
+        int error = seL4_TCB_SetPriority(lock->runner_tcb, lock->runner_tcb, priority);
+        ZF_LOGF_IFERR(error, "Failed to set runner's priority to %d.\n", priority);
+        *lock->runner_running = priority;
+    }
+
+    //Otherwise, the request has yet to enter the lock
+}
+
+
+
+/*
+    Lock domains
+*/
+
+//The domains held by this thread
+static __thread struct Priority_Inheritance_Holder holder;
+
+void priority_inheritance_domains_init(struct Priority_Protocol * info,
+        struct Priority_Inheritance * locks, unsigned num_domains, unsigned num_threads) {
+
+    //Only run on first thread
+    if(!locks[0].initialized) {
+
+        for (unsigned i = 0; i < num_domains; i++) {
+            locks[i].initialized = true;
+            locks[i].locked = false;
+            locks[i].num_threads = num_threads;
+            locks[i].holder = NULL;
+        }
+
+        //Set pointer to function-scope static array of Priority_Inheritance objects
+        info->pip = locks;
+        info->num_domains = num_domains;
+    }
+}
+
+//Raise the holder of a domain, and transitively the holders of the domains they wait for
+static void priority_inheritance_raise(struct Priority_Inheritance * lock, int priority) {
+
+    while (lock && priority > lock->holder->priority) {
+
+        struct Priority_Inheritance_Holder * runner = lock->holder;
+        runner->priority = priority;
+
+        //A waiting holder stays at the ceiling, and demotes to its inherited priority once it runs
+        if (!runner->waiting_on) {
+            int error = seL4_TCB_SetPriority(runner->tcb, runner->tcb, priority);
+            ZF_LOGF_IFERR(error, "Failed to set runner's priority to %d.\n", priority);
+            *runner->running = priority;
+        }
+
+        //Until then, it is woken ahead of the lower-priority waiters of the domain it waits for
+        else {
+            ntfn_mgr_raise(&runner->waiting_on->ntfn_mgr, runner->tcb, priority);
+        }
+
+        lock = runner->waiting_on;
+    }
+}
+
+void priority_inheritance_enter_domains(int request_priority, struct Priority_Protocol * info, unsigned domains) {
+
+    holder.tcb = camkes_get_tls()->tcb_cap;
+    holder.running = running_priority_record();
+    holder.priority = request_priority;
+    holder.domains = domains;
+    holder.waiting_on = NULL;
+
+    //Acquire domains in ascending order
+    for (unsigned i = 0; i < info->num_domains; i++) {
+
+        if (!(domains & (1u << i))) continue;
+        struct Priority_Inheritance * lock = &info->pip[i];
+
+        //As for a single lock, when we wake up, the domain is guaranteed to be available
+        if (lock->locked) {
+            holder.waiting_on = lock;
+            priority_inheritance_raise(lock, holder.priority);
+            int woken_priority = ntfn_mgr_wait(holder.priority, &lock->ntfn_mgr);
+            holder.waiting_on = NULL;
+
+            //We may have inherited a priority while we waited
+            if (woken_priority > holder.priority) {
+                holder.priority = woken_priority;
+            }
+        }
+
+        lock->locked = true;
+        lock->holder = &holder;
+    }
+
+    //Nested requests carry any priority inherited while acquiring, as for a single lock
+    if (holder.priority > request_priority) {
+        set_effective_priority(holder.priority);
+    }
+
+    //Demote priority to run request code, at any priority inherited while acquiring
+    priority_mode_demoted(info, true);
+    demote_priority(holder.priority);
+
+    //Component-defined interface function now runs
+}
+
+void priority_inheritance_exit_domains(struct Priority_Protocol * info) {
+
+    //Promote priority
+    promote_to_ceiling(info);
+
+    //Release and signal waiters on each domain
+    for (unsigned i = 0; i < info->num_domains; i++) {
+        if (!(holder.domains & (1u << i))) continue;
+        info->pip[i].locked = false;
+        info->pip[i].holder = NULL;
+        ntfn_mgr_signal(&info->pip[i].ntfn_mgr);
+    }
+    holder.domains = 0;
+
+    //Reply and wait implicit after function return
+}
\ No newline at end of file
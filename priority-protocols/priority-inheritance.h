@@ -13,13 +13,39 @@
 #include <camkes.h>
 #include <sel4/sel4.h>
 
+struct Priority_Inheritance_Holder;
+
 struct Priority_Inheritance {
     bool locked;
     bool initialized;
     seL4_Word inherited_priority;
     seL4_CPtr runner_tcb;
+    int * runner_running;
     struct Notification_Manager ntfn_mgr;
     unsigned num_threads;
+
+    //With multiple lock domains, the thread holding this domain
+    struct Priority_Inheritance_Holder * holder;
+};
+
+/*
+    A thread holding one or more lock domains.
+
+    A request may need several domains of an interface,
+    which it acquires in ascending order, so that requests cannot deadlock.
+    While it waits for a domain, it holds the lower ones,
+    so inheritance is transitive: a waiter raises the holder of its domain,
+    and if that holder is itself waiting, the holder of the domain it waits for, and so on.
+    Only threads not waiting are reprioritized, since waiters wait at the ceiling;
+    a waiter is instead raised in the queue of the domain it waits for, so it is woken earlier,
+    and its inherited priority takes effect once it has acquired all its domains.
+*/
+struct Priority_Inheritance_Holder {
+    seL4_CPtr tcb;
+    int * running;
+    int priority;
+    unsigned domains;
+    struct Priority_Inheritance * waiting_on;
 };
 
 /*
@@ -40,6 +66,21 @@ struct Priority_Inheritance {
 void priority_inheritance_init(struct Priority_Protocol * info,
         struct Priority_Inheritance * lock, unsigned num_threads);
 
+/*
+    Priority Inheritance Domains Init
+
+    Likewise allocates a static array of Priority_Inheritance objects,
+    one per lock domain of an interface.
+    Each domain's Notification_Manager is initialized separately.
+*/
+#define PRIORITY_INHERITANCE_DOMAINS_INIT(PRIORITY_PROTOCOL_PTR, NUM_DOMAINS, NUM_THREADS) \
+    static struct Priority_Inheritance locks[NUM_DOMAINS]; \
+    priority_inheritance_domains_init(PRIORITY_PROTOCOL_PTR, \
+            locks, NUM_DOMAINS, NUM_THREADS);
+
+void priority_inheritance_domains_init(struct Priority_Protocol * info,
+        struct Priority_Inheritance * locks, unsigned num_domains, unsigned num_threads);
+
 /*
     Enter and Exit functions,
     which should run at the beginning and end of the interface handler function,
@@ -48,4 +89,16 @@ void priority_inheritance_init(struct Priority_Protocol * info,
 */
 void priority_inheritance_enter(int priority, struct Priority_Protocol * info);
 
-void priority_inheritance_exit(struct Priority_Protocol * info);
\ No newline at end of file
+void priority_inheritance_exit(struct Priority_Protocol * info);
+
+/*
+    Raise the request of the given thread, waiting for or holding the lock, to the given priority,
+    as if a waiter of that priority had arrived.
+    For interfaces with a single lock only.
+*/
+void priority_inheritance_raise_request(struct Priority_Protocol * info, seL4_CPtr tcb, int priority);
+
+//Likewise, for the domains in the given mask (bit i for domain i)
+void priority_inheritance_enter_domains(int priority, struct Priority_Protocol * info, unsigned domains);
+
+void priority_inheritance_exit_domains(struct Priority_Protocol * info);
\ No newline at end of file
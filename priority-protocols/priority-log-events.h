@@ -0,0 +1,31 @@
+/*
+
+    priority-log-events.h
+
+    The catalog of events for deferred logging (see priority-log.h).
+
+    Each event is declared as PRIORITY_LOG_EVENT(name, format),
+    and this file is included wherever the catalog is needed, with PRIORITY_LOG_EVENT defined,
+    so it has no include guard.
+    Events are identified by their position in the catalog,
+    so new events must be appended, and the host decoder (priority-logger/priority-log-decode.py)
+    must be given the same catalog files, in the same order.
+
+    Arguments are logged as 64-bit integers,
+    so formats must use only 64-bit integer conversions (%lld, %llu, %llx),
+    and at most PRIORITY_LOG_MAX_ARGS of them.
+
+    An application appends its own events by defining PRIORITY_LOG_USER_EVENTS
+    as the name of its own catalog file, e.g.:
+
+        -DPRIORITY_LOG_USER_EVENTS=\"task-log-events.h\"
+*/
+
+//Priority protocols library
+PRIORITY_LOG_EVENT(set_priority, "Setting priority to %lld")
+PRIORITY_LOG_EVENT(pip_init, "initialized priority inheritance lock with %lld threads")
+PRIORITY_LOG_EVENT(pip_inherit, "Setting priority of runner TCB %llu to %lld")
+
+#ifdef PRIORITY_LOG_USER_EVENTS
+#include PRIORITY_LOG_USER_EVENTS
+#endif
@@ -0,0 +1,152 @@
+/*
+
+    priority-log.c
+
+    The implementation of deferred, priority-tagged logging
+
+*/
+
+#include "priority-log.h"
+#include "priority-clock.h"
+#include "priority-context.h"
+
+#include <camkes.h>
+#include <string.h>
+
+
+//This component's view of the log dataport
+static struct Priority_Log priority_log;
+
+//The calling thread's ring, claimed on its first record
+static __thread struct Priority_Log_Ring * thread_ring = NULL;
+static __thread bool thread_unclaimed = false;
+
+static const char * const event_names[] = {
+#define PRIORITY_LOG_EVENT(NAME, FORMAT) #NAME,
+#include "priority-log-events.h"
+#undef PRIORITY_LOG_EVENT
+};
+
+static const char * const event_formats[] = {
+#define PRIORITY_LOG_EVENT(NAME, FORMAT) FORMAT,
+#include "priority-log-events.h"
+#undef PRIORITY_LOG_EVENT
+};
+
+
+void priority_log_init(void * dataport, size_t size) {
+
+    //Only run on first thread
+    if(!priority_log.initialized) {
+        priority_log.initialized = true;
+        priority_log.shared = dataport;
+        priority_log.rings = (struct Priority_Log_Ring *) (priority_log.shared + 1);
+        priority_log.num_rings = (size - sizeof(struct Priority_Log_Shared)) / sizeof(struct Priority_Log_Ring);
+
+        //Keeps the frequency of any other priority_clock_init, before or after
+        priority_clock_init(0);
+    }
+}
+
+//Claim a ring for the calling thread, or NULL if every ring is claimed
+static struct Priority_Log_Ring * claim_ring(void) {
+
+    uint32_t index = __atomic_fetch_add(&priority_log.shared->next_ring, 1, __ATOMIC_RELAXED);
+    if(index >= priority_log.num_rings) {
+        thread_unclaimed = true;
+        return NULL;
+    }
+
+    struct Priority_Log_Ring * ring = &priority_log.rings[index];
+    strncpy(ring->owner, get_instance_name(), PRIORITY_LOG_OWNER_SIZE - 1);
+
+    //Publish the owner before the logger reads the ring
+    __atomic_store_n(&ring->claimed, 1, __ATOMIC_RELEASE);
+    return ring;
+}
+
+void priority_log_write(unsigned event, unsigned num_args,
+        uint64_t arg0, uint64_t arg1, uint64_t arg2, uint64_t arg3) {
+
+    //Logging is disabled until the component binds its dataport
+    if(!priority_log.initialized) return;
+
+    if(!thread_ring && !thread_unclaimed) thread_ring = claim_ring();
+    if(!thread_ring) {
+        __atomic_fetch_add(&priority_log.shared->unclaimed_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    struct Priority_Log_Ring * ring = thread_ring;
+
+    //Only this thread writes head, so it is read without ordering
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    //Never wait for the logger; drop the record instead
+    if(head - tail >= PRIORITY_LOG_RING_RECORDS) {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    struct Priority_Log_Record * record = &ring->records[head % PRIORITY_LOG_RING_RECORDS];
+    record->timestamp = priority_clock_cycles();
+    record->event = event;
+    record->priority = get_effective_priority();
+    record->num_args = num_args;
+    record->args[0] = arg0;
+    record->args[1] = arg1;
+    record->args[2] = arg2;
+    record->args[3] = arg3;
+
+    //Publish the record to the logger
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+unsigned priority_log_drain(priority_log_handler_t handler) {
+
+    if(!priority_log.initialized) return 0;
+
+    unsigned drained = 0;
+    unsigned num_rings = __atomic_load_n(&priority_log.shared->next_ring, __ATOMIC_RELAXED);
+    if(num_rings > priority_log.num_rings) num_rings = priority_log.num_rings;
+
+    for(unsigned i = 0; i < num_rings; ++i) {
+
+        struct Priority_Log_Ring * ring = &priority_log.rings[i];
+
+        //The ring's index is taken before its owner is published
+        if(!__atomic_load_n(&ring->claimed, __ATOMIC_ACQUIRE)) continue;
+
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint32_t tail = ring->tail;
+        for(; tail != head; ++tail, ++drained) {
+            handler(i, ring->owner, &ring->records[tail % PRIORITY_LOG_RING_RECORDS], 0);
+        }
+
+        //Return the slots to the producer
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+        uint32_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if(dropped != ring->reported) {
+            handler(i, ring->owner, NULL, dropped - ring->reported);
+            ring->reported = dropped;
+        }
+    }
+
+    struct Priority_Log_Shared * shared = priority_log.shared;
+    uint32_t dropped = __atomic_load_n(&shared->unclaimed_dropped, __ATOMIC_RELAXED);
+    if(dropped != shared->unclaimed_reported) {
+        handler(priority_log.num_rings, NULL, NULL, dropped - shared->unclaimed_reported);
+        shared->unclaimed_reported = dropped;
+    }
+
+    return drained;
+}
+
+const char * priority_log_event_name(unsigned event) {
+    return event < priority_log_num_events ? event_names[event] : NULL;
+}
+
+const char * priority_log_event_format(unsigned event) {
+    return event < priority_log_num_events ? event_formats[event] : NULL;
+}
@@ -0,0 +1,161 @@
+/*
+
+    priority-log.h
+
+    Deferred, priority-tagged logging, to keep formatting and serial output
+    out of the critical path of high-priority threads.
+
+    Instead of formatting a message, a thread writes a compact binary record
+    (a cycle counter timestamp, its effective priority, an event identifier and up to 4 integer arguments)
+    into its own ring within a dataport shared with a PriorityLogger component (see priority-logger).
+    The logger runs at the lowest priority, and drains, formats and prints the records.
+
+    Each ring has a single producer (its thread) and a single consumer (the logger),
+    so writing a record is lock-free and wait-free:
+    the producer only advances the ring's head, and the logger its tail.
+    A record written to a full ring is dropped and counted, rather than blocking the thread.
+    Threads claim rings on their first record with an atomic increment,
+    as threads of different components share the dataport.
+    Every component computes the same layout from the dataport's size,
+    and a zero-filled dataport is a valid, empty log, so no component initializes it.
+
+    Events are declared in the catalog of priority-log-events.h, and logged by name:
+
+        PRIORITY_LOG(pip_inherit, tcb, priority);
+
+    The library's own trace points use PRIORITY_TRACE, which logs if PRIORITY_LOG_TRACE is defined,
+    otherwise prints the event directly in DEBUG builds (as the library did before),
+    and otherwise compiles to nothing.
+*/
+
+#pragma once
+
+#include <camkes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define PRIORITY_LOG_MAX_ARGS 4
+
+//Records per ring, a power of two
+#ifndef PRIORITY_LOG_RING_RECORDS
+#define PRIORITY_LOG_RING_RECORDS 64
+#endif
+
+#define PRIORITY_LOG_OWNER_SIZE 24
+
+//Default size of the log dataport, in bytes
+#ifndef PRIORITY_LOG_SIZE
+#define PRIORITY_LOG_SIZE 65536
+#endif
+
+//Event identifiers, in catalog order
+enum priority_log_events {
+#define PRIORITY_LOG_EVENT(NAME, FORMAT) priority_log_##NAME,
+#include "priority-log-events.h"
+#undef PRIORITY_LOG_EVENT
+    priority_log_num_events
+};
+
+/*
+    A binary record, little-endian on every target we support.
+    The host decoder reads the same layout.
+*/
+struct Priority_Log_Record {
+    uint64_t timestamp;
+    uint16_t event;
+    int16_t priority;
+    uint8_t num_args;
+    uint8_t reserved[3];
+    uint64_t args[PRIORITY_LOG_MAX_ARGS];
+};
+
+/*
+    A thread's ring.
+    The producer writes owner, claimed, head and dropped;
+    the logger writes tail and reported.
+*/
+struct Priority_Log_Ring {
+    uint32_t claimed;
+    uint32_t head;
+    uint32_t dropped;
+    uint32_t tail;
+    uint32_t reported;
+    uint32_t reserved;
+    char owner[PRIORITY_LOG_OWNER_SIZE];
+    struct Priority_Log_Record records[PRIORITY_LOG_RING_RECORDS];
+};
+
+/*
+    Header of the dataport, followed by the rings.
+    Records of threads that find every ring claimed are dropped and counted.
+*/
+struct Priority_Log_Shared {
+    uint32_t next_ring;
+    uint32_t unclaimed_dropped;
+    uint32_t unclaimed_reported;
+    uint32_t reserved;
+};
+
+//Each component's view of the log
+struct Priority_Log {
+    bool initialized;
+    struct Priority_Log_Shared * shared;
+    struct Priority_Log_Ring * rings;
+    unsigned num_rings;
+};
+
+/*
+    Bind this component's log to its dataport, from any thread before it logs.
+    Records are timestamped with the cycle counter (see priority-clock.h).
+*/
+void priority_log_init(void * dataport, size_t size);
+
+//Write a record to the calling thread's ring; use PRIORITY_LOG instead
+void priority_log_write(unsigned event, unsigned num_args,
+        uint64_t arg0, uint64_t arg1, uint64_t arg2, uint64_t arg3);
+
+//Count (up to 4) and pad the arguments of PRIORITY_LOG
+#define PRIORITY_LOG_NARGS(...) PRIORITY_LOG_NARGS_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define PRIORITY_LOG_NARGS_(Z, A, B, C, D, N, ...) N
+#define PRIORITY_LOG_ARGS(...) PRIORITY_LOG_ARGS_(__VA_ARGS__ + 0, 0, 0, 0, 0)
+#define PRIORITY_LOG_ARGS_(A, B, C, D, ...) (uint64_t) (A), (uint64_t) (B), (uint64_t) (C), (uint64_t) (D)
+
+#define PRIORITY_LOG(EVENT, ...) \
+    priority_log_write(priority_log_##EVENT, PRIORITY_LOG_NARGS(__VA_ARGS__), PRIORITY_LOG_ARGS(__VA_ARGS__))
+
+/*
+    Logger: drain every ring, calling the handler for each record, oldest first within each ring,
+    and for each ring's newly dropped records (with a NULL record).
+    Records dropped because every ring was claimed are reported with a NULL owner.
+    Returns the number of records drained.
+*/
+typedef void (*priority_log_handler_t)(unsigned ring, const char * owner,
+        const struct Priority_Log_Record * record, uint32_t dropped);
+unsigned priority_log_drain(priority_log_handler_t handler);
+
+//Logger: name and format of an event, NULL if it is not in the catalog
+const char * priority_log_event_name(unsigned event);
+const char * priority_log_event_format(unsigned event);
+
+//Trace points of the priority protocols library
+#if defined(PRIORITY_LOG_TRACE)
+
+#define PRIORITY_TRACE(EVENT, ...) PRIORITY_LOG(EVENT, ##__VA_ARGS__)
+
+#elif defined(DEBUG)
+
+static const char * const priority_trace_formats[] = {
+#define PRIORITY_LOG_EVENT(NAME, FORMAT) FORMAT "\n",
+#include "priority-log-events.h"
+#undef PRIORITY_LOG_EVENT
+};
+
+#define PRIORITY_TRACE(EVENT, ...) \
+    printf(priority_trace_formats[priority_log_##EVENT], PRIORITY_LOG_ARGS(__VA_ARGS__))
+
+#else
+
+#define PRIORITY_TRACE(EVENT, ...)
+
+#endif
@@ -8,16 +8,21 @@
         Non-Preemptive Critical Sections
         Immediate Priority Ceiling Protocol
         Priority Inheritance Protocol
+        Preemption Thresholds
     Additionally implements all protocols besides PIP
 
 */
 
 #include "priority-protocols.h"
 #include "priority-inheritance.h"
+#include "priority-log.h"
+#include "priority-stats.h"
 
 #include <camkes.h>
 #include <camkes/tls.h>
 #include <sel4utils/sel4_zf_logif.h>
+#include <utils/page.h>
+#include <utils/util.h>
 
 
 //Initialize a Priority_Protocol structure
@@ -29,18 +34,196 @@ void priority_protocol_init(struct Priority_Protocol * info,
         info->initialized = true;
         info->priority_protocol = priority_protocol;
         info->priority_ceiling = priority;
+        info->pending_ceiling = PRIORITY_CONTEXT_UNSET;
     }
 }
 
+//Set the preemption threshold of a Priority_Protocol structure
+void priority_threshold_init(struct Priority_Protocol * info, int threshold) {
+    info->priority_threshold = threshold;
+}
+
+//Report a CPI's statistics
+void priority_protocol_report(struct Priority_Protocol * info, const char * name) {
+
+    static const char * protocol_names[] = {"propagated", "inherited", "fixed", "threshold"};
+
+    PRIORITY_STATS_PRINT("cpi", name, "protocol=%s,ceiling=%d,requests=%llu,in_flight=%u,max_in_flight=%u",
+            protocol_names[info->priority_protocol], info->priority_ceiling,
+            info->requests, info->in_flight, info->max_in_flight);
+}
+
+//Report a CPI's resource high-water marks
+void priority_sizing_report(struct Priority_Protocol * info, const char * name,
+        unsigned num_threads, size_t stack_size, size_t max_stack_used) {
+
+    unsigned max_waiters = 0;
+    if (info->priority_protocol == inherited) {
+        for (unsigned i = 0; i < info->num_domains; i++) {
+            max_waiters = MAX(max_waiters, info->pip[i].ntfn_mgr.max_waiters);
+        }
+    }
+
+    PRIORITY_STATS_PRINT("sizing", name,
+            "num_threads=%u,max_busy=%u,max_in_flight=%u,max_waiters=%u,suggested_num_threads=%u",
+            num_threads, info->max_busy, info->max_in_flight, max_waiters, MAX(info->max_busy, 1u));
+
+    //Suggest a quarter again of the deepest stack use, in whole pages
+    if (max_stack_used) {
+        PRIORITY_STATS_PRINT("sizing", name, "stack_size=%lu,max_stack_used=%lu,suggested_stack_size=%lu",
+                (unsigned long) stack_size, (unsigned long) max_stack_used,
+                (unsigned long) ROUND_UP_UNSAFE(max_stack_used + max_stack_used / 4, PAGE_SIZE_4K));
+    }
+}
+
+//The priority this thread runs at, once set (see get_running_priority)
+static __thread int running_priority = PRIORITY_CONTEXT_UNSET;
+
+int get_running_priority(void) {
+    return running_priority;
+}
+
+int * running_priority_record(void) {
+    return &running_priority;
+}
+
+void priority_busy_begin(struct Priority_Protocol * info) {
+    info->busy++;
+    if (info->busy > info->max_busy) {
+        info->max_busy = info->busy;
+    }
+}
+
+void priority_busy_end(struct Priority_Protocol * info) {
+    info->busy--;
+}
+
 //Sets the caller's priority
 void set_priority(int priority) {
 
-#ifdef DEBUG
-    printf("Setting priority to %d\n", priority);
-#endif
+    PRIORITY_TRACE(set_priority, priority);
     seL4_CPtr tcb = camkes_get_tls()->tcb_cap;
     int error = seL4_TCB_SetPriority(tcb,tcb,priority);
     ZF_LOGF_IFERR(error, "Failed to set priority to %d.\n", priority);
+    running_priority = priority;
+}
+
+
+/*
+    Mode changes
+*/
+
+//This thread's registration, if its CPI supports mode changes
+static __thread struct Priority_Thread * registered_thread = NULL;
+
+void priority_mode_init(struct Priority_Protocol * info,
+        struct Priority_Thread * threads, unsigned num_threads) {
+
+    //Only run on first thread
+    if(!info->threads) {
+        info->threads = threads;
+        info->num_threads = num_threads;
+        info->num_registered = 0;
+        info->in_flight = 0;
+    }
+}
+
+/*
+    Threadpool threads register as they start, at the ceiling priority,
+    so the registry is not manipulated concurrently
+*/
+void priority_mode_register(struct Priority_Protocol * info) {
+
+    if (!info->threads) return;
+
+    ZF_LOGF_IF(info->num_registered == info->num_threads, "Too many threads registered for mode changes.\n");
+
+    registered_thread = &info->threads[info->num_registered++];
+    registered_thread->tcb = camkes_get_tls()->tcb_cap;
+    registered_thread->running = running_priority_record();
+    registered_thread->demoted = false;
+}
+
+void priority_mode_demoted(struct Priority_Protocol * info, bool demoted) {
+    if (info->threads && registered_thread) {
+        registered_thread->demoted = demoted;
+    }
+}
+
+//Apply a new ceiling to the CPI and every thread not demoted into a request
+static void priority_mode_apply(struct Priority_Protocol * info, int ceiling) {
+
+    info->priority_ceiling = ceiling;
+    info->pending_ceiling = PRIORITY_CONTEXT_UNSET;
+
+    for (unsigned i = 0; i < info->num_registered; i++) {
+        if (!info->threads[i].demoted) {
+            seL4_CPtr tcb = info->threads[i].tcb;
+            int error = seL4_TCB_SetPriority(tcb, tcb, ceiling);
+            ZF_LOGF_IFERR(error, "Failed to set threadpool thread's priority to %d.\n", ceiling);
+            *info->threads[i].running = ceiling;
+        }
+    }
+}
+
+//Record the epoch in which the calling threadpool thread's request enters the CPI
+static void priority_mode_entered(struct Priority_Protocol * info) {
+    if (info->threads && registered_thread) {
+        registered_thread->epoch = info->mode_epoch;
+    }
+}
+
+/*
+    A request of an earlier epoch than a pending lowered ceiling is one it waits for.
+    The last of them to leave applies the ceiling.
+*/
+static void priority_mode_left(struct Priority_Protocol * info) {
+    if (info->pending_ceiling != PRIORITY_CONTEXT_UNSET && registered_thread &&
+            registered_thread->epoch != info->mode_epoch && !--info->pending_requests) {
+        priority_mode_apply(info, info->pending_ceiling);
+    }
+}
+
+void priority_mode_change(struct Priority_Protocol * info, int ceiling, int priority) {
+
+    //Return to the priority we run at, which may be inherited mid-request, rather than a request priority
+    int running = get_running_priority();
+    if (running == PRIORITY_CONTEXT_UNSET) {
+        running = priority;
+    }
+
+    //A threadpool thread of this CPI at its ceiling moves to the new ceiling with the others
+    bool at_ceiling = registered_thread && !registered_thread->demoted &&
+            registered_thread >= info->threads && registered_thread < info->threads + info->num_registered;
+
+    //Run above both ceilings, so no threadpool thread runs until the change is complete
+    int highest = ceiling > info->priority_ceiling ? ceiling : info->priority_ceiling;
+    promote_priority(highest > running ? highest : running);
+
+    //Raise immediately, or lower once the requests now in flight have completed
+    info->mode_epoch++;
+    if (ceiling >= info->priority_ceiling || !info->in_flight) {
+        priority_mode_apply(info, ceiling);
+    }
+    else {
+        info->pending_ceiling = ceiling;
+        info->pending_requests = info->in_flight;
+    }
+
+    demote_priority(at_ceiling ? info->priority_ceiling : running);
+}
+
+void promote_to_ceiling(struct Priority_Protocol * info) {
+
+    //Mark not demoted first, so that a concurrent mode change either raises us,
+    //or changes the ceiling before we read it
+    priority_mode_demoted(info, false);
+
+    int ceiling;
+    do {
+        ceiling = info->priority_ceiling;
+        promote_priority(ceiling);
+    } while (ceiling != info->priority_ceiling);
 }
 
 /*
@@ -49,28 +232,94 @@ void set_priority(int priority) {
     These call different functions depending on the protocol used.
 */
 
+void priority_pre_domains(int request_priority, struct Priority_Protocol * info, unsigned domains) {
+
+    if (info->priority_protocol == inherited && info->num_domains > 1) {
+
+        info->requests++;
+        info->in_flight++;
+        if (info->in_flight > info->max_in_flight) {
+            info->max_in_flight = info->in_flight;
+        }
+        priority_mode_entered(info);
+
+        //Nested requests carry the request priority
+        set_effective_priority(request_priority);
+
+        //Enter priority inheritance on each of the request's domains
+        priority_inheritance_enter_domains(request_priority, info, domains);
+    }
+
+    else {
+        priority_pre(request_priority, info);
+    }
+}
+
 void priority_pre(int request_priority, struct Priority_Protocol * info) {
+
+    //Requests in flight defer lowering the ceiling
+    info->requests++;
+    info->in_flight++;
+    if (info->in_flight > info->max_in_flight) {
+        info->max_in_flight = info->in_flight;
+    }
+    priority_mode_entered(info);
+
     if (info->priority_protocol == propagated) {
+        //Nested requests carry the request priority
+        set_effective_priority(request_priority);
+
         //Demote to request priority
+        priority_mode_demoted(info, true);
         demote_priority(request_priority);
     }
 
     else if (info->priority_protocol == inherited) {
+        //Nested requests carry the request priority
+        set_effective_priority(request_priority);
+
         //Enter priority inheritance
         priority_inheritance_enter(request_priority, info);
     }
 
-    //Fixed priority is a no-op
+    else if (info->priority_protocol == threshold) {
+        int running_priority = request_priority > info->priority_threshold ?
+                request_priority : info->priority_threshold;
+
+        //Nested requests carry the priority the request runs at
+        set_effective_priority(running_priority);
+
+        //Dispatch at the request priority, so that any higher-priority thread runs first
+        priority_mode_demoted(info, true);
+        demote_priority(request_priority);
+
+        //Then run the request at the threshold
+        if (running_priority != request_priority) {
+            promote_priority(running_priority);
+        }
+    }
+
+    //Fixed priority does not change the thread's priority
     else {
-        return;
+        //Nested requests carry the priority assigned to the CPI
+        set_effective_priority(info->priority_ceiling);
     }
 
 }
 
 void priority_post(struct Priority_Protocol * info) {
-    if (info->priority_protocol == propagated) {
+
+    //Any further requests from this thread are at the priority assigned to the CPI
+    set_effective_priority(info->priority_ceiling);
+
+    if (info->priority_protocol == propagated || info->priority_protocol == threshold) {
         //Promote back to original HLP
-        promote_priority(info->priority_ceiling);
+        promote_to_ceiling(info);
+    }
+
+    else if (info->priority_protocol == inherited && info->num_domains > 1) {
+        //Leave priority inheritance on each of the request's domains
+        priority_inheritance_exit_domains(info);
     }
 
     else if (info->priority_protocol == inherited) {
@@ -78,8 +327,9 @@ void priority_post(struct Priority_Protocol * info) {
         priority_inheritance_exit(info);
     }
 
-    //Fixed priority is a no-op
-    else {
-        return;
-    }
+    //Fixed priority does not change the thread's priority
+
+    //The last request in flight at a mode change applies any ceiling it deferred
+    info->in_flight--;
+    priority_mode_left(info);
 }
\ No newline at end of file
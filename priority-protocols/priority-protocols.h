@@ -14,20 +14,56 @@
 
 #pragma once
 
+#include "priority-context.h"
+
 #include <camkes.h>
 
 //These are the priority protocols we support
 enum priority_protocols {
     propagated,
     inherited,
-    fixed
+    fixed,
+    threshold
+};
+
+//A threadpool thread, registered so that mode changes can reprioritize it
+struct Priority_Thread {
+    seL4_CPtr tcb;
+    int * running;
+    bool demoted;
+
+    //The mode change epoch in which the thread's current request entered the CPI
+    unsigned epoch;
 };
 
 struct Priority_Protocol {
     bool initialized;
     int priority_protocol;
     int priority_ceiling;
+    int priority_threshold;
+
+    //Under PIP, an array of num_domains locks (see priority-inheritance.h)
     struct Priority_Inheritance * pip;
+    unsigned num_domains;
+
+    //Mode changes, enabled by PRIORITY_MODE_INIT
+    struct Priority_Thread * threads;
+    unsigned num_threads;
+    unsigned num_registered;
+    unsigned in_flight;
+    int pending_ceiling;
+
+    //Each mode change begins an epoch, and a lowered ceiling waits for the requests of earlier epochs
+    unsigned mode_epoch;
+    unsigned pending_requests;
+
+    //Statistics
+    unsigned long long requests;
+    unsigned max_in_flight;
+
+    //Threadpool threads busy from receiving a request until replying, for sizing
+    unsigned busy;
+    unsigned max_busy;
 };
 
 #include "priority-inheritance.h"
@@ -36,6 +72,45 @@ struct Priority_Protocol {
 void priority_protocol_init(struct Priority_Protocol * info,
         int priority_protocol, int priority);
 
+/*
+    Set the preemption threshold of a Priority_Protocol structure using the threshold protocol.
+
+    Under the threshold protocol, a request is dispatched at its own priority,
+    as for priority propagation,
+    but once it begins executing it is raised to the CPI's threshold (if below it),
+    a priority between those of its requests and the ceiling.
+    Requests can then only be preempted by threads above the threshold,
+    which gives fewer context switches than propagation,
+    and less blocking than a fixed priority for threads above the threshold.
+*/
+void priority_threshold_init(struct Priority_Protocol * info, int threshold);
+
+//Report a CPI's statistics, in the format of priority-stats.h
+void priority_protocol_report(struct Priority_Protocol * info, const char * name);
+
+/*
+    Count a threadpool thread busy from receiving (or resuming) a request until it replies to it,
+    or returns to receive after failing it.
+    This includes requests that never enter the priority protocol
+    (e.g., answered from the memo cache, or attached to a coalesced request),
+    which hold a threadpool thread all the same.
+    Runs at the ceiling priority, as do priority_pre and priority_post.
+*/
+void priority_busy_begin(struct Priority_Protocol * info);
+void priority_busy_end(struct Priority_Protocol * info);
+
+/*
+    Report a CPI's resource high-water marks, with the sizes they suggest for the assembly:
+    the peak number of busy threadpool threads (see priority_busy_begin),
+    and of requests in flight (from priority_pre to priority_post),
+    the peak number of threads waiting in the PIP lock's Notification Managers,
+    and, if measured (max_stack_used is nonzero), the deepest stack use of its threadpool threads
+    (see stack-watermark.h).
+    These are the peaks observed so far, not bounds.
+*/
+void priority_sizing_report(struct Priority_Protocol * info, const char * name,
+        unsigned num_threads, size_t stack_size, size_t max_stack_used);
+
 
 /*
     Note that currently, promote_priority and demote_priority
@@ -48,6 +123,16 @@ void priority_protocol_init(struct Priority_Protocol * info,
 //Sets the caller's priority
 void set_priority(int priority);
 
+/*
+    The priority the calling thread runs at, as last set by set_priority,
+    or by another thread through the thread's running priority record (e.g., as it inherits a waiter's priority),
+    or PRIORITY_CONTEXT_UNSET if neither has set it
+*/
+int get_running_priority(void);
+
+//The calling thread's running priority record, for the threads that reprioritize it to keep up to date
+int * running_priority_record(void);
+
 //Demotes the caller's priority
 static inline void demote_priority(int priority) {
     set_priority(priority);
@@ -59,6 +144,63 @@ static inline void promote_priority(int original_priority) {
 }
 
 
+/*
+    Mode changes
+
+    A CPI's ceiling is the highest priority of any request it may receive,
+    which can differ between a system's operating modes.
+    Rather than configuring a CPI for the union of all modes,
+    its ceiling can be changed at runtime with priority_mode_change,
+    following the ceiling rules of mode change protocols for the priority ceiling protocol:
+
+        * Raising a ceiling takes effect immediately.
+          Every registered threadpool thread not demoted into a request
+          (i.e., waiting for a request, waiting on the PIP lock, or running at the ceiling under "fixed")
+          is raised to the new ceiling,
+          and threads in a request return to the new ceiling when it completes.
+
+        * Lowering a ceiling is deferred until every request in flight at the time of the change
+          has completed, since those requests may rely on the old ceiling.
+          The last of them to complete then applies it.
+          Requests arriving after the change (at the priorities of the new mode) do not defer it further,
+          so the transition completes within the longest remaining response time
+          of the requests in flight when it was made, even if the CPI is never quiescent.
+
+    The ceiling is only manipulated at (or above) the ceiling,
+    so changes are atomic with respect to the threadpool.
+*/
+
+/*
+    Mode Init
+
+    Allocates a static array to register each threadpool thread.
+    Even though it's in the init function scope,
+    we access it through the pointer in the Priority_Protocol object.
+*/
+#define PRIORITY_MODE_INIT(PRIORITY_PROTOCOL_PTR, NUM_THREADS) \
+    static struct Priority_Thread threads[NUM_THREADS]; \
+    priority_mode_init(PRIORITY_PROTOCOL_PTR, threads, NUM_THREADS);
+
+void priority_mode_init(struct Priority_Protocol * info,
+        struct Priority_Thread * threads, unsigned num_threads);
+
+//Register the calling threadpool thread, before it first waits for a request
+void priority_mode_register(struct Priority_Protocol * info);
+
+//Record whether the calling threadpool thread is demoted below the ceiling
+void priority_mode_demoted(struct Priority_Protocol * info, bool demoted);
+
+/*
+    Change the CPI's ceiling, from a thread of the same component,
+    which returns to the priority it runs at (see get_running_priority),
+    including any it inherited, or to the given priority if that was never set
+*/
+void priority_mode_change(struct Priority_Protocol * info, int ceiling, int priority);
+
+//Promote a threadpool thread back to the CPI's ceiling, which may change concurrently
+void promote_to_ceiling(struct Priority_Protocol * info);
+
+
 /*
     Pre and Post functions,
     which should run at the beginning and end of the interface handler function.
@@ -66,4 +208,11 @@ static inline void promote_priority(int original_priority) {
 */
 void priority_pre(int request_priority, struct Priority_Protocol * info);
 
+/*
+    Under PIP with multiple lock domains,
+    enters only the domains in the given mask (bit i for domain i).
+    Equivalent to priority_pre otherwise.
+*/
+void priority_pre_domains(int request_priority, struct Priority_Protocol * info, unsigned domains);
+
 void priority_post(struct Priority_Protocol * info);
\ No newline at end of file
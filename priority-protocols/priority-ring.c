@@ -0,0 +1,253 @@
+/*
+
+    priority-ring.c
+
+    The implementation of the priority-ordered ring buffer.
+    See priority-ring.h for more details.
+
+*/
+
+#include "priority-ring.h"
+#include "priority-protocols.h"
+
+#include <camkes.h>
+#include <sel4utils/sel4_zf_logif.h>
+#include <string.h>
+
+#define PRIORITY_RING_MAGIC 0x52494e47
+
+static size_t align_up(size_t offset, size_t align) {
+    return (offset + align - 1) / align * align;
+}
+
+//Bind a statically-configured Priority_Ring to its dataport
+void priority_ring_init(struct Priority_Ring * ring, void * dataport, size_t size) {
+
+    //Only run on first thread
+    if(!ring->initialized) {
+
+        ring->initialized = true;
+
+        unsigned num_waiters = ring->num_producers + ring->num_consumers;
+        unsigned char * base = dataport;
+        size_t offset = sizeof(struct Priority_Ring_Shared);
+
+        //Lay out the shared state, identically in every component
+        ring->shared = (struct Priority_Ring_Shared *) base;
+        ring->lengths = (uint32_t *) (base + offset);
+        offset += ring->num_slots * sizeof(uint32_t);
+        ring->free_next = (uint32_t *) (base + offset);
+        offset += ring->num_slots * sizeof(uint32_t);
+        offset = align_up(offset, sizeof(uint64_t));
+        ring->queue = (struct Priority_Ring_Entry *) (base + offset);
+        offset += ring->num_slots * sizeof(struct Priority_Ring_Entry);
+        ring->producers = (struct Priority_Ring_Entry *) (base + offset);
+        offset += num_waiters * sizeof(struct Priority_Ring_Entry);
+        ring->consumers = (struct Priority_Ring_Entry *) (base + offset);
+        offset += num_waiters * sizeof(struct Priority_Ring_Entry);
+        ring->handoffs = (struct Priority_Ring_Handoff *) (base + offset);
+        offset += num_waiters * sizeof(struct Priority_Ring_Handoff);
+        offset = align_up(offset, PRIORITY_RING_ALIGN);
+        ring->slots = base + offset;
+        offset += (size_t) ring->num_slots * ring->slot_size;
+
+        ZF_LOGF_IF(offset > size, "Priority ring of %u slots of %u bytes needs %zu bytes, dataport has %zu.\n",
+                ring->num_slots, ring->slot_size, offset, size);
+    }
+}
+
+/*
+    Shared state is initialized by whichever component first uses the ring,
+    as no component's initialization is ordered before another's.
+    Called at the ceiling priority.
+*/
+static void priority_ring_prepare(struct Priority_Ring * ring) {
+
+    struct Priority_Ring_Shared * shared = ring->shared;
+    if (shared->magic == PRIORITY_RING_MAGIC) return;
+
+    //All slots start on the free list
+    for (unsigned i = 0; i < ring->num_slots; i++) {
+        ring->free_next[i] = i + 1 < ring->num_slots ? i + 1 : PRIORITY_RING_NONE;
+    }
+    shared->free_head = 0;
+    shared->num_queued = 0;
+    shared->num_waiting_producers = 0;
+    shared->num_waiting_consumers = 0;
+    shared->insert_order = 0;
+    shared->magic = PRIORITY_RING_MAGIC;
+}
+
+
+/*
+    Priority queues of entries, implemented as binary max-heaps,
+    ordered by priority, with ties broken by earliest insertion
+*/
+
+static bool entry_greater_than(struct Priority_Ring_Entry * lhs, struct Priority_Ring_Entry * rhs) {
+    if (lhs->priority != rhs->priority) return lhs->priority > rhs->priority;
+    return lhs->order < rhs->order;
+}
+
+static void heap_push(struct Priority_Ring_Entry * heap, uint32_t * size, struct Priority_Ring_Entry entry) {
+    uint32_t i = (*size)++;
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (!entry_greater_than(&entry, &heap[parent])) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = entry;
+}
+
+static struct Priority_Ring_Entry heap_pop(struct Priority_Ring_Entry * heap, uint32_t * size) {
+    struct Priority_Ring_Entry head = heap[0];
+    struct Priority_Ring_Entry last = heap[--(*size)];
+    uint32_t i = 0;
+    while (2 * i + 1 < *size) {
+        uint32_t child = 2 * i + 1;
+        if (child + 1 < *size && entry_greater_than(&heap[child + 1], &heap[child])) {
+            child++;
+        }
+        if (!entry_greater_than(&heap[child], &last)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (*size) heap[i] = last;
+    return head;
+}
+
+//Block a waiter in priority order, returning what is handed off to it
+static struct Priority_Ring_Handoff ring_wait(struct Priority_Ring * ring, struct Priority_Ring_Entry * heap,
+        uint32_t * size, unsigned waiter, int priority) {
+
+    struct Priority_Ring_Entry entry = {
+        .priority = (uint32_t) priority,
+        .index = waiter,
+        .order = ring->shared->insert_order++
+    };
+    heap_push(heap, size, entry);
+
+    //Wait at the ceiling, as for the Notification Manager
+    seL4_Wait(ring->ntfns[waiter], NULL);
+
+    return ring->handoffs[waiter];
+}
+
+//Hand off to the highest-priority waiter
+static void ring_signal(struct Priority_Ring * ring, struct Priority_Ring_Entry * heap,
+        uint32_t * size, uint32_t slot, uint32_t priority) {
+
+    unsigned waiter = heap_pop(heap, size).index;
+    ring->handoffs[waiter].slot = slot;
+    ring->handoffs[waiter].priority = priority;
+    seL4_Signal(ring->ntfns[waiter]);
+}
+
+static uint32_t slot_index(struct Priority_Ring * ring, void * slot) {
+    return (uint32_t) (((unsigned char *) slot - ring->slots) / ring->slot_size);
+}
+
+
+/*
+    Producers
+*/
+
+void * priority_ring_reserve(struct Priority_Ring * ring, unsigned producer, int priority) {
+
+    struct Priority_Ring_Shared * shared = ring->shared;
+    uint32_t slot;
+
+    promote_priority(ring->ceiling);
+    priority_ring_prepare(ring);
+
+    if (shared->free_head != PRIORITY_RING_NONE) {
+        slot = shared->free_head;
+        shared->free_head = ring->free_next[slot];
+    }
+    else {
+        //The consumer releasing a slot hands it off to us
+        slot = ring_wait(ring, ring->producers, &shared->num_waiting_producers, producer, priority).slot;
+    }
+
+    demote_priority(priority);
+
+    return ring->slots + (size_t) slot * ring->slot_size;
+}
+
+void priority_ring_commit(struct Priority_Ring * ring, void * slot, size_t length, int priority) {
+
+    struct Priority_Ring_Shared * shared = ring->shared;
+    uint32_t index = slot_index(ring, slot);
+
+    ZF_LOGF_IF(length > ring->slot_size, "Priority ring message of %zu bytes exceeds slot size %u.\n",
+            length, ring->slot_size);
+
+    promote_priority(ring->ceiling);
+
+    ring->lengths[index] = (uint32_t) length;
+
+    //A waiting consumer means no message is queued, so hand this one off directly
+    if (shared->num_waiting_consumers) {
+        ring_signal(ring, ring->consumers, &shared->num_waiting_consumers, index, (uint32_t) priority);
+    }
+    else {
+        struct Priority_Ring_Entry entry = {
+            .priority = (uint32_t) priority,
+            .index = index,
+            .order = shared->insert_order++
+        };
+        heap_push(ring->queue, &shared->num_queued, entry);
+    }
+
+    demote_priority(priority);
+}
+
+
+/*
+    Consumers
+*/
+
+void priority_ring_dispatch(struct Priority_Ring * ring, unsigned consumer,
+        void (*handle)(void * data, size_t length)) {
+
+    struct Priority_Ring_Shared * shared = ring->shared;
+    uint32_t slot;
+    int priority;
+
+    //Threadpool threads run at the ceiling outside of the handler
+    priority_ring_prepare(ring);
+
+    if (shared->num_queued) {
+        struct Priority_Ring_Entry entry = heap_pop(ring->queue, &shared->num_queued);
+        slot = entry.index;
+        priority = (int) entry.priority;
+    }
+    else {
+        //The producer committing a message hands it off to us
+        struct Priority_Ring_Handoff handoff = ring_wait(ring, ring->consumers, &shared->num_waiting_consumers,
+                ring->num_producers + consumer, ring->ceiling);
+        slot = handoff.slot;
+        priority = (int) handoff.priority;
+    }
+
+    unsigned char * data = ring->slots + (size_t) slot * ring->slot_size;
+
+    //Handle the message at its priority, as for priority propagation
+    set_effective_priority(priority);
+    demote_priority(priority);
+
+    handle(data, ring->lengths[slot]);
+
+    promote_priority(ring->ceiling);
+    set_effective_priority(ring->ceiling);
+
+    //Release the slot, handing it off to the highest-priority waiting producer if any
+    if (shared->num_waiting_producers) {
+        ring_signal(ring, ring->producers, &shared->num_waiting_producers, slot, 0);
+    }
+    else {
+        ring->free_next[slot] = shared->free_head;
+        shared->free_head = slot;
+    }
+}
@@ -0,0 +1,124 @@
+/*
+
+    priority-ring.h
+
+    A priority-ordered ring buffer in a shared dataport,
+    for the seL4PriorityRing connectors.
+
+    Dataports give zero-copy bulk transfer between components,
+    but signalling over them is ad hoc and has none of our priority semantics.
+    A Priority_Ring divides a dataport into fixed-size slots:
+
+        * A producer reserves a free slot, writes its message in place,
+          then commits it tagged with its (effective) priority.
+
+        * A threadpool of consumer threads takes committed messages highest-priority first
+          (ties broken by commit order),
+          and handles each at its message's priority, as for priority propagation.
+          Once the handler returns, the slot is released back to the producers.
+
+    A producer reserving a slot while all are in use, or a consumer taking a message while none are committed,
+    blocks in priority order (ties broken by arrival),
+    and the freed slot or committed message is handed off directly to the woken thread.
+    Each waiter blocks on its own notification object,
+    which, like the Notification Manager, gives priority-ordered wakeups on the non-MCS kernel.
+
+    The ring's state lives in the dataport itself, shared by every component on the connection,
+    so it is addressed by indices rather than pointers,
+    and each component keeps its own CPtrs to the waiters' notification objects.
+    As for our CPIs, it is manipulated by threads running at the ring's ceiling
+    (the consumer threadpool's priority, above every producer),
+    so on a uniprocessor no atomic lock is needed.
+
+    Each producing component is a single waiter,
+    so only one of its threads may send on a given ring at a time.
+*/
+
+#pragma once
+
+#include <camkes.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PRIORITY_RING_NONE UINT32_MAX
+
+//Alignment of each slot within the dataport
+#define PRIORITY_RING_ALIGN 64
+
+//A priority-ordered entry, for the message queue and the waiter queues
+struct Priority_Ring_Entry {
+    uint32_t priority;
+    uint32_t index;
+    uint64_t order;
+};
+
+//A slot handed off to a waiter, with its message's priority for consumers
+struct Priority_Ring_Handoff {
+    uint32_t slot;
+    uint32_t priority;
+};
+
+/*
+    Header of the shared state, at the start of the dataport. It is followed by:
+        uint32_t lengths[num_slots]
+        uint32_t free_next[num_slots]
+        struct Priority_Ring_Entry queue[num_slots]
+        struct Priority_Ring_Entry producers[num_waiters]
+        struct Priority_Ring_Entry consumers[num_waiters]
+        struct Priority_Ring_Handoff handoffs[num_waiters]
+        the slots, each slot_size bytes, aligned to PRIORITY_RING_ALIGN
+*/
+struct Priority_Ring_Shared {
+    uint32_t magic;
+    uint32_t free_head;
+    uint32_t num_queued;
+    uint32_t num_waiting_producers;
+    uint32_t num_waiting_consumers;
+    uint32_t reserved;
+    uint64_t insert_order;
+};
+
+//Each component's view of a ring
+struct Priority_Ring {
+
+    bool initialized;
+
+    //Configuration, assigned statically by the connector template
+    int ceiling;
+    unsigned num_slots;
+    unsigned slot_size;
+    unsigned num_producers;
+    unsigned num_consumers;
+
+    //This component's CPtrs to each waiter's notification object, 0 if it has none;
+    //producers are waiters 0 to num_producers - 1, followed by consumers
+    seL4_CPtr * ntfns;
+
+    //Shared state within the dataport
+    struct Priority_Ring_Shared * shared;
+    uint32_t * lengths;
+    uint32_t * free_next;
+    struct Priority_Ring_Entry * queue;
+    struct Priority_Ring_Entry * producers;
+    struct Priority_Ring_Entry * consumers;
+    struct Priority_Ring_Handoff * handoffs;
+    unsigned char * slots;
+
+};
+
+//Bind a statically-configured Priority_Ring to its dataport
+void priority_ring_init(struct Priority_Ring * ring, void * dataport, size_t size);
+
+//Producer: reserve a free slot, blocking if none is free, and return its buffer
+void * priority_ring_reserve(struct Priority_Ring * ring, unsigned producer, int priority);
+
+//Producer: commit a message written to a reserved slot, at the given priority
+void priority_ring_commit(struct Priority_Ring * ring, void * slot, size_t length, int priority);
+
+/*
+    Consumer threadpool thread: take the highest-priority message, blocking if none is committed,
+    handle it at its priority, then release its slot.
+    Called in a loop by each threadpool thread, which waits at the ceiling priority.
+*/
+void priority_ring_dispatch(struct Priority_Ring * ring, unsigned consumer,
+        void (*handle)(void * data, size_t length));
@@ -0,0 +1,22 @@
+/*
+
+    priority-stats.h
+
+    A common, machine-readable format for the statistics kept by the priority protocols library
+    (CPIs, their result caches and admission control, and periodic tasks),
+    so that each component can report them to the console alongside each other.
+
+    Each statistic source is reported as a single line of comma-separated fields:
+
+        priority-stats,<component instance>,<kind>,<name>,<key>=<value>,...
+
+    Lines can be selected from the console output with grep "^priority-stats,".
+*/
+
+#pragma once
+
+#include <camkes.h>
+#include <stdio.h>
+
+#define PRIORITY_STATS_PRINT(KIND, NAME, FORMAT, ...) \
+    printf("priority-stats,%s,%s,%s," FORMAT "\n", get_instance_name(), KIND, NAME, __VA_ARGS__)
@@ -0,0 +1,207 @@
+/*
+
+    priority-sync.c
+
+    The implementation of priority-aware synchronization
+    between the threads of a single component.
+    See priority-sync.h for more details.
+
+*/
+
+#include "priority-sync.h"
+#include "priority-protocols.h"
+#include "notification-manager.h"
+
+#include <camkes.h>
+#include <camkes/tls.h>
+#include <sel4utils/sel4_zf_logif.h>
+
+
+//Initialize a PIP_Mutex
+void pip_mutex_init(struct PIP_Mutex * mutex, int ceiling) {
+
+    //Only run on first thread
+    if(!mutex->initialized) {
+        mutex->initialized = true;
+        mutex->locked = false;
+        mutex->ceiling = ceiling;
+    }
+}
+
+//Initialize an IPCP_Mutex
+void ipcp_mutex_init(struct IPCP_Mutex * mutex, int ceiling) {
+
+    //Only run on first thread
+    if(!mutex->initialized) {
+        mutex->initialized = true;
+        mutex->locked = false;
+        mutex->ceiling = ceiling;
+    }
+}
+
+//Initialize a Priority_Semaphore
+void priority_semaphore_init(struct Priority_Semaphore * sem, int ceiling, unsigned count) {
+
+    //Only run on first thread
+    if(!sem->initialized) {
+        sem->initialized = true;
+        sem->ceiling = ceiling;
+        sem->count = count;
+    }
+}
+
+//Initialize a Priority_Condition
+void priority_condition_init(struct Priority_Condition * cond, int ceiling) {
+
+    //Only run on first thread
+    if(!cond->initialized) {
+        cond->initialized = true;
+        cond->ceiling = ceiling;
+    }
+}
+
+
+/*
+    PIP mutex
+
+    The acquire and release functions assume the caller already runs at (or above) the ceiling.
+*/
+
+static void pip_mutex_acquire(struct PIP_Mutex * mutex, int priority) {
+
+    if(mutex->locked) {
+
+        //Allow the owner to inherit our priority
+        if(priority > mutex->inherited_priority) {
+            mutex->inherited_priority = priority;
+            int error = seL4_TCB_SetPriority(mutex->owner_tcb, mutex->owner_tcb, priority);
+            ZF_LOGF_IFERR(error, "Failed to set mutex owner's priority to %d.\n", priority);
+            *mutex->owner_running = priority;
+        }
+
+        //Wait for ownership to be handed off to us
+        ntfn_mgr_wait_handoff(priority, &mutex->ntfn_mgr);
+    }
+
+    //We own the mutex
+    mutex->locked = true;
+    mutex->owner_priority = priority;
+    mutex->inherited_priority = priority;
+    mutex->owner_tcb = camkes_get_tls()->tcb_cap;
+    mutex->owner_running = running_priority_record();
+}
+
+static void pip_mutex_release(struct PIP_Mutex * mutex) {
+
+    //Hand off to the highest-priority waiter, if any, otherwise unlock
+    if(!ntfn_mgr_signal_handoff(&mutex->ntfn_mgr)) {
+        mutex->locked = false;
+    }
+}
+
+void pip_mutex_lock(struct PIP_Mutex * mutex, int priority) {
+    promote_priority(mutex->ceiling);
+    pip_mutex_acquire(mutex, priority);
+    demote_priority(priority);
+}
+
+void pip_mutex_unlock(struct PIP_Mutex * mutex) {
+
+    //Our priority without any inherited priority
+    int priority = mutex->owner_priority;
+
+    promote_priority(mutex->ceiling);
+    pip_mutex_release(mutex);
+    demote_priority(priority);
+}
+
+
+/*
+    IPCP mutex
+
+    The owner runs at the ceiling for the duration of its critical section,
+    so on a uniprocessor the mutex is only found locked
+    if its owner blocked within the critical section.
+*/
+
+void ipcp_mutex_lock(struct IPCP_Mutex * mutex, int priority) {
+    promote_priority(mutex->ceiling);
+
+    if(mutex->locked) {
+        ntfn_mgr_wait_handoff(priority, &mutex->ntfn_mgr);
+    }
+
+    mutex->locked = true;
+    mutex->owner_priority = priority;
+
+    //Remain at the ceiling until unlocked
+}
+
+void ipcp_mutex_unlock(struct IPCP_Mutex * mutex) {
+    int priority = mutex->owner_priority;
+
+    if(!ntfn_mgr_signal_handoff(&mutex->ntfn_mgr)) {
+        mutex->locked = false;
+    }
+
+    demote_priority(priority);
+}
+
+
+/*
+    Counting semaphore
+*/
+
+void priority_semaphore_wait(struct Priority_Semaphore * sem, int priority) {
+    promote_priority(sem->ceiling);
+
+    if(sem->count) {
+        sem->count--;
+    }
+    else {
+        //The posting thread hands its unit directly to us
+        ntfn_mgr_wait_handoff(priority, &sem->ntfn_mgr);
+    }
+
+    demote_priority(priority);
+}
+
+void priority_semaphore_post(struct Priority_Semaphore * sem, int priority) {
+    promote_priority(sem->ceiling);
+
+    if(!ntfn_mgr_signal_handoff(&sem->ntfn_mgr)) {
+        sem->count++;
+    }
+
+    demote_priority(priority);
+}
+
+
+/*
+    Condition variable
+*/
+
+void priority_condition_wait(struct Priority_Condition * cond, struct PIP_Mutex * mutex, int priority) {
+    promote_priority(cond->ceiling);
+
+    //Release the mutex and wait, with no preemption in between
+    pip_mutex_release(mutex);
+    ntfn_mgr_wait_handoff(priority, &cond->ntfn_mgr);
+
+    //Reacquire the mutex before returning
+    pip_mutex_acquire(mutex, priority);
+
+    demote_priority(priority);
+}
+
+void priority_condition_signal(struct Priority_Condition * cond, int priority) {
+    promote_priority(cond->ceiling);
+    ntfn_mgr_signal_handoff(&cond->ntfn_mgr);
+    demote_priority(priority);
+}
+
+void priority_condition_broadcast(struct Priority_Condition * cond, int priority) {
+    promote_priority(cond->ceiling);
+    while(ntfn_mgr_signal_handoff(&cond->ntfn_mgr));
+    demote_priority(priority);
+}
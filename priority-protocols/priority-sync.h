@@ -0,0 +1,100 @@
+/*
+
+    priority-sync.h
+
+    Priority-aware synchronization between the threads of a single component.
+
+    Our priority protocols are otherwise only reachable through a request to a CPI,
+    so protecting state shared by the threads of one component costs a full IPC round trip.
+    This library provides the same protocols directly:
+
+        * PIP_Mutex: a mutex implementing the Priority Inheritance Protocol
+        * IPCP_Mutex: a mutex implementing the Immediate Priority Ceiling Protocol
+        * Priority_Semaphore: a counting semaphore
+        * Priority_Condition: a condition variable, used with a PIP_Mutex
+
+    Blocked threads wait on a Notification Manager,
+    so they are woken in order of priority (ties broken by arrival),
+    and ownership (or a semaphore unit) is handed off directly to the woken thread.
+
+    Each object has a ceiling: the highest priority of any thread that uses it, plus one,
+    following the priority laddering scheme (see the README).
+    As for our CPIs, each operation manipulates the object's state at its ceiling,
+    so no atomic lock is needed.
+
+    Since a thread's own priority is not readable from seL4,
+    each operation takes the caller's priority,
+    which the caller returns to when the operation completes.
+    Nested PIP_Mutexes are not supported, as for PIP CPIs.
+
+    Objects are declared and initialized from CAmkES attributes,
+    by the priority-sync.template.c component template;
+    see priority-protocols.camkes.h and the README.
+*/
+
+#pragma once
+
+#include "notification-manager.h"
+
+#include <camkes.h>
+#include <sel4/sel4.h>
+
+struct PIP_Mutex {
+    bool initialized;
+    bool locked;
+    int ceiling;
+    int owner_priority;
+    int inherited_priority;
+    seL4_CPtr owner_tcb;
+    int * owner_running;
+    struct Notification_Manager ntfn_mgr;
+};
+
+struct IPCP_Mutex {
+    bool initialized;
+    bool locked;
+    int ceiling;
+    int owner_priority;
+    struct Notification_Manager ntfn_mgr;
+};
+
+struct Priority_Semaphore {
+    bool initialized;
+    int ceiling;
+    unsigned count;
+    struct Notification_Manager ntfn_mgr;
+};
+
+struct Priority_Condition {
+    bool initialized;
+    int ceiling;
+    struct Notification_Manager ntfn_mgr;
+};
+
+//Initialize each object; the Notification Manager is initialized separately
+void pip_mutex_init(struct PIP_Mutex * mutex, int ceiling);
+void ipcp_mutex_init(struct IPCP_Mutex * mutex, int ceiling);
+void priority_semaphore_init(struct Priority_Semaphore * sem, int ceiling, unsigned count);
+void priority_condition_init(struct Priority_Condition * cond, int ceiling);
+
+//PIP mutex
+void pip_mutex_lock(struct PIP_Mutex * mutex, int priority);
+void pip_mutex_unlock(struct PIP_Mutex * mutex);
+
+//IPCP mutex
+void ipcp_mutex_lock(struct IPCP_Mutex * mutex, int priority);
+void ipcp_mutex_unlock(struct IPCP_Mutex * mutex);
+
+//Counting semaphore
+void priority_semaphore_wait(struct Priority_Semaphore * sem, int priority);
+void priority_semaphore_post(struct Priority_Semaphore * sem, int priority);
+
+/*
+    Condition variable.
+    The condition's ceiling must be at least the mutex's ceiling.
+    priority_condition_wait must be called with the mutex held,
+    and returns with it held again.
+*/
+void priority_condition_wait(struct Priority_Condition * cond, struct PIP_Mutex * mutex, int priority);
+void priority_condition_signal(struct Priority_Condition * cond, int priority);
+void priority_condition_broadcast(struct Priority_Condition * cond, int priority);
@@ -0,0 +1,62 @@
+/*
+
+    release-schedule.c
+
+    The implementation of the ReleaseServer's release schedule.
+    See release-schedule.h for more details.
+
+*/
+
+#include "release-schedule.h"
+#include "priority-stats.h"
+
+#include <camkes.h>
+
+
+void release_schedule_init(struct Release_Entry * entries, unsigned num_entries, uint64_t start) {
+    for (unsigned i = 0; i < num_entries; i++) {
+        entries[i].next_release = start + entries[i].offset_ns;
+        entries[i].released = 0;
+        entries[i].skipped = 0;
+    }
+}
+
+uint64_t release_schedule_dispatch(struct Release_Entry * entries, unsigned num_entries,
+        uint64_t now, uint64_t batch_window_ns) {
+
+    uint64_t horizon = now + batch_window_ns;
+    uint64_t next = UINT64_MAX;
+
+    //Entries are sorted by descending priority
+    for (unsigned i = 0; i < num_entries; i++) {
+
+        struct Release_Entry * entry = &entries[i];
+
+        if (entry->next_release <= horizon) {
+
+            seL4_Signal(entry->ntfn);
+            entry->released++;
+            entry->next_release += entry->period_ns;
+
+            //Skip releases that have already passed
+            while (entry->period_ns && entry->next_release <= now) {
+                entry->next_release += entry->period_ns;
+                entry->skipped++;
+            }
+        }
+
+        if (entry->next_release < next) {
+            next = entry->next_release;
+        }
+    }
+
+    return next;
+}
+
+void release_schedule_report(struct Release_Entry * entries, unsigned num_entries) {
+    for (unsigned i = 0; i < num_entries; i++) {
+        PRIORITY_STATS_PRINT("release", entries[i].name, "priority=%d,period_us=%llu,released=%llu,skipped=%llu",
+                entries[i].priority, (unsigned long long) (entries[i].period_ns / 1000),
+                entries[i].released, entries[i].skipped);
+    }
+}
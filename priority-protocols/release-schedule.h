@@ -0,0 +1,56 @@
+/*
+
+    release-schedule.h
+
+    The release schedule of the ReleaseServer component (see priority-release-server),
+    which releases periodic tasks on behalf of a timer component.
+
+    Each task is released by signalling its notification object every period, from its offset.
+    The ReleaseServer sets a single timeout for the earliest release,
+    and when it expires, releases every task due within a batch window
+    in one pass, highest-priority first.
+    Coincident (or nearly coincident) releases therefore cost a single timer interrupt and wakeup,
+    rather than one each in timer order,
+    and tasks are made ready in priority order,
+    so equal-priority tasks are queued in a deterministic order.
+    A task may be released up to the batch window early.
+
+    Entries are generated by the seL4PriorityRelease from-template,
+    sorted by descending priority.
+*/
+
+#pragma once
+
+#include <camkes.h>
+#include <sel4/sel4.h>
+#include <stdint.h>
+
+struct Release_Entry {
+    const char * name;
+    int priority;
+    uint64_t period_ns;
+    uint64_t offset_ns;
+    seL4_CPtr ntfn;
+
+    //Time of the next release
+    uint64_t next_release;
+
+    //Statistics
+    unsigned long long released;
+    unsigned long long skipped;
+};
+
+//Schedule each entry's first release, at its offset from the start time
+void release_schedule_init(struct Release_Entry * entries, unsigned num_entries, uint64_t start);
+
+/*
+    Release every entry due by now plus the batch window, highest-priority first,
+    and return the time of the next release.
+    Releases already passed by more than a period (e.g., if the ReleaseServer was delayed) are skipped,
+    as a notification object would coalesce them.
+*/
+uint64_t release_schedule_dispatch(struct Release_Entry * entries, unsigned num_entries,
+        uint64_t now, uint64_t batch_window_ns);
+
+//Report each entry's statistics, in the format of priority-stats.h
+void release_schedule_report(struct Release_Entry * entries, unsigned num_entries);
@@ -0,0 +1,88 @@
+/*
+
+    replica-routing.c
+
+    The implementation of priority-aware routing across replicas of a CPI.
+    See replica-routing.h for more details.
+
+*/
+
+#include "replica-routing.h"
+#include "priority-stats.h"
+
+#include <camkes.h>
+
+
+/*
+    Find the free replica to route a request to:
+    the least-loaded for requests at or above the routing priority, the most-loaded otherwise.
+    Returns num_replicas if no replica is free.
+*/
+static unsigned replica_route_select(struct Replica_Routing * routing, bool least_loaded) {
+
+    unsigned selected = routing->num_replicas;
+    unsigned long selected_load = 0;
+
+    for (unsigned r = 0; r < routing->num_replicas; r++) {
+        unsigned long load = __atomic_load_n(&routing->state->in_flight[r], __ATOMIC_RELAXED);
+        if (load >= routing->num_threads[r]) continue;
+        if (selected == routing->num_replicas ||
+                (least_loaded ? load < selected_load : load > selected_load)) {
+            selected = r;
+            selected_load = load;
+        }
+    }
+
+    return selected;
+}
+
+//Claim a replica for a request of the given priority, returning its index
+unsigned replica_route_acquire(struct Replica_Routing * routing, int priority) {
+
+    bool least_loaded = priority >= routing->routing_priority;
+
+    //Claim a free replica, unless another client claims its last free thread first
+    for (;;) {
+        unsigned r = replica_route_select(routing, least_loaded);
+        if (r == routing->num_replicas) break;
+
+        unsigned long load = __atomic_load_n(&routing->state->in_flight[r], __ATOMIC_RELAXED);
+        while (load < routing->num_threads[r]) {
+            if (__atomic_compare_exchange_n(&routing->state->in_flight[r], &load, load + 1,
+                    false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                __atomic_add_fetch(&routing->routed[r], 1, __ATOMIC_RELAXED);
+                return r;
+            }
+        }
+    }
+
+    //No replica is free, so queue the request at the least-loaded replica
+    unsigned selected = 0;
+    unsigned long selected_load = __atomic_load_n(&routing->state->in_flight[0], __ATOMIC_RELAXED);
+    for (unsigned r = 1; r < routing->num_replicas; r++) {
+        unsigned long load = __atomic_load_n(&routing->state->in_flight[r], __ATOMIC_RELAXED);
+        if (load < selected_load) {
+            selected = r;
+            selected_load = load;
+        }
+    }
+
+    __atomic_add_fetch(&routing->state->in_flight[selected], 1, __ATOMIC_ACQ_REL);
+    __atomic_add_fetch(&routing->routed[selected], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&routing->saturated, 1, __ATOMIC_RELAXED);
+    return selected;
+}
+
+//Release a replica once its reply to a request is received
+void replica_route_release(struct Replica_Routing * routing, unsigned replica) {
+    __atomic_sub_fetch(&routing->state->in_flight[replica], 1, __ATOMIC_ACQ_REL);
+}
+
+//Report the requests this client routed to each replica, named by the interface and the replica's index
+void replica_routing_report(struct Replica_Routing * routing, const char * name) {
+    for (unsigned r = 0; r < routing->num_replicas; r++) {
+        PRIORITY_STATS_PRINT("routing", name, "replica=%u,routed=%llu,in_flight=%lu",
+                r, routing->routed[r], __atomic_load_n(&routing->state->in_flight[r], __ATOMIC_RELAXED));
+    }
+    PRIORITY_STATS_PRINT("routing", name, "saturated=%llu", routing->saturated);
+}
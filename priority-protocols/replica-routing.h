@@ -0,0 +1,72 @@
+/*
+
+    replica-routing.h
+
+    Priority-aware routing of requests across replicas of a stateless CPI.
+
+    A single CPI bounds the throughput of every task sharing it by the size of its threadpool.
+    A stateless CPI can instead be replicated, with each replica in its own component
+    (possibly with its threads on a different core),
+    behind a routed connector (seL4RPCCallPrioritizedRouted) that dispatches each request to one replica.
+    Each replica receives on its own endpoint, and runs its own priority protocol as any other CPI,
+    with requests carrying their priority in the first message register as usual.
+
+    The clients of a routed connection share the number of requests in flight at each replica
+    (those sent and not yet answered) in a page shared by every client,
+    so they are claimed and released atomically.
+    A replica is free while it has fewer requests in flight than threads in its pool,
+    so a request sent to it is received at once, rather than queued at its endpoint.
+
+    A request is routed to a free replica by its priority:
+
+        * Requests at or above the connection's routing priority (by default, all requests)
+          are sent to the least-loaded free replica,
+          so they are received as soon as possible, and share their replica with as few others as possible.
+
+        * Requests below the routing priority are packed onto the most-loaded free replica,
+          keeping the least-loaded replicas for higher-priority requests.
+
+    If no replica is free, the request is sent to the least-loaded replica,
+    where it waits at the replica's endpoint for a thread of its pool.
+*/
+
+#pragma once
+
+#include <camkes.h>
+
+//Maximum number of replicas behind a routed connection
+#ifndef REPLICA_ROUTING_MAX
+#define REPLICA_ROUTING_MAX 64
+#endif
+
+//State shared by the clients of a routed connection
+struct Replica_Routing_State {
+    unsigned long in_flight[REPLICA_ROUTING_MAX];
+};
+
+struct Replica_Routing {
+
+    //Shared state, in a page shared by the clients of the connection
+    struct Replica_Routing_State * state;
+
+    //Number of replicas, and the threadpool size of each
+    unsigned num_replicas;
+    const unsigned * num_threads;
+
+    //Lowest priority of requests routed to the least-loaded free replica
+    int routing_priority;
+
+    //Requests sent by this client to each replica, and those sent with no replica free
+    unsigned long long * routed;
+    unsigned long long saturated;
+
+};
+
+//Claim a replica for a request of the given priority, returning its index
+unsigned replica_route_acquire(struct Replica_Routing * routing, int priority);
+
+//Release a replica once its reply to a request is received
+void replica_route_release(struct Replica_Routing * routing, unsigned replica);
+
+//Report the requests this client routed to each replica (see priority-stats.h)
+void replica_routing_report(struct Replica_Routing * routing, const char * name);
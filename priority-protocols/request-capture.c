@@ -0,0 +1,105 @@
+/*
+
+    request-capture.c
+
+    The implementation of request capture.
+    See request-capture.h for more details.
+
+*/
+
+#include "request-capture.h"
+#include "priority-stats.h"
+
+#include <camkes.h>
+#include <stdio.h>
+#include <string.h>
+#include <utils/util.h>
+
+
+void request_capture_init(struct Request_Capture * capture, void * dataport, size_t size) {
+
+    //Only run on first thread
+    if(!capture->initialized) {
+        capture->initialized = true;
+        capture->log = dataport;
+        capture->capacity = size - sizeof(struct Request_Capture_Log);
+        capture->enabled = true;
+    }
+}
+
+void request_capture_enable(struct Request_Capture * capture, bool enabled) {
+    capture->enabled = enabled;
+}
+
+void request_capture_record(struct Request_Capture * capture,
+        seL4_Word badge, unsigned method, int priority, uint64_t arrival,
+        const void * payload, unsigned length) {
+
+    if(!capture->enabled) return;
+
+    //Claim space for the record, even if it does not fit, so later requests are also dropped
+    uint32_t record_size = ROUND_UP_UNSAFE(sizeof(struct Request_Capture_Record) + length, 8);
+    uint32_t offset = __atomic_fetch_add(&capture->log->used, record_size, __ATOMIC_RELAXED);
+    if(offset + record_size > capture->capacity || offset + record_size < offset) {
+        __atomic_fetch_add(&capture->log->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    struct Request_Capture_Record * record =
+        (struct Request_Capture_Record *) ((uint8_t *) (capture->log + 1) + offset);
+    record->arrival = arrival;
+    record->badge = badge;
+    record->method = method;
+    record->priority = priority;
+    record->length = length;
+    memcpy(record->payload, payload, length);
+
+    __atomic_store_n(&record->complete, 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&capture->log->records, 1, __ATOMIC_RELAXED);
+}
+
+void request_capture_dump(struct Request_Capture * capture, const char * interface) {
+
+    if(!capture->initialized) return;
+
+    uint32_t used = MIN(__atomic_load_n(&capture->log->used, __ATOMIC_RELAXED), capture->capacity);
+    uint8_t * records = (uint8_t *) (capture->log + 1);
+    bool first = true;
+    uint64_t start = 0;
+
+    for(uint32_t offset = 0; offset + sizeof(struct Request_Capture_Record) <= used; ) {
+
+        struct Request_Capture_Record * record = (struct Request_Capture_Record *) (records + offset);
+        uint32_t record_size = ROUND_UP_UNSAFE(sizeof(struct Request_Capture_Record) + record->length, 8);
+
+        //A record still being written ends the dump
+        if(!__atomic_load_n(&record->complete, __ATOMIC_ACQUIRE)) break;
+
+        if(first) {
+            first = false;
+            start = record->arrival;
+        }
+
+        //Threads may claim space out of order of arrival
+        uint64_t arrival_us = record->arrival > start ?
+            priority_clock_cycles_to_us(record->arrival - start) : 0;
+
+        printf("priority-capture,%s,%s,%llu,%u,%u,%d,", get_instance_name(), interface,
+                (unsigned long long) arrival_us, record->badge, record->method, record->priority);
+        for(uint32_t i = 0; i < record->length; ++i) {
+            printf("%02x", record->payload[i]);
+        }
+        printf("\n");
+
+        offset += record_size;
+    }
+}
+
+void request_capture_report(struct Request_Capture * capture, const char * name) {
+
+    if(!capture->initialized) return;
+
+    PRIORITY_STATS_PRINT("capture", name, "records=%u,dropped=%u,used_bytes=%u,capacity_bytes=%u",
+        capture->log->records, capture->log->dropped,
+        MIN(capture->log->used, (uint32_t) capture->capacity), (unsigned) capture->capacity);
+}
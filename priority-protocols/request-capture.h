@@ -0,0 +1,93 @@
+/*
+
+    request-capture.h
+
+    Capture of a prioritized CPI's request traffic, to replay it offline
+    against a test assembly (see priority-replay).
+
+    The to-template records each request, as it reads the method index,
+    into a log at the start of a dataport of the CPI's component:
+    its arrival time (from the cycle counter, see priority-clock.h),
+    the sending client's badge, the method index, the request priority,
+    and the marshalled method index and parameters, exactly as they follow the priority
+    in the request's message.
+
+    Threadpool threads claim space in the log with an atomic increment,
+    so records appear roughly in order of arrival; the replay tools sort them.
+    Once the log is full, further requests are counted as dropped.
+
+    NAME_capture_dump() prints each record as a single line:
+
+        priority-capture,<instance>,<interface>,<arrival us>,<badge>,<method>,<priority>,<payload hex>
+
+    with arrival times relative to the first captured request,
+    which priority-replay/priority-capture-convert.py turns into a replay trace.
+*/
+
+#pragma once
+
+#include "priority-clock.h"
+
+#include <camkes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//A captured request, padded to a multiple of 8 bytes
+struct Request_Capture_Record {
+    uint64_t arrival;
+    uint32_t badge;
+    uint16_t method;
+    int16_t priority;
+    uint32_t length;
+
+    //Set once the record is written
+    uint32_t complete;
+
+    uint8_t payload[];
+};
+
+//Header of the capture dataport, followed by the records
+struct Request_Capture_Log {
+    uint32_t used;
+    uint32_t records;
+    uint32_t dropped;
+    uint32_t reserved;
+};
+
+struct Request_Capture {
+    bool initialized;
+    bool enabled;
+    struct Request_Capture_Log * log;
+    size_t capacity;
+};
+
+//Bind the capture to its dataport, and start capturing
+void request_capture_init(struct Request_Capture * capture, void * dataport, size_t size);
+
+//Stop or restart capturing
+void request_capture_enable(struct Request_Capture * capture, bool enabled);
+
+//Record a request, called by the to-template
+void request_capture_record(struct Request_Capture * capture,
+        seL4_Word badge, unsigned method, int priority, uint64_t arrival,
+        const void * payload, unsigned length);
+
+//Print every captured record
+void request_capture_dump(struct Request_Capture * capture, const char * interface);
+
+//Report the number of captured and dropped requests, in the format of priority-stats.h
+void request_capture_report(struct Request_Capture * capture, const char * name);
+
+/*
+    A request of a replay trace, as generated by priority-capture-convert.py,
+    sent by a ReplayDriver (see priority-replay)
+*/
+struct Replay_Request {
+    uint64_t arrival_us;
+    seL4_Word badge;
+    unsigned method;
+    int priority;
+    unsigned length;
+    const uint8_t * payload;
+};
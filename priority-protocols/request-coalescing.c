@@ -0,0 +1,164 @@
+/*
+
+    request-coalescing.c
+
+    The implementation of request coalescing for idempotent methods of PIP interfaces.
+    See request-coalescing.h for more details.
+
+*/
+
+#include "request-coalescing.h"
+#include "priority-stats.h"
+
+#include <camkes.h>
+#include <camkes/tls.h>
+#include <sel4utils/sel4_zf_logif.h>
+#include <string.h>
+
+
+//The registered follower of the calling threadpool thread
+static __thread struct Coalescing_Follower * coalescing_follower = NULL;
+
+void request_coalescing_init(struct Request_Coalescing * coalescing, struct Coalesced_Request * requests,
+        struct Coalescing_Follower * followers, seL4_CPtr * ntfn_objs, unsigned num_threads) {
+
+    //Only run on first thread
+    if (!coalescing->initialized) {
+
+        coalescing->initialized = true;
+
+        coalescing->requests = requests;
+        coalescing->followers = followers;
+        coalescing->num_threads = num_threads;
+        coalescing->num_registered = 0;
+
+        // Assign CAmkES-created notification objects
+        for (unsigned i = 0; i < num_threads; i++) {
+            requests[i].in_use = false;
+            followers[i].ntfn_obj = ntfn_objs[i];
+        }
+
+    }
+}
+
+/*
+    Threadpool threads register as they start, at the ceiling priority,
+    so the registry is not manipulated concurrently
+*/
+void request_coalescing_register(struct Request_Coalescing * coalescing) {
+
+    ZF_LOGF_IF(coalescing->num_registered == coalescing->num_threads,
+            "Too many threads registered for request coalescing.\n");
+
+    coalescing_follower = &coalescing->followers[coalescing->num_registered++];
+}
+
+//Find the request in progress matching a tag and key, or NULL if there is none
+struct Coalesced_Request * request_coalescing_find(struct Request_Coalescing * coalescing, unsigned tag,
+        const void * key, unsigned key_len) {
+
+    for (unsigned i = 0; i < coalescing->num_threads; i++) {
+        struct Coalesced_Request * request = &coalescing->requests[i];
+
+        if (request->in_use && request->open && request->tag == tag &&
+                request->key_len == key_len && !memcmp(request->key, key, key_len)) {
+            return request;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+    Each thread leads at most one request at a time,
+    so a request is always free for a thread to lead
+*/
+struct Coalesced_Request * request_coalescing_lead(struct Request_Coalescing * coalescing, unsigned tag,
+        const void * key, unsigned key_len, int priority) {
+
+    for (unsigned i = 0; i < coalescing->num_threads; i++) {
+        struct Coalesced_Request * request = &coalescing->requests[i];
+        if (request->in_use) continue;
+
+        request->in_use = true;
+        request->open = true;
+        request->tag = tag;
+        request->key_len = key_len;
+        memcpy(request->key, key, key_len);
+        request->leader = camkes_get_tls()->tcb_cap;
+        request->priority = priority;
+        request->waiting = NULL;
+        request->num_followers = 0;
+
+        coalescing->led++;
+        return request;
+    }
+
+    ZF_LOGF("No request free to lead for request coalescing.\n");
+    return NULL;
+}
+
+void request_coalescing_complete(struct Coalesced_Request * request, const void * reply, unsigned reply_len) {
+
+    //No further requests may attach
+    request->open = false;
+
+    //Without followers, the request is free at once
+    if (!request->num_followers) {
+        request->in_use = false;
+        return;
+    }
+
+    request->reply_len = reply_len;
+    if (reply_len != UINT_MAX) {
+        memcpy(request->reply, reply, reply_len);
+    }
+
+    //Wake each follower, which runs at the ceiling once we reply and wait
+    while (request->waiting) {
+        seL4_Signal(request->waiting->ntfn_obj);
+        request->waiting = request->waiting->next;
+    }
+}
+
+void request_coalescing_attach(struct Request_Coalescing * coalescing, struct Coalesced_Request * request,
+        int priority, struct Priority_Protocol * info) {
+
+    //The leader inherits our priority, as if we waited for the lock ourselves
+    if (priority > request->priority) {
+        request->priority = priority;
+        priority_inheritance_raise_request(info, request->leader, priority);
+    }
+
+    coalescing_follower->next = request->waiting;
+    request->waiting = coalescing_follower;
+    request->num_followers++;
+
+    coalescing->attached++;
+    if (request->num_followers > coalescing->max_attached) {
+        coalescing->max_attached = request->num_followers;
+    }
+
+    //Wait, at the ceiling, for the leader to complete
+    seL4_Wait(coalescing_follower->ntfn_obj, NULL);
+}
+
+unsigned request_coalescing_reply(struct Coalesced_Request * request, void * reply) {
+
+    unsigned reply_len = request->reply_len;
+    if (reply_len != UINT_MAX) {
+        memcpy(reply, request->reply, reply_len);
+    }
+
+    //The last follower to copy the reply frees the request
+    if (!--request->num_followers) {
+        request->in_use = false;
+    }
+
+    return reply_len;
+}
+
+void request_coalescing_report(struct Request_Coalescing * coalescing, const char * name) {
+    PRIORITY_STATS_PRINT("coalescing", name, "led=%llu,attached=%llu,max_attached=%u",
+            coalescing->led, coalescing->attached, coalescing->max_attached);
+}
@@ -0,0 +1,156 @@
+/*
+
+    request-coalescing.h
+
+    Coalescing of identical concurrent requests to CPI methods declared idempotent,
+    on interfaces using Priority Inheritance Protocol.
+
+    Under PIP, a burst of identical requests (e.g., many clients looking up the same key)
+    each waits for the lock in the Notification_Manager, then runs the procedure in turn,
+    computing the same reply once per request.
+    Instead, the first such request becomes the leader, and handles the request as usual.
+    Any identical request arriving while the leader waits for the lock, or holds it,
+    attaches to the leader rather than waiting for the lock itself,
+    and is sent the leader's reply once the leader completes.
+
+    Requests are identical if they share a tag (distinguishing from-interface types)
+    and their marshalled inputs (the method index followed by its input parameters).
+    Requests with inputs larger than REQUEST_COALESCING_KEY_SIZE are not coalesced.
+    The leader copies its marshalled reply for its followers,
+    so coalescing requires requests and replies to be sent in the IPC buffer.
+
+    The leader inherits the highest priority of the requests attached to it,
+    as if each had waited for the lock itself:
+    if the leader waits for the lock, it is raised in the Notification_Manager's priority queue,
+    and the lock's holder inherits its priority;
+    if the leader holds the lock, it inherits the priority directly
+    (see priority_inheritance_raise_request).
+
+    Followers wait, at the ceiling priority, on a notification object of their own,
+    allocated for each threadpool thread.
+    If the leader fails (e.g., its request cannot be unmarshalled),
+    its followers fail likewise, as their requests are the same.
+
+    Like the Priority_Inheritance lock, coalesced requests are not protected by an atomic lock.
+    They are only accessed by threadpool threads while they run at the ceiling priority,
+    so the same laddering argument applies.
+*/
+
+#pragma once
+
+#include "priority-protocols.h"
+
+#include <camkes.h>
+#include <limits.h>
+#include <stdbool.h>
+
+//Maximum size, in bytes, of the marshalled inputs of a coalesced request
+#ifndef REQUEST_COALESCING_KEY_SIZE
+#define REQUEST_COALESCING_KEY_SIZE 64
+#endif
+
+//Size, in bytes, of the largest reply, sent in the IPC buffer
+#define REQUEST_COALESCING_REPLY_SIZE (seL4_MsgMaxLength * sizeof(seL4_Word))
+
+//A threadpool thread, as it waits attached to a request
+struct Coalescing_Follower {
+    seL4_CPtr ntfn_obj;
+    struct Coalescing_Follower * next;
+};
+
+struct Coalesced_Request {
+
+    //In use until its leader and followers have all replied
+    bool in_use;
+
+    //Accepting followers until its leader completes
+    bool open;
+
+    unsigned tag;
+    unsigned key_len;
+    unsigned char key[REQUEST_COALESCING_KEY_SIZE];
+
+    //The leader's TCB, and the highest priority of the requests attached to it
+    seL4_CPtr leader;
+    int priority;
+
+    //Followers waiting for the reply, and those yet to copy it
+    struct Coalescing_Follower * waiting;
+    unsigned num_followers;
+
+    //The leader's marshalled reply, or UINT_MAX if it failed
+    unsigned reply_len;
+    unsigned char reply[REQUEST_COALESCING_REPLY_SIZE];
+};
+
+struct Request_Coalescing {
+
+    bool initialized;
+
+    //Array of requests, one for each thread that may lead, passed at initialization
+    struct Coalesced_Request * requests;
+
+    //Array of followers, one for each threadpool thread, passed at initialization
+    struct Coalescing_Follower * followers;
+    unsigned num_threads;
+    unsigned num_registered;
+
+    //Statistics
+    unsigned long long led;
+    unsigned long long attached;
+    unsigned max_attached;
+
+};
+
+/*
+    Request Coalescing Init
+
+    Allocates static memory for the requests and followers of NUM_THREADS threadpool threads,
+    with a notification object for each in NTFN_OBJ_ARR.
+    Even though they're in the init function scope,
+    these arrays are accessible through the pointers in the Request_Coalescing object.
+*/
+#define REQUEST_COALESCING_INIT(COALESCING_PTR, NTFN_OBJ_ARR, NUM_THREADS) \
+    static struct Coalesced_Request coalesced_requests[NUM_THREADS]; \
+    static struct Coalescing_Follower coalescing_followers[NUM_THREADS]; \
+    request_coalescing_init(COALESCING_PTR, coalesced_requests, coalescing_followers, \
+            NTFN_OBJ_ARR, NUM_THREADS);
+
+void request_coalescing_init(struct Request_Coalescing * coalescing, struct Coalesced_Request * requests,
+        struct Coalescing_Follower * followers, seL4_CPtr * ntfn_objs, unsigned num_threads);
+
+//Register the calling threadpool thread, before it first receives a request
+void request_coalescing_register(struct Request_Coalescing * coalescing);
+
+//Find the request in progress matching a tag and key, or NULL if there is none
+struct Coalesced_Request * request_coalescing_find(struct Request_Coalescing * coalescing, unsigned tag,
+        const void * key, unsigned key_len);
+
+/*
+    Lead a request with a tag and key, before it enters the priority protocol.
+    Its followers' priorities are inherited from then on.
+*/
+struct Coalesced_Request * request_coalescing_lead(struct Request_Coalescing * coalescing, unsigned tag,
+        const void * key, unsigned key_len, int priority);
+
+/*
+    Complete a request as its leader, after priority_post,
+    sending its marshalled reply (of length UINT_MAX on failure) to its followers
+*/
+void request_coalescing_complete(struct Coalesced_Request * request, const void * reply, unsigned reply_len);
+
+/*
+    Attach to a request in progress, raising its leader to the given priority,
+    and wait for the leader to complete
+*/
+void request_coalescing_attach(struct Request_Coalescing * coalescing, struct Coalesced_Request * request,
+        int priority, struct Priority_Protocol * info);
+
+/*
+    Copy the leader's reply once woken, and detach from the request.
+    Returns the length of the reply, or UINT_MAX if the leader failed.
+*/
+unsigned request_coalescing_reply(struct Coalesced_Request * request, void * reply);
+
+//Report the requests led and attached, in the format of priority-stats.h
+void request_coalescing_report(struct Request_Coalescing * coalescing, const char * name);
@@ -0,0 +1,68 @@
+/*
+
+    stack-watermark.c
+
+    The implementation of stack painting and high-water marks.
+    See stack-watermark.h for more details.
+
+*/
+
+#include "stack-watermark.h"
+
+#include <camkes.h>
+#include <utils/page.h>
+#include <utils/util.h>
+
+
+void stack_watermarks_init(struct Stack_Watermarks * watermarks,
+        struct Stack_Watermark * stacks, unsigned num_stacks, size_t stack_size) {
+
+    //Only run on first thread
+    if(!watermarks->initialized) {
+        watermarks->initialized = true;
+        watermarks->stacks = stacks;
+        watermarks->num_stacks = num_stacks;
+        watermarks->num_registered = 0;
+        watermarks->stack_size = ROUND_UP_UNSAFE(stack_size, PAGE_SIZE_4K);
+    }
+}
+
+//Not inlined, so that its frame lies below the caller's, and painting stops below its own
+__attribute__((noinline))
+void stack_watermark_paint(struct Stack_Watermarks * watermarks) {
+
+    if (watermarks->num_registered >= watermarks->num_stacks) {
+        return;
+    }
+
+    struct Stack_Watermark * stack = &watermarks->stacks[watermarks->num_registered++];
+
+    uintptr_t sp = (uintptr_t) __builtin_frame_address(0);
+    stack->top = ROUND_UP_UNSAFE(sp, PAGE_SIZE_4K);
+    stack->base = stack->top - watermarks->stack_size;
+
+    volatile uintptr_t * word = (volatile uintptr_t *) stack->base;
+    volatile uintptr_t * end = (volatile uintptr_t *) (sp - STACK_WATERMARK_MARGIN);
+    while (word < end) {
+        *word++ = STACK_WATERMARK_PATTERN;
+    }
+}
+
+size_t stack_watermark_max_used(struct Stack_Watermarks * watermarks) {
+
+    size_t max_used = 0;
+
+    for (unsigned i = 0; i < watermarks->num_registered; i++) {
+        struct Stack_Watermark * stack = &watermarks->stacks[i];
+
+        //The first word from the base no longer holding the pattern
+        const uintptr_t * word = (const uintptr_t *) stack->base;
+        while ((uintptr_t) word < stack->top && *word == STACK_WATERMARK_PATTERN) {
+            word++;
+        }
+
+        max_used = MAX(max_used, stack->top - (uintptr_t) word);
+    }
+
+    return max_used;
+}
@@ -0,0 +1,61 @@
+/*
+
+    stack-watermark.h
+
+    Stack high-water marks of a CPI's threadpool threads, by stack painting,
+    for sizing their stacks (the NAME_stack_size attribute).
+
+    As it starts, each threadpool thread paints the unused part of its stack with a known pattern,
+    and the high-water mark is later found as the lowest address no longer holding the pattern.
+    This measures the deepest stack use observed, not a bound on it.
+
+    CAmkES allocates each thread's stack as a page-aligned array,
+    rounded up to a whole number of pages (and surrounded by guard pages),
+    and a threadpool thread starts within its top page,
+    so the stack's extent is found from the thread's stack pointer and the configured stack size.
+
+    Each thread registers itself, at the ceiling priority before it first receives a request,
+    so (as for the Priority_Inheritance lock) registration needs no atomic lock.
+*/
+
+#pragma once
+
+#include <camkes.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define STACK_WATERMARK_PATTERN ((uintptr_t) 0x5354414bu)
+
+//Bytes left unpainted below the painting thread's frame
+#define STACK_WATERMARK_MARGIN 256
+
+//The extent of a painted stack
+struct Stack_Watermark {
+    uintptr_t base;
+    uintptr_t top;
+};
+
+struct Stack_Watermarks {
+    bool initialized;
+    struct Stack_Watermark * stacks;
+    unsigned num_stacks;
+    unsigned num_registered;
+    size_t stack_size;
+};
+
+/*
+    Allocates static memory for the stacks of NUM_STACKS threads of STACK_SIZE bytes,
+    and initializes the Stack_Watermarks
+*/
+#define STACK_WATERMARKS_INIT(WATERMARKS_PTR, NUM_STACKS, STACK_SIZE) \
+    static struct Stack_Watermark stack_watermarks[NUM_STACKS]; \
+    stack_watermarks_init(WATERMARKS_PTR, stack_watermarks, NUM_STACKS, STACK_SIZE);
+
+void stack_watermarks_init(struct Stack_Watermarks * watermarks,
+        struct Stack_Watermark * stacks, unsigned num_stacks, size_t stack_size);
+
+//Register the calling thread's stack, and paint its unused part
+void stack_watermark_paint(struct Stack_Watermarks * watermarks);
+
+//Deepest stack use of any registered thread, in bytes
+size_t stack_watermark_max_used(struct Stack_Watermarks * watermarks);
@@ -0,0 +1,137 @@
+/*
+
+    utilisation-accounting.c
+
+    The implementation of per-thread, per-client and per-priority utilisation accounting.
+    See utilisation-accounting.h for more details.
+
+*/
+
+#include "utilisation-accounting.h"
+#include "priority-stats.h"
+
+#include <camkes.h>
+#include <camkes/tls.h>
+#include <sel4/benchmark_utilisation_types.h>
+#include <sel4utils/sel4_zf_logif.h>
+#include <string.h>
+#include <utils/util.h>
+
+
+//The registered thread of the calling threadpool thread
+static __thread struct Utilisation_Thread * utilisation_thread = NULL;
+
+//Words of the IPC buffer the kernel overwrites with a thread's utilisation
+#define UTILISATION_IPC_WORDS \
+    ((BENCHMARK_TCB_NUMBER_KERNEL_ENTRIES + 1) * sizeof(uint64_t) / sizeof(seL4_Word))
+
+//Cycles the given thread has run, preserving the calling thread's message
+static uint64_t thread_cycles(seL4_CPtr tcb) {
+
+    seL4_Word saved[UTILISATION_IPC_WORDS];
+    seL4_Word * msg = seL4_GetIPCBuffer()->msg;
+    memcpy(saved, msg, sizeof(saved));
+
+    seL4_BenchmarkGetThreadUtilisation(tcb);
+    uint64_t cycles = ((uint64_t *) msg)[BENCHMARK_TCB_UTILISATION];
+
+    memcpy(msg, saved, sizeof(saved));
+    return cycles;
+}
+
+void utilisation_accounting_init(struct Utilisation_Accounting * accounting,
+        struct Utilisation_Thread * threads, unsigned num_threads,
+        struct Utilisation_Client * clients, unsigned num_clients) {
+
+    //Only run on first thread
+    if (!accounting->initialized) {
+        accounting->threads = threads;
+        accounting->num_threads = num_threads;
+        accounting->num_registered = 0;
+        accounting->clients = clients;
+        accounting->num_clients = num_clients;
+        accounting->initialized = true;
+
+        //The kernel only tracks utilisation once the benchmark log is reset
+        seL4_BenchmarkResetLog();
+    }
+}
+
+/*
+    Threadpool threads register as they start, at the ceiling priority,
+    so the registry is not manipulated concurrently
+*/
+void utilisation_register(struct Utilisation_Accounting * accounting) {
+
+    ZF_LOGF_IF(accounting->num_registered == accounting->num_threads,
+            "Too many threads registered for utilisation accounting.\n");
+
+    utilisation_thread = &accounting->threads[accounting->num_registered++];
+    utilisation_thread->tcb = camkes_get_tls()->tcb_cap;
+}
+
+unsigned utilisation_client(struct Utilisation_Accounting * accounting, seL4_Word badge) {
+    for (unsigned i = 0; i < accounting->num_clients; i++) {
+        if (accounting->clients[i].badge == badge) {
+            return i;
+        }
+    }
+    return UTILISATION_NO_CLIENT;
+}
+
+void utilisation_begin(struct Utilisation_Sample * sample, unsigned client, int priority) {
+    sample->client = client;
+    sample->priority = priority;
+    sample->start = thread_cycles(camkes_get_tls()->tcb_cap);
+}
+
+void utilisation_end(struct Utilisation_Accounting * accounting, struct Utilisation_Sample * sample) {
+
+    uint64_t cycles = thread_cycles(camkes_get_tls()->tcb_cap) - sample->start;
+
+    accounting->requests++;
+    accounting->cycles += cycles;
+
+    if (utilisation_thread) {
+        utilisation_thread->requests++;
+        utilisation_thread->cycles += cycles;
+    }
+
+    if (sample->client != UTILISATION_NO_CLIENT) {
+        struct Utilisation_Client * client = &accounting->clients[sample->client];
+        client->requests++;
+        client->cycles += cycles;
+    }
+
+    if (sample->priority >= 0 && sample->priority < UTILISATION_PRIORITIES) {
+        accounting->priority_requests[sample->priority]++;
+        accounting->priority_cycles[sample->priority] += cycles;
+    }
+}
+
+void utilisation_report(struct Utilisation_Accounting * accounting, const char * name) {
+
+    PRIORITY_STATS_PRINT("utilisation", name, "requests=%llu,cycles=%llu",
+            accounting->requests, (unsigned long long) accounting->cycles);
+
+    for (unsigned i = 0; i < accounting->num_registered; i++) {
+        struct Utilisation_Thread * thread = &accounting->threads[i];
+        PRIORITY_STATS_PRINT("utilisation", name, "thread=%u,requests=%llu,cycles=%llu,total_cycles=%llu",
+                i, thread->requests, (unsigned long long) thread->cycles,
+                (unsigned long long) thread_cycles(thread->tcb));
+    }
+
+    for (unsigned i = 0; i < accounting->num_clients; i++) {
+        struct Utilisation_Client * client = &accounting->clients[i];
+        PRIORITY_STATS_PRINT("utilisation", name, "badge=%lu,requests=%llu,cycles=%llu",
+                (unsigned long) client->badge, client->requests, (unsigned long long) client->cycles);
+    }
+
+    for (int priority = 0; priority < UTILISATION_PRIORITIES; priority++) {
+        if (accounting->priority_requests[priority]) {
+            PRIORITY_STATS_PRINT("utilisation", name, "priority=%d,requests=%llu,cycles=%llu",
+                    priority, accounting->priority_requests[priority],
+                    (unsigned long long) accounting->priority_cycles[priority]);
+        }
+    }
+}
@@ -0,0 +1,124 @@
+/*
+
+    utilisation-accounting.h
+
+    Accounting of the CPU time consumed by the requests of a prioritized CPI,
+    for capacity planning of shared CPIs.
+
+    Wall-clock time in a CPI includes time spent preempted or blocked,
+    so it overstates what each request actually consumes.
+    A kernel built with CONFIG_BENCHMARK_TRACK_UTILISATION instead tracks the cycles each thread runs,
+    which a thread can read for any TCB with seL4_BenchmarkGetThreadUtilisation.
+
+    Each threadpool thread samples its own utilisation before priority_pre and after priority_post,
+    and the difference is the CPU time its request consumed,
+    including the priority protocol itself but not the time it was preempted or blocked
+    (e.g., waiting for the lock under PIP, whose holder's request is charged instead).
+    This is aggregated:
+
+        * per interface
+        * per threadpool thread, along with the thread's total utilisation
+          (which also includes receiving and replying)
+        * per client, identified by its badge
+        * per request priority, which identifies the originating task,
+          as nested requests carry the priority of the request that made them
+
+    The kernel only tracks utilisation once seL4_BenchmarkResetLog is called,
+    which the first threadpool thread does at initialization.
+    This restarts the system-wide benchmark log and utilisation window,
+    so other components reading them see them begin again from then.
+
+    The kernel returns utilisation in the caller's IPC buffer, which holds the request
+    (or its reply) when sampled, so the overwritten words are saved and restored around each sample.
+
+    Threads register, and statistics are updated, at the ceiling priority,
+    so (as for the Priority_Inheritance lock) they need no atomic lock.
+*/
+
+#pragma once
+
+#include <autoconf.h>
+#include <camkes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef CONFIG_BENCHMARK_TRACK_UTILISATION
+#error "Utilisation accounting requires a kernel built with CONFIG_BENCHMARK_TRACK_UTILISATION"
+#endif
+
+//A request from an unknown badge
+#define UTILISATION_NO_CLIENT UINT_MAX
+
+//Number of request priorities accounted for
+#define UTILISATION_PRIORITIES (seL4_MaxPrio + 1)
+
+struct Utilisation_Thread {
+    seL4_CPtr tcb;
+
+    //Requests handled by this thread, and the cycles they consumed
+    unsigned long long requests;
+    uint64_t cycles;
+};
+
+struct Utilisation_Client {
+
+    //Assigned statically by the connector template
+    seL4_Word badge;
+
+    //Requests from this client, and the cycles they consumed
+    unsigned long long requests;
+    uint64_t cycles;
+};
+
+//A request in progress, kept by its threadpool thread
+struct Utilisation_Sample {
+    uint64_t start;
+    unsigned client;
+    int priority;
+};
+
+struct Utilisation_Accounting {
+
+    bool initialized;
+
+    struct Utilisation_Thread * threads;
+    unsigned num_threads;
+    unsigned num_registered;
+
+    struct Utilisation_Client * clients;
+    unsigned num_clients;
+
+    //Statistics of the interface, and per request priority
+    unsigned long long requests;
+    uint64_t cycles;
+    unsigned long long priority_requests[UTILISATION_PRIORITIES];
+    uint64_t priority_cycles[UTILISATION_PRIORITIES];
+};
+
+/*
+    Allocates static memory for NUM_THREADS threadpool threads,
+    and initializes the Utilisation_Accounting with its clients, in the order of the connection's from ends
+*/
+#define UTILISATION_ACCOUNTING_INIT(ACCOUNTING_PTR, NUM_THREADS, CLIENTS, NUM_CLIENTS) \
+    static struct Utilisation_Thread utilisation_threads[NUM_THREADS]; \
+    utilisation_accounting_init(ACCOUNTING_PTR, utilisation_threads, NUM_THREADS, CLIENTS, NUM_CLIENTS);
+
+void utilisation_accounting_init(struct Utilisation_Accounting * accounting,
+        struct Utilisation_Thread * threads, unsigned num_threads,
+        struct Utilisation_Client * clients, unsigned num_clients);
+
+//Register the calling threadpool thread, before it first receives a request
+void utilisation_register(struct Utilisation_Accounting * accounting);
+
+//Index of the client with the given badge, or UTILISATION_NO_CLIENT
+unsigned utilisation_client(struct Utilisation_Accounting * accounting, seL4_Word badge);
+
+//Sample the calling thread's utilisation as a request enters the CPI, before priority_pre
+void utilisation_begin(struct Utilisation_Sample * sample, unsigned client, int priority);
+
+//Charge a request the utilisation consumed since utilisation_begin, after priority_post
+void utilisation_end(struct Utilisation_Accounting * accounting, struct Utilisation_Sample * sample);
+
+//Report the interface's statistics, and those of each thread, client and priority, in the format of priority-stats.h
+void utilisation_report(struct Utilisation_Accounting * accounting, const char * name);
@@ -0,0 +1,49 @@
+/*
+
+    release-server.c
+
+    The control thread of the ReleaseServer component.
+    Sets a oneshot timeout for the earliest pending release,
+    then releases every task due within the batch window, highest-priority first.
+    See release-schedule.h for more details.
+
+*/
+
+#include <camkes.h>
+#include <utils/time.h>
+
+#include "../priority-protocols/release-schedule.h"
+
+//Generated by the seL4PriorityRelease from-template
+extern struct Release_Entry releases_entries[];
+extern const unsigned releases_num_entries;
+
+int run(void) {
+
+    seL4_CPtr notification = timeout_notification();
+    seL4_Word badge;
+    uint64_t batch_window_ns = (uint64_t) batch_window_us * NS_IN_US;
+    unsigned long long passes = 0;
+
+    release_schedule_init(releases_entries, releases_num_entries, timeout_time());
+
+    while(1) {
+
+        uint64_t next = release_schedule_dispatch(releases_entries, releases_num_entries,
+                timeout_time(), batch_window_ns);
+
+        passes++;
+        if (report_every > 0 && passes % report_every == 0) {
+            release_schedule_report(releases_entries, releases_num_entries);
+        }
+
+        //The next release may have passed while dispatching
+        if (timeout_oneshot_absolute(0, next) != 0) {
+            continue;
+        }
+
+        seL4_Wait(notification, &badge);
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""
+priority-capture-convert.py
+
+Converts requests captured by a CPI (see request-capture.h), as printed by NAME_capture_dump(),
+into a replay trace for a replay driver component (see replay-driver.camkes.h):
+
+    priority-capture-convert.py [--instance NAME] [--interface NAME] console.log > replay-trace.c
+
+Reads console output (from a file or stdin), selects the priority-capture lines
+of the given CPI (by default, the only CPI in the output),
+sorts them by arrival time, and prints a C source file defining
+replay_requests and replay_num_requests.
+"""
+
+import argparse
+import sys
+
+
+def parse(lines, instance, interface):
+    requests = []
+    cpis = set()
+    for line in lines:
+        if not line.startswith('priority-capture,'):
+            continue
+        fields = line.rstrip('\r\n').split(',')
+        if len(fields) != 8:
+            continue
+        _, line_instance, line_interface, arrival, badge, method, priority, payload = fields
+        if instance and line_instance != instance:
+            continue
+        if interface and line_interface != interface:
+            continue
+        cpis.add((line_instance, line_interface))
+        requests.append((int(arrival), int(badge), int(method), int(priority), bytes.fromhex(payload)))
+    if len(cpis) > 1:
+        sys.exit('Captures of several CPIs (%s), select one with --instance and --interface' %
+                 ', '.join('%s.%s' % cpi for cpi in sorted(cpis)))
+    return sorted(requests, key=lambda request: request[0])
+
+
+def emit(requests, out):
+    out.write('/* Generated by priority-capture-convert.py */\n\n')
+    out.write('#include "../priority-aware-camkes/priority-protocols/request-capture.h"\n\n')
+    for i, request in enumerate(requests):
+        payload = request[4]
+        out.write('static const uint8_t payload_%d[%d] = {%s};\n' %
+                  (i, max(len(payload), 1), ', '.join('0x%02x' % b for b in payload) or '0'))
+    out.write('\nconst struct Replay_Request replay_requests[%d] = {\n' % max(len(requests), 1))
+    for i, (arrival, badge, method, priority, payload) in enumerate(requests):
+        out.write('    { .arrival_us = %d, .badge = %d, .method = %d, .priority = %d, .length = %d, .payload = payload_%d },\n' %
+                  (arrival, badge, method, priority, len(payload), i))
+    out.write('};\n\nconst unsigned replay_num_requests = %d;\n' % len(requests))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert captured requests into a replay trace')
+    parser.add_argument('--instance', help='component instance of the CPI')
+    parser.add_argument('--interface', help='interface of the CPI')
+    parser.add_argument('input', nargs='?', type=argparse.FileType('r'), default=sys.stdin)
+    args = parser.parse_args()
+
+    requests = parse(args.input, args.instance, args.interface)
+    if not requests:
+        sys.exit('No captured requests found')
+    emit(requests, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
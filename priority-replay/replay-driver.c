@@ -0,0 +1,82 @@
+/*
+
+    replay-driver.c
+
+    The control thread of a replay driver component (see replay-driver.camkes.h).
+    Sends each request of the replay trace at its original arrival time and priority,
+    and reports how late requests were sent, and their response times.
+
+*/
+
+#include <camkes.h>
+#include <utils/time.h>
+#include <utils/util.h>
+
+#include "../priority-protocols/priority-clock.h"
+#include "../priority-protocols/priority-stats.h"
+#include "../priority-protocols/request-capture.h"
+
+//Generated by priority-capture-convert.py
+extern const struct Replay_Request replay_requests[];
+extern const unsigned replay_num_requests;
+
+int run(void) {
+
+    seL4_CPtr notification = timeout_notification();
+    seL4_Word badge;
+
+    priority_clock_init(clock_cycles_per_us);
+
+    for (int pass = 0; pass < replay_repeat; ++pass) {
+
+        unsigned long long sent = 0;
+        unsigned long long late = 0;
+        unsigned long long failed = 0;
+        uint64_t max_late_ns = 0;
+        uint64_t total_response = 0;
+        uint64_t max_response = 0;
+
+        uint64_t start = timeout_time();
+
+        for (unsigned i = 0; i < replay_num_requests; ++i) {
+
+            const struct Replay_Request * request = &replay_requests[i];
+            if (replay_badge >= 0 && request->badge != (seL4_Word) replay_badge) {
+                continue;
+            }
+
+            //Wait for the request's arrival time, unless it has already passed
+            uint64_t arrival = start + request->arrival_us * NS_IN_US;
+            uint64_t now = timeout_time();
+            if (now < arrival) {
+                if (timeout_oneshot_absolute(0, arrival) == 0) {
+                    seL4_Wait(notification, &badge);
+                }
+            }
+            else if (now > arrival) {
+                late++;
+                max_late_ns = MAX(max_late_ns, now - arrival);
+            }
+
+            uint64_t begin = priority_clock_cycles();
+            if (target_replay(request->priority, request->payload, request->length) != 0) {
+                failed++;
+                continue;
+            }
+            uint64_t response = priority_clock_cycles() - begin;
+
+            sent++;
+            total_response += response;
+            max_response = MAX(max_response, response);
+        }
+
+        PRIORITY_STATS_PRINT("replay", "target",
+            "pass=%d,sent=%llu,failed=%llu,late=%llu,max_late_us=%llu,mean_response_us=%llu,max_response_us=%llu",
+            pass, sent, failed, late,
+            (unsigned long long) (max_late_ns / NS_IN_US),
+            (unsigned long long) (sent ? priority_clock_cycles_to_us(total_response / sent) : 0),
+            (unsigned long long) priority_clock_cycles_to_us(max_response));
+    }
+
+    return 0;
+}
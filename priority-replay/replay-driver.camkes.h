@@ -0,0 +1,50 @@
+/*
+
+    replay-driver.camkes.h
+
+    A component that replays captured request traffic (see request-capture.h)
+    against a CPI in a test assembly, with the original timing and priorities,
+    so that protocol and threadpool changes can be benchmarked under realistic load.
+
+    A replay driver uses the CPI's procedure, so its component is declared per procedure,
+    and connects to the CPI under test with the prioritized connector, like any client:
+
+    import <Timer.idl4>;
+    #include "../priority-aware-camkes/priority-replay/replay-driver.camkes.h"
+
+    replay_driver(ReplayCPIA, CPIA)
+
+    component ReplayCPIA client1;
+    component ReplayCPIA client2;
+
+    client1._priority = 40;
+    client1.replay_badge = 1;
+    client2._priority = 30;
+    client2.replay_badge = 2;
+    connection rpc(service1_a_num_threads) conn_a(from client1.target, from client2.target, to service1.a);
+    connection seL4TimeServer client1_timer(from client1.timeout, to time_server.the_timer);
+    connection seL4TimeServer client2_timer(from client2.timeout, to time_server.the_timer);
+
+    Each driver replays the requests of the original client with badge replay_badge
+    (or every request, one at a time, if it is -1), so that one driver per original client
+    reproduces the original concurrency; each driver's _priority should be that client's priority.
+    The trace is linked into every driver as replay-trace.c, generated by priority-capture-convert.py.
+    Each request is sent at its original arrival time, relative to the driver's start,
+    or as soon as the previous one is answered if that is later;
+    the trace is replayed replay_repeat times, and a summary is reported after each.
+
+*/
+
+#pragma once
+
+#define replay_driver(type_name, procedure) \
+    component type_name { \
+        control; \
+        uses procedure target; \
+        uses Timer timeout; \
+        attribute int _priority; \
+        attribute int target_replay_enabled = 1; \
+        attribute int replay_badge = -1; \
+        attribute int replay_repeat = 1; \
+        attribute int clock_cycles_per_us; \
+    }
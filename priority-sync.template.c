@@ -0,0 +1,85 @@
+/*
+ *
+ * priority-sync.template.c
+ *
+ * A component template (added to a component with the TEMPLATE_SOURCES
+ * option of DeclareCAmkESComponent) that declares and initializes
+ * the priority-aware synchronization objects of priority-sync.h.
+ *
+ * Each object is declared in the component specification with one of the macros
+ * of priority-protocols.camkes.h, which add a NAME_sync_type attribute
+ * along with its ceiling and the maximum number of threads that may wait on it.
+ * For each object, this template allocates a notification object per waiter,
+ * defines the object, and initializes it before the component's threads run.
+ *
+ */
+
+#include <camkes.h>
+#include <camkes/init.h>
+#include <platsupport/io.h>
+
+#include "../priority-aware-camkes/priority-protocols/priority-sync.h"
+
+/*- set sync_types = {'pip_mutex': 'struct PIP_Mutex', 'ipcp_mutex': 'struct IPCP_Mutex', 'semaphore': 'struct Priority_Semaphore', 'condition': 'struct Priority_Condition'} -*/
+
+/*# Find the synchronization objects, by their NAME_sync_type attributes #*/
+/*- set sync_objects = [] -*/
+/*- for a in me.type.attributes -*/
+  /*- if a.name.endswith('_sync_type') -*/
+    /*- set name = a.name[:-10] -*/
+    /*- set sync_type = configuration[me.name].get(a.name) -*/
+    /*- if sync_type not in sync_types -*/
+      /*? raise(TemplateError('Invalid attribute "%s" for %s, must be one of "pip_mutex", "ipcp_mutex", "semaphore", "condition"' % (sync_type, a.name))) ?*/
+    /*- endif -*/
+    /*- set ceiling = configuration[me.name].get('%s_ceiling' % name) -*/
+    /*- if ceiling is none -*/
+      /*? raise(TemplateError('Missing attribute %s_ceiling for synchronization object %s of %s' % (name, name, me.name))) ?*/
+    /*- endif -*/
+    /*- set max_waiters = int(configuration[me.name].get('%s_max_waiters' % name, 1)) -*/
+    /*- if max_waiters < 1 -*/
+      /*? raise(TemplateError('Invalid attribute "%s" for %s_max_waiters, must be at least 1' % (max_waiters, name))) ?*/
+    /*- endif -*/
+    /*- do sync_objects.append((name, sync_type, ceiling, max_waiters)) -*/
+  /*- endif -*/
+/*- endfor -*/
+
+//Define the synchronization objects, accessible from component code through extern declarations
+/*- for name, sync_type, ceiling, max_waiters in sync_objects -*/
+/*? sync_types[sync_type] ?*/ /*? name ?*/;
+/*- endfor -*/
+
+//Initialize the synchronization objects before any of the component's threads use them
+static int priority_sync_init(ps_io_ops_t * io_ops) {
+
+  /*- for name, sync_type, ceiling, max_waiters in sync_objects -*/
+    {
+        /*
+            Allocates a static array of notification objects for the waiters.
+            Each object's CPtr is bound to a Notification Node
+            and so can be accessed from component scope
+        */
+        static seL4_CPtr ntfn_objs[/*? max_waiters ?*/];
+        /*- for i in range(max_waiters) -*/
+            /*- set ntfn = alloc('%s_sync_ntfn_obj_%d' % (name, i), seL4_NotificationObject, read=True, write=True) -*/
+            ntfn_objs[/*? i ?*/] = /*? ntfn ?*/;
+        /*- endfor -*/
+
+        /*- if sync_type == 'pip_mutex' -*/
+            pip_mutex_init(&/*? name ?*/, /*? ceiling ?*/);
+        /*- elif sync_type == 'ipcp_mutex' -*/
+            ipcp_mutex_init(&/*? name ?*/, /*? ceiling ?*/);
+        /*- elif sync_type == 'semaphore' -*/
+            priority_semaphore_init(&/*? name ?*/, /*? ceiling ?*/,
+                /*? configuration[me.name].get('%s_count' % name, 0) ?*/);
+        /*- else -*/
+            priority_condition_init(&/*? name ?*/, /*? ceiling ?*/);
+        /*- endif -*/
+
+        NOTIFICATION_MANAGER_INIT(&/*? name ?*/.ntfn_mgr, ntfn_objs, /*? max_waiters ?*/);
+    }
+  /*- endfor -*/
+
+    return 0;
+}
+
+CAMKES_PRE_INIT_MODULE_DEFINE(priority_sync, priority_sync_init);
@@ -0,0 +1,344 @@
+/*
+ *
+ * rpc-priority-connector-common-from.c
+ *
+ * All code taken, except where noted (with a priority-extensions label),
+ * from the seL4 camkes-tool repo, /camkes/templates/rpc-connector-common-from.c
+ *
+ * Implements common RPC connector (sender side) functionality,
+ * with additions for the priority-aware concurrency framework extensions.
+ *
+ */
+
+/*- import 'helpers/error.c' as error with context -*/
+/*- import 'helpers/marshal.c' as marshal with context -*/
+
+/*? assert(isinstance(connector, namespace)) ?*/
+
+#include <autoconf.h>
+#include <sel4camkes/gen_config.h>
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <camkes/error.h>
+#include <camkes/marshal_macros.h>
+#include <camkes/tls.h>
+#include <sel4/sel4.h>
+#include <camkes/dataport.h>
+#include <utils/util.h>
+
+/*? macros.show_includes(me.instance.type.includes) ?*/
+/*? macros.show_includes(me.interface.type.includes) ?*/
+
+/*- set instance = me.instance.name -*/
+/*- set interface = me.interface.name -*/
+
+/* Interface-specific error handling */
+/*- set error_handler = '%s_error_handler' % me.interface.name -*/
+/*? error.make_error_handler(interface, error_handler) ?*/
+
+#define CAMKES_INTERFACE_NAME "/*? interface ?*/"
+#define CAMKES_INSTANCE_NAME "/*? instance ?*/"
+#define CAMKES_ERROR_HANDLER /*? error_handler ?*/
+
+int /*? me.interface.name ?*/__run(void) {
+    /* This function is never actually executed, but we still emit it for the
+     * purpose of type checking RPC calls.
+     */
+    return 0;
+}
+
+/*
+    priority-extensions:
+
+    The marshalled method index and parameters follow the request priority,
+    which occupies the first message register,
+    and for an interface with an inversion monitor, the time the request was sent.
+*/
+/*- set priority_msg_size = 'PRIORITY_MONITORED_MSG_SIZE' if inversion_monitor else 'PRIORITY_MSG_SIZE' -*/
+/*- set payload = '((void*)(((char*)%s) + %s))' % (connector.send_buffer, priority_msg_size) -*/
+/*- set payload_size = '(%s - %s)' % (connector.send_buffer_size, priority_msg_size) -*/
+
+/*- set methods_len = len(me.interface.type.methods) -*/
+/*- for i, m in enumerate(me.interface.type.methods) -*/
+
+/*- set input_parameters = list(filter(lambda('x: x.direction in [\'refin\', \'in\', \'inout\']'), m.parameters)) -*/
+/*? marshal.make_marshal_input_symbols(m.name, '%s_marshal_inputs' % m.name, i, methods_len, input_parameters, connector.send_buffer_size_fixed) ?*/
+
+/*- set output_parameters = list(filter(lambda('x: x.direction in [\'out\', \'inout\']'), m.parameters)) -*/
+/*? marshal.make_unmarshal_output_symbols(m.name, '%s_unmarshal_outputs' % m.name, output_parameters, m.return_type, connector.recv_buffer_size_fixed) ?*/
+
+/*- if m.return_type is not none -*/
+    /*? macros.show_type(m.return_type) ?*/
+/*- else -*/
+    void
+/*- endif -*/
+/*? me.interface.name ?*/_/*? m.name ?*/(
+    /*? marshal.show_input_parameter_list(m.parameters, ['in', 'refin', 'out', 'inout']) ?*/
+    /*- if len(m.parameters) == 0 -*/
+        void
+    /*- endif -*/
+) {
+
+    /*- set ret = "%s_ret" % (m.name) -*/
+    /*- set ret_ptr = "%s_ret_ptr" % (m.name) -*/
+    /*- if m.return_type is not none -*/
+        /*- if m.return_type == 'string' -*/
+            char * /*? ret ?*/ = NULL;
+            char ** /*? ret_ptr ?*/ = &/*? ret ?*/;
+        /*- else -*/
+            /*? macros.show_type(m.return_type) ?*/ /*? ret ?*/;
+            /*? macros.show_type(m.return_type) ?*/ * /*? ret_ptr ?*/ = &/*? ret ?*/;
+        /*- endif -*/
+    /*- endif -*/
+
+    /*
+        priority-extensions:
+
+        Obtain the caller's effective priority from its priority context.
+        Nested requests made by a CPI thread inherit the priority of the request it is handling.
+    */
+    int priority = get_effective_priority();
+    if (priority == PRIORITY_CONTEXT_UNSET) {
+        priority = /*? default_priority ?*/;
+    }
+
+    /*? begin_send(connector) ?*/
+
+    /*
+        priority-extensions:
+
+        Insert the priority into the first message register
+    */
+    seL4_Word priority_word = (seL4_Word) priority;
+    memcpy(/*? connector.send_buffer ?*/, &priority_word, PRIORITY_MSG_SIZE);
+
+    /* Marshal all the parameters */
+    unsigned length = /*? marshal.call_marshal_input('%s_marshal_inputs' % m.name, payload, payload_size, input_parameters) ?*/;
+    if (unlikely(length == UINT_MAX)) {
+        /* Error in marshalling; bail out. */
+        /*- if m.return_type is not none -*/
+            /*- if m.return_type == 'string' -*/
+                return NULL;
+            /*- else -*/
+                memset(/*? ret_ptr ?*/, 0, sizeof(* /*? ret_ptr ?*/));
+                return /*? ret ?*/;
+            /*- endif -*/
+        /*- else -*/
+            return;
+        /*- endif -*/
+    }
+    length += /*? priority_msg_size ?*/;
+
+    /*
+        priority-extensions:
+
+        Zero any padding in the last message register,
+        so that identical requests are sent as identical bytes
+        (allowing replies to pure methods to be cached by the recipient)
+    */
+    unsigned padding = (sizeof(seL4_Word) - (length % sizeof(seL4_Word))) % sizeof(seL4_Word);
+    memset(((char*)/*? connector.send_buffer ?*/) + length, 0, padding);
+
+    /*- if inversion_monitor -*/
+        /*
+            priority-extensions:
+
+            Timestamp the request for the recipient's inversion monitor,
+            after marshalling, as it is sent
+        */
+        seL4_Word sent_word = (seL4_Word) priority_clock_cycles();
+        memcpy(((char*)/*? connector.send_buffer ?*/) + PRIORITY_MSG_SIZE, &sent_word, sizeof(seL4_Word));
+    /*- endif -*/
+
+    /* Call the endpoint */
+    unsigned size;
+    /*? perform_call(connector, "size", "length") ?*/
+
+    /* Unmarshal the response */
+    int err = /*? marshal.call_unmarshal_output('%s_unmarshal_outputs' % m.name, connector.recv_buffer, "size", output_parameters, m.return_type, ret_ptr) ?*/;
+    /*? release_recv(connector) ?*/
+    if (unlikely(err != 0)) {
+        /* Error in unmarshalling; bail out. */
+        /*- if m.return_type is not none -*/
+            /*- if m.return_type == 'string' -*/
+                return NULL;
+            /*- else -*/
+                memset(/*? ret_ptr ?*/, 0, sizeof(* /*? ret_ptr ?*/));
+                return /*? ret ?*/;
+            /*- endif -*/
+        /*- else -*/
+            return;
+        /*- endif -*/
+    }
+
+    /*- if m.return_type is not none -*/
+        return /*? ret ?*/;
+    /*- endif -*/
+}
+/*- endfor -*/
+
+/*- if replay -*/
+/*
+    priority-extensions:
+
+    Send a captured request (see request-capture.h) at the given priority:
+    its marshalled method index and parameters are sent as they followed the original request's priority.
+    The reply is discarded.
+    Returns 0 once the request is answered, or -1 if it does not fit in the send buffer.
+*/
+int /*? me.interface.name ?*/_replay(int priority, const void * request, unsigned request_length) {
+
+    if (request_length > /*? payload_size ?*/) {
+        return -1;
+    }
+
+    /*? begin_send(connector) ?*/
+
+    seL4_Word priority_word = (seL4_Word) priority;
+    memcpy(/*? connector.send_buffer ?*/, &priority_word, PRIORITY_MSG_SIZE);
+    memcpy(/*? payload ?*/, request, request_length);
+    unsigned length = request_length + /*? priority_msg_size ?*/;
+
+    unsigned padding = (sizeof(seL4_Word) - (length % sizeof(seL4_Word))) % sizeof(seL4_Word);
+    memset(((char*)/*? connector.send_buffer ?*/) + length, 0, padding);
+
+    /*- if inversion_monitor -*/
+    seL4_Word sent_word = (seL4_Word) priority_clock_cycles();
+    memcpy(((char*)/*? connector.send_buffer ?*/) + PRIORITY_MSG_SIZE, &sent_word, sizeof(seL4_Word));
+    /*- endif -*/
+
+    /* Call the endpoint */
+    unsigned size;
+    /*? perform_call(connector, "size", "length") ?*/
+    /*? release_recv(connector) ?*/
+
+    return 0;
+}
+/*- endif -*/
+
+/*- if futures -*/
+/*
+    priority-extensions:
+
+    Non-blocking calls, for a thread to make several nested requests in parallel.
+    NAME_METHOD_async marshals the request into a Priority_Future, at the caller's effective priority,
+    and submits it to the component's Future_Pool, whose workers make the call;
+    NAME_METHOD_join waits for the reply and unmarshals it.
+    Input parameters passed by reference (e.g., arrays and strings) must remain valid until the join.
+*/
+
+//Make a future's call from a worker thread, replacing its request with the reply
+static unsigned /*? me.interface.name ?*/__future_call(seL4_Word * msg, unsigned length) {
+
+    /*? begin_send(connector) ?*/
+
+    memcpy(/*? connector.send_buffer ?*/, msg, length);
+
+    /*- if inversion_monitor -*/
+    seL4_Word sent_word = (seL4_Word) priority_clock_cycles();
+    memcpy(((char*)/*? connector.send_buffer ?*/) + PRIORITY_MSG_SIZE, &sent_word, sizeof(seL4_Word));
+    /*- endif -*/
+
+    /* Call the endpoint */
+    unsigned size;
+    /*? perform_call(connector, "size", "length") ?*/
+
+    size = MIN(size, sizeof(seL4_Word) * seL4_MsgMaxLength);
+    memcpy(msg, /*? connector.recv_buffer ?*/, size);
+    /*? release_recv(connector) ?*/
+
+    return size;
+}
+
+/*- for i, m in enumerate(me.interface.type.methods) -*/
+
+/*- set input_parameters = list(filter(lambda('x: x.direction in [\'refin\', \'in\', \'inout\']'), m.parameters)) -*/
+/*- set output_parameters = list(filter(lambda('x: x.direction in [\'out\', \'inout\']'), m.parameters)) -*/
+/*- set future_payload = '((void*)(((char*)future->msg) + %s))' % priority_msg_size -*/
+/*- set future_payload_size = '(sizeof(future->msg) - %s)' % priority_msg_size -*/
+
+int /*? me.interface.name ?*/_/*? m.name ?*/_async(struct Priority_Future * future
+    /*- if input_parameters -*/,
+    /*? marshal.show_input_parameter_list(m.parameters, ['in', 'refin', 'inout']) ?*/
+    /*- endif -*/
+) {
+
+    int priority = get_effective_priority();
+    if (priority == PRIORITY_CONTEXT_UNSET) {
+        priority = /*? default_priority ?*/;
+    }
+
+    seL4_Word priority_word = (seL4_Word) priority;
+    memcpy(future->msg, &priority_word, PRIORITY_MSG_SIZE);
+
+    /* Marshal all the parameters */
+    unsigned length = /*? marshal.call_marshal_input('%s_marshal_inputs' % m.name, future_payload, future_payload_size, input_parameters) ?*/;
+    if (unlikely(length == UINT_MAX)) {
+        return -1;
+    }
+    length += /*? priority_msg_size ?*/;
+
+    //Zero any padding in the last message register, as for a blocking call
+    unsigned padding = (sizeof(seL4_Word) - (length % sizeof(seL4_Word))) % sizeof(seL4_Word);
+    memset(((char*)future->msg) + length, 0, padding);
+
+    priority_future_submit(future, /*? me.interface.name ?*/__future_call, priority, length);
+    return 0;
+}
+
+/*- if m.return_type is not none -*/
+    /*? macros.show_type(m.return_type) ?*/
+/*- else -*/
+    void
+/*- endif -*/
+/*? me.interface.name ?*/_/*? m.name ?*/_join(struct Priority_Future * future
+    /*- if output_parameters -*/,
+    /*? marshal.show_input_parameter_list(m.parameters, ['out', 'inout']) ?*/
+    /*- endif -*/
+) {
+
+    /*- set ret = "%s_ret" % (m.name) -*/
+    /*- set ret_ptr = "%s_ret_ptr" % (m.name) -*/
+    /*- if m.return_type is not none -*/
+        /*- if m.return_type == 'string' -*/
+            char * /*? ret ?*/ = NULL;
+            char ** /*? ret_ptr ?*/ = &/*? ret ?*/;
+        /*- else -*/
+            /*? macros.show_type(m.return_type) ?*/ /*? ret ?*/;
+            /*? macros.show_type(m.return_type) ?*/ * /*? ret_ptr ?*/ = &/*? ret ?*/;
+        /*- endif -*/
+    /*- endif -*/
+
+    int priority = get_effective_priority();
+    if (priority == PRIORITY_CONTEXT_UNSET) {
+        priority = /*? default_priority ?*/;
+    }
+    unsigned size = priority_future_wait(future, priority);
+
+    /* Unmarshal the response */
+    int err = /*? marshal.call_unmarshal_output('%s_unmarshal_outputs' % m.name, 'future->msg', "size", output_parameters, m.return_type, ret_ptr) ?*/;
+    if (unlikely(err != 0)) {
+        /* Error in unmarshalling; bail out. */
+        /*- if m.return_type is not none -*/
+            /*- if m.return_type == 'string' -*/
+                return NULL;
+            /*- else -*/
+                memset(/*? ret_ptr ?*/, 0, sizeof(* /*? ret_ptr ?*/));
+                return /*? ret ?*/;
+            /*- endif -*/
+        /*- else -*/
+            return;
+        /*- endif -*/
+    }
+
+    /*- if m.return_type is not none -*/
+        return /*? ret ?*/;
+    /*- endif -*/
+}
+/*- endfor -*/
+/*- endif -*/
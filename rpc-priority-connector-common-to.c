@@ -51,28 +51,100 @@
     /*- do type_dict.update({f.interface.type: cur_list}) -*/
 /*- endfor -*/
 
-/*- for j, from_type in enumerate(type_dict.keys()) -*/
-    /*-- set methods_len = len(from_type.methods) -*/
-    /*-- for m in from_type.methods -*/
-        extern /*- if m.return_type is not none --*/
-            /*? macros.show_type(m.return_type) ?*/ /*- else --*/
-            void /*- endif --*/
-            /*?- me.interface.name ?*/_/*? m.name ?*/(
-                /*?- marshal.show_input_parameter_list(m.parameters, ['in', 'refin', 'out', 'inout']) ?*/
-                /*-- if len(m.parameters) == 0 -*/
-                    void
-                /*-- endif --*/
-            );
-
-        /*- set input_parameters = list(filter(lambda('x: x.direction in [\'refin\', \'in\', \'inout\']'), m.parameters)) -*/
-        /*? marshal.make_unmarshal_input_symbols(m.name, '%s_unmarshal_inputs' % m.name, methods_len, input_parameters, connector.recv_buffer_size_fixed) ?*/
-
-        /*- set output_parameters = list(filter(lambda('x: x.direction in [\'out\', \'inout\']'), m.parameters)) -*/
-        /*? marshal.make_marshal_output_symbols(m.name, '%s_marshal_outputs' % m.name, output_parameters, m.return_type) ?*/
+/*
+    priority-extensions:
+
+    Each method is handled by a single case of the receive loop, shared by every from-interface type
+    declaring a method of that name with a method index of the same width, with the request's method index
+    mapped to the method's position in shared_methods.
+    The unmarshalling code skips the method index, so types whose index widths differ
+    (e.g., one declaring a single method, without an index) each have a case of their own. The steps common to every method (leaving the priority protocol,
+    accounting, caching the reply and replying) are emitted once, after the method's case,
+    so that the receive loop's code grows with the number of methods alone.
+*/
+/*- set shared_methods = [] -*/
+/*- set shared_keys = [] -*/
+/*- set shared_names = [] -*/
+/*- for from_type in type_dict.keys() -*/
+    /*- set methods_len = len(from_type.methods) -*/
+    /*- set index_width = none if methods_len <= 1 else macros.type_to_fit_integer(methods_len) -*/
+    /*- for m in from_type.methods -*/
+        /*- if (m.name, index_width) not in shared_keys -*/
+            /*- if m.name in shared_names -*/
+                /*- set symbol = '%s_%d' % (m.name, len(shared_methods)) -*/
+            /*- else -*/
+                /*- set symbol = m.name -*/
+            /*- endif -*/
+            /*- do shared_keys.append((m.name, index_width)) -*/
+            /*- do shared_names.append(m.name) -*/
+            /*- do shared_methods.append((m, methods_len, symbol)) -*/
+        /*- endif -*/
+    /*- endfor -*/
+/*- endfor -*/
+
+/*- for m, methods_len, symbol in shared_methods -*/
+    /*- if symbol == m.name -*/
+    extern /*- if m.return_type is not none --*/
+        /*? macros.show_type(m.return_type) ?*/ /*- else --*/
+        void /*- endif --*/
+        /*?- me.interface.name ?*/_/*? m.name ?*/(
+            /*?- marshal.show_input_parameter_list(m.parameters, ['in', 'refin', 'out', 'inout']) ?*/
+            /*-- if len(m.parameters) == 0 -*/
+                void
+            /*-- endif --*/
+        );
+    /*- endif -*/
+
+    /*- set input_parameters = list(filter(lambda('x: x.direction in [\'refin\', \'in\', \'inout\']'), m.parameters)) -*/
+    /*? marshal.make_unmarshal_input_symbols(m.name, '%s_unmarshal_inputs' % symbol, methods_len, input_parameters, connector.recv_buffer_size_fixed) ?*/
+
+    /*- set output_parameters = list(filter(lambda('x: x.direction in [\'out\', \'inout\']'), m.parameters)) -*/
+    /*? marshal.make_marshal_output_symbols(m.name, '%s_marshal_outputs' % symbol, output_parameters, m.return_type) ?*/
+
+/*- endfor -*/
 
+/*- if len(type_dict.keys()) > 1 -*/
+    /*- for from_type in type_dict.keys() -*/
+//Positions in shared_methods of the methods of from-interface type /*? from_type.name ?*/
+        /*- set index_width = none if len(from_type.methods) <= 1 else macros.type_to_fit_integer(len(from_type.methods)) -*/
+static const unsigned /*? me.interface.name ?*/_shared_methods_/*? loop.index0 ?*/[] = {
+        /*- for m in from_type.methods -*/
+    /*? shared_keys.index((m.name, index_width)) ?*/,
+        /*- endfor -*/
+};
     /*- endfor -*/
+/*- endif -*/
+
+/*- set pure_indices = [] -*/
+/*- set idempotent_indices = [] -*/
+/*- for m, methods_len, symbol in shared_methods -*/
+    /*- if m.name in pure_methods -*/
+        /*- do pure_indices.append(loop.index0) -*/
+    /*- endif -*/
+    /*- if m.name in idempotent_methods -*/
+        /*- do idempotent_indices.append(loop.index0) -*/
+    /*- endif -*/
 /*- endfor -*/
 
+/*
+    priority-extensions:
+
+    The marshalled method index and parameters follow the request priority,
+    which the prioritized from-template inserts into the first message register,
+    and for an interface with an inversion monitor, the time the request was sent.
+*/
+/*- set priority_msg_size = 'PRIORITY_MONITORED_MSG_SIZE' if inversion_monitor else 'PRIORITY_MSG_SIZE' -*/
+/*- set payload = '((void*)(((char*)%s) + %s))' % (connector.recv_buffer, priority_msg_size) -*/
+/*- set payload_size = '(size - %s)' % priority_msg_size -*/
+
+/*
+    priority-extensions:
+
+    Under "inherited", a request may wait for the lock after its method index is read,
+    but before its parameters are unmarshalled from the IPC buffer
+*/
+/*- set preserve_msg = buffer is none and configuration[me.instance.name].get('%s_priority_protocol' % me.interface.name) == 'inherited' -*/
+
 /*- set passive = options.realtime and configuration[me.instance.name].get("%s_passive" % me.interface.name, False) -*/
 
 /*# Passive interface "run" functions must be passed a ntfn cap as part of the passive thread init protocol.
@@ -87,6 +159,58 @@ int /*- if passive -*/
 
     unsigned size;
     unsigned length = 0;
+
+    /*- if stack_watermarks -*/
+        /*
+            priority-extensions:
+
+            Paint this threadpool thread's stack, to find its high-water mark
+        */
+        stack_watermark_paint(&/*? me.interface.name ?*/_stack_watermarks);
+    /*- endif -*/
+
+    /*- if future_workers -*/
+        /*
+            priority-extensions:
+
+            The first threads to start make the calls of the component's futures instead
+        */
+        if (future_pool_is_worker()) {
+            future_worker_run();
+        }
+    /*- endif -*/
+
+    /*
+        priority-extensions:
+
+        Register this threadpool thread for mode changes, before it first waits for a request
+    */
+    priority_mode_register(&/*? me.interface.name ?*/_info);
+
+    /*- if utilisation_accounting -*/
+        //priority-extensions: register this threadpool thread for utilisation accounting
+        utilisation_register(&/*? me.interface.name ?*/_utilisation);
+    /*- endif -*/
+
+    /*- if idempotent_indices -*/
+        //priority-extensions: register this threadpool thread to attach to coalesced requests
+        request_coalescing_register(&/*? me.interface.name ?*/_coalescing);
+    /*- endif -*/
+
+    /*- if num_continuations -*/
+        /*
+            priority-extensions:
+
+            With continuations, only the receiver receives requests from the endpoint,
+            while workers resume the requests it parks
+        */
+        bool continuation_receiver = continuation_is_receiver(&/*? me.interface.name ?*/_continuation_pool);
+        struct Continuation * continuation = NULL;
+        if (!continuation_receiver) {
+            goto resume_continuation;
+        }
+    /*- endif -*/
+
     /*- if passive -*/
         /*? recv_first_rpc(connector, "size", me.might_block(), notify_cptr = "init_ntfn") ?*/
     /*- else -*/
@@ -94,158 +218,146 @@ int /*- if passive -*/
     /*- endif -*/
 
     while (1) {
+
+        //priority-extensions: this thread holds the request until it replies, for sizing the threadpool
+        priority_busy_begin(&/*? me.interface.name ?*/_info);
+
+        /*- if num_continuations -*/
+            /*
+                priority-extensions:
+
+                The receiver parks each request, with its caller's reply capability,
+                for a worker to resume in priority order
+            */
+            if (continuation_receiver) {
+                continuation_park(&/*? me.interface.name ?*/_continuation_pool,
+                        /*? connector.badge_symbol ?*/, /*? connector.recv_buffer ?*/, size);
+                /*? complete_recv(connector) ?*/
+                goto begin_recv;
+            }
+        /*- endif -*/
+
+        /*
+            priority-extensions:
+
+            Extract the request priority from the first message register
+        */
+        seL4_Word priority_word;
+        seL4_Word * priority_word_ptr = &priority_word;
+        unsigned priority_offset = 0;
+        UNMARSHAL_PARAM(priority_word_ptr, /*? connector.recv_buffer ?*/, size, priority_offset, "/*? me.interface.name ?*/", "priority", ({
+                /*? complete_recv(connector) ?*/
+                goto begin_recv;
+        }));
+        int priority = (int) priority_word;
+
+        /*- if inversion_monitor -*/
+            /*
+                priority-extensions:
+
+                Extract the time the request was sent, and timestamp its receipt
+            */
+            struct Inversion_Timestamps inversion;
+            inversion.received = priority_clock_cycles();
+            seL4_Word * sent_word_ptr = &inversion.sent;
+            UNMARSHAL_PARAM(sent_word_ptr, /*? connector.recv_buffer ?*/, size, priority_offset, "/*? me.interface.name ?*/", "sent", ({
+                    /*? complete_recv(connector) ?*/
+                    goto begin_recv;
+            }));
+            inversion.client = inversion_monitor_client(&/*? me.interface.name ?*/_inversion, /*? connector.badge_symbol ?*/);
+        /*- endif -*/
+
+        /*- if capture_dataport -*/
+            /*
+                priority-extensions:
+
+                Capture the request as it was sent, before admission control can refuse
+                or demote it, or the memo cache answer it
+            */
+            /*- if len(me.interface.type.methods) > 1 -*/
+                /*? macros.type_to_fit_integer(len(me.interface.type.methods)) ?*/ capture_method = 0;
+                memcpy(&capture_method, /*? payload ?*/, MIN(sizeof(capture_method), /*? payload_size ?*/));
+            /*- else -*/
+                unsigned capture_method = 0;
+            /*- endif -*/
+            request_capture_record(&/*? me.interface.name ?*/_request_capture, /*? connector.badge_symbol ?*/,
+                    capture_method, priority, priority_clock_cycles(), /*? payload ?*/, /*? payload_size ?*/);
+        /*- endif -*/
+
+        /*- if admission_enabled -*/
+            /*
+                priority-extensions:
+
+                Admission control for the sending client, before the request enters the priority protocol.
+                Refused requests receive an empty reply;
+                deferred requests are handled at the background priority.
+            */
+            unsigned admission_client = /*? me.interface.name ?*/_admission_client(/*? connector.badge_symbol ?*/);
+            uint64_t admission_arrival = priority_clock_cycles();
+            uint64_t admission_start = 0;
+            int admission = admission_check(&/*? me.interface.name ?*/_admission, admission_client, admission_arrival);
+            if (admission == admission_refuse) {
+                /*? complete_recv(connector) ?*/
+                /*? begin_reply(connector) ?*/
+                length = 0;
+                goto reply_recv;
+            }
+            if (admission == admission_defer) {
+                priority = /*? me.interface.name ?*/_admission.background_priority;
+            }
+        /*- endif -*/
+
+        /*
+            priority-extensions:
+
+            Read the method index, sized by the sender's from-interface type,
+            and map it to the method's position in shared_methods.
+            An invalid index maps past the last method, and is reported once the protocol is entered,
+            as by the default case of the method switch.
+        */
+        unsigned method;
+        unsigned method_index;
+        unsigned method_bound;
+        /*- if pure_indices or idempotent_indices -*/
+        unsigned method_tag;
+        /*- endif -*/
         /*- if len(type_dict.keys()) > 1 -*/
             switch (/*? connector.badge_symbol ?*/) {
         /*- endif -*/
         /*- for from_index, from_type in enumerate(type_dict.keys()) -*/
             /*- set methods_len = len(from_type.methods) -*/
             /*- if len(type_dict.keys()) > 1 -*/
-                /*- for from_index in type_dict.get(from_type) -*/
-                    case /*? connector.badges[from_index] ?*/: {
+                /*- for badge_index in type_dict.get(from_type) -*/
+                    case /*? connector.badges[badge_index] ?*/:
                 /*- endfor -*/
+                {
             /*- endif -*/
 
             /*- if methods_len <= 1 -*/
                 unsigned call = 0;
-                unsigned * call_ptr = &call;
             /*- else -*/
                 /*- set type = macros.type_to_fit_integer(methods_len) -*/
                 /*? type ?*/ call;
                 /*? type ?*/ * call_ptr = &call;
                 unsigned offset = 0;
-                UNMARSHAL_PARAM(call_ptr, /*? connector.recv_buffer ?*/, size , offset, "/*? me.interface.name ?*/", "method_index", ({
+                UNMARSHAL_PARAM(call_ptr, /*? payload ?*/, /*? payload_size ?*/, offset, "/*? me.interface.name ?*/", "method_index", ({
                         /*? complete_recv(connector) ?*/
                         goto begin_recv;
                 }));
             /*- endif -*/
+            method_index = call;
+            method_bound = /*? methods_len ?*/;
+            /*- if len(type_dict.keys()) > 1 -*/
+                method = call < /*? methods_len ?*/ ? /*? me.interface.name ?*/_shared_methods_/*? from_index ?*/[call] : /*? len(shared_methods) ?*/;
+            /*- elif methods_len == 0 -*/
+                method = /*? len(shared_methods) ?*/;
+            /*- else -*/
+                method = call;
+            /*- endif -*/
+            /*- if pure_indices or idempotent_indices -*/
+                method_tag = /*? from_index ?*/;
+            /*- endif -*/
 
-            switch (* call_ptr) {
-                /*-- for i, m in enumerate(from_type.methods) -*/
-                    case /*? i ?*/: { /*? '%s%s%s%s%s' % ('/', '* ', m.name, ' *', '/') ?*/
-                        /*#- Declare parameters. #*/
-                        /*-- for p in m.parameters -*/
-
-                            /*-- if p.array -*/
-                                size_t p_/*? p.name ?*/_sz;
-                                size_t * p_/*? p.name ?*/_sz_ptr = &p_/*? p.name ?*/_sz;
-                                /*-- if p.type == 'string' -*/
-                                    char ** p_/*? p.name ?*/ = NULL;
-                                    char *** p_/*? p.name ?*/_ptr = &p_/*? p.name ?*/;
-                                /*-- else -*/
-                                    /*? macros.show_type(p.type) ?*/ * p_/*? p.name ?*/ = NULL;
-                                    /*? macros.show_type(p.type) ?*/ ** p_/*? p.name ?*/_ptr = &p_/*? p.name ?*/;
-                                /*-- endif -*/
-                            /*-- elif p.type == 'string' -*/
-                                char * p_/*? p.name ?*/ = NULL;
-                                char ** p_/*? p.name ?*/_ptr = &p_/*? p.name ?*/;
-                            /*-- else -*/
-                                /*? macros.show_type(p.type) ?*/ p_/*? p.name ?*/;
-                                /*? macros.show_type(p.type) ?*/ * p_/*? p.name ?*/_ptr = &p_/*? p.name ?*/;
-                            /*-- endif -*/
-                        /*-- endfor -*/
-
-                        /* Unmarshal parameters */
-                        /*-- set input_parameters = list(filter(lambda('x: x.direction in [\'refin\', \'in\', \'inout\']'), m.parameters)) -*/
-                        int err = /*? marshal.call_unmarshal_input('%s_unmarshal_inputs' % m.name, connector.recv_buffer, "size", input_parameters, namespace_prefix='p_') ?*/;
-                        if (unlikely(err != 0)) {
-                            /* Error in unmarshalling; return to event loop. */
-                            /*?- complete_recv(connector) ?*/
-                            goto begin_recv;
-                        }
-                        
-                        /*
-                            priority-extensions:
-
-                            Call hook for priority protocol prior to CPI procedure function run.
-                            Extracts priority from function/message parameter.
-                        */
-                        priority_pre(*p_priority_ptr, &/*? me.interface.name ?*/_info);
-
-                        /* Call the implementation */
-                        /*-- set ret = "%s_ret" % (m.name) -*/
-                        /*-- set ret_sz = "%s_ret_sz" % (m.name) -*/
-                        /*-- set ret_ptr = "%s_ret_ptr" % (m.name) -*/
-                        /*-- set ret_sz_ptr = "%s_ret_sz_ptr" % (m.name) -*/
-                        /*-- if m.return_type is not none -*/
-                            /*-- if m.return_type == 'string' -*/
-                                char * /*? ret ?*/;
-                                char ** /*? ret_ptr ?*/ = &/*? ret ?*/;
-                            /*-- else -*/
-                                /*? macros.show_type(m.return_type) ?*/ /*? ret ?*/;
-                                /*? macros.show_type(m.return_type) ?*/ * /*? ret_ptr ?*/ = &/*? ret ?*/;
-                            /*-- endif --*/
-                            * /*? ret_ptr ?*/ =
-                        /*-- endif --*/
-                        /*? me.interface.name ?*/_/*? m.name ?*/(
-                            /*-- for p in m.parameters -*/
-                                /*-- if p.array -*/
-                                    /*-- if p.direction == 'in' -*/* /*- endif --*/
-                                    p_/*? p.name ?*/_sz_ptr,
-                                /*-- endif -*/
-                                /*-- if p.direction =='in' --*/* /*- endif --*/
-                                p_/*? p.name ?*/_ptr
-                                /*-- if not loop.last -*/,/*- endif --*/
-                            /*-- endfor --*/
-                        );
-
-                        /*? complete_recv(connector) ?*/
-                        /*? begin_reply(connector) ?*/
-
-                        /* Marshal the response */
-                        /*-- set output_parameters = list(filter(lambda('x: x.direction in [\'out\', \'inout\']'), m.parameters)) -*/
-                        length = /*? marshal.call_marshal_output('%s_marshal_outputs' % m.name, connector.send_buffer, connector.send_buffer_size, output_parameters, m.return_type, ret_ptr, namespace_prefix='p_') ?*/;
-
-                        /*#- We no longer need anything we previously malloced #*/
-                        /*-- if m.return_type == 'string' -*/
-                            free(* /*? ret_ptr ?*/);
-                        /*-- endif -*/
-                        /*-- for p in m.parameters -*/
-                            /*-- if p.array -*/
-                                /*-- if p.type == 'string' -*/
-                                    for (int mcount = 0; mcount < * p_/*? p.name ?*/_sz_ptr; mcount++) {
-                                        free((* p_/*? p.name ?*/_ptr)[mcount]);
-                                    }
-                                /*-- endif -*/
-                                free(* p_/*? p.name ?*/_ptr);
-                            /*-- elif p.type == 'string' -*/
-                                free(* p_/*? p.name ?*/_ptr);
-                            /*-- endif -*/
-                        /*-- endfor -*/
-
-                        /*
-                            priority-extensions:
-
-                            Call hook for priority protocol after CPI procedure function run
-                        */
-                        priority_post(&/*? me.interface.name ?*/_info);
-
-                        /* Check if there was an error during marshalling. We do
-                         * this after freeing internal parameter variables to avoid
-                         * leaking memory on errors.
-                         */
-                        if (unlikely(length == UINT_MAX)) {
-                            /*?- complete_reply(connector) ?*/
-                            goto begin_recv;
-                        }
-
-                        goto reply_recv;
-                    }
-                /*- endfor -*/
-                default: {
-                    ERR(/*? error_handler ?*/, ((camkes_error_t){
-                        .type = CE_INVALID_METHOD_INDEX,
-                        .instance = "/*? instance ?*/",
-                        .interface = "/*? interface ?*/",
-                        .description = "invalid method index received in /*? me.interface.name ?*/",
-                        .lower_bound = 0,
-                        .upper_bound = /*? methods_len ?*/ - 1,
-                        .invalid_index = * call_ptr,
-                    }), ({
-                        /*? complete_recv(connector) ?*/
-                        goto begin_recv;
-                    }));
-                }
-            }
             /*- if len(type_dict.keys()) > 1 -*/
                 break;
             }
@@ -268,19 +380,406 @@ int /*- if passive -*/
         }
         /*- endif -*/
 
+        /*- if pure_indices -*/
+            /*
+                priority-extensions:
+
+                Pure methods reply from the memo cache on a hit,
+                without entering the priority protocol or calling the procedure.
+                On a miss, keep a copy of the marshalled inputs to key the result,
+                as the reply overwrites the receive buffer.
+            */
+            unsigned memo_key_len = 0;
+            unsigned char memo_key[MEMO_CACHE_KEY_SIZE];
+            switch (method) {
+                /*- for i in pure_indices -*/
+                case /*? i ?*/:
+                /*- endfor -*/
+                    if (/*? payload_size ?*/ <= MEMO_CACHE_KEY_SIZE) {
+                        struct Memo_Entry * memo_entry = memo_cache_lookup(&/*? me.interface.name ?*/_memo,
+                                method_tag, /*? payload ?*/, /*? payload_size ?*/);
+                        if (memo_entry) {
+                            /*? complete_recv(connector) ?*/
+                            /*? begin_reply(connector) ?*/
+                            memcpy(/*? connector.send_buffer ?*/, memo_entry->reply, memo_entry->reply_len);
+                            length = memo_entry->reply_len;
+                            goto reply_recv;
+                        }
+                        memo_key_len = /*? payload_size ?*/;
+                        memcpy(memo_key, /*? payload ?*/, memo_key_len);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        /*- endif -*/
+
+        /*- if idempotent_indices -*/
+            /*
+                priority-extensions:
+
+                An idempotent method identical to a request in progress attaches to it,
+                and replies with its leader's reply, without entering the priority protocol.
+                Otherwise, it leads, so that identical requests arriving later attach to it.
+            */
+            struct Coalesced_Request * coalesced = NULL;
+            switch (method) {
+                /*- for i in idempotent_indices -*/
+                case /*? i ?*/:
+                /*- endfor -*/
+                    if (/*? payload_size ?*/ <= REQUEST_COALESCING_KEY_SIZE) {
+                        coalesced = request_coalescing_find(&/*? me.interface.name ?*/_coalescing,
+                                method_tag, /*? payload ?*/, /*? payload_size ?*/);
+                        if (coalesced) {
+                            request_coalescing_attach(&/*? me.interface.name ?*/_coalescing, coalesced,
+                                    priority, &/*? me.interface.name ?*/_info);
+                            /*? complete_recv(connector) ?*/
+                            /*? begin_reply(connector) ?*/
+                            length = request_coalescing_reply(coalesced, /*? connector.send_buffer ?*/);
+                            if (unlikely(length == UINT_MAX)) {
+                                /*?- complete_reply(connector) ?*/
+                                goto begin_recv;
+                            }
+                            goto reply_recv;
+                        }
+                        coalesced = request_coalescing_lead(&/*? me.interface.name ?*/_coalescing,
+                                method_tag, /*? payload ?*/, /*? payload_size ?*/, priority);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        /*- endif -*/
+
+        /*
+            priority-extensions:
+
+            Call hook for priority protocol as soon as the method index is known,
+            before parameters are unmarshalled (which may allocate memory).
+            This keeps the time a request spends at the threadpool's ceiling priority
+            to a minimum before it is demoted, or blocks under PIP.
+            Also sets the thread's effective priority for nested requests.
+        */
+        /*- if inversion_monitor -*/
+            inversion.priority = priority;
+            inversion.entering = priority_clock_cycles();
+        /*- endif -*/
+        /*- if utilisation_accounting -*/
+            //Sample the thread's utilisation, so the request is charged the CPU time it consumes from here
+            struct Utilisation_Sample utilisation;
+            utilisation_begin(&utilisation, utilisation_client(&/*? me.interface.name ?*/_utilisation,
+                    /*? connector.badge_symbol ?*/), priority);
+        /*- endif -*/
+        /*- if preserve_msg -*/
+            /*
+                Waiting for the PIP lock receives on a notification object,
+                which overwrites the first message registers in the IPC buffer (see seL4_Wait),
+                so keep a copy of those still to be unmarshalled, and restore them once the lock is held
+            */
+            seL4_Word saved_msg[seL4_FastMessageRegisters];
+            memcpy(saved_msg, /*? connector.recv_buffer ?*/, sizeof(saved_msg));
+        /*- endif -*/
+        /*- if lock_domains > 1 -*/
+            //Under lock domains, methods keyed by an argument enter their domain once it is unmarshalled
+            unsigned lock_domain_mask = /*? 2 ** lock_domains - 1 ?*/u;
+            switch (method) {
+                /*- for m, methods_len, symbol in shared_methods -*/
+                    /*- if m.name in domain_masks -*/
+                case /*? loop.index0 ?*/: lock_domain_mask = /*? domain_masks[m.name] ?*/u; break;
+                    /*- elif m.name in key_methods -*/
+                case /*? loop.index0 ?*/: lock_domain_mask = 0; break;
+                    /*- endif -*/
+                /*- endfor -*/
+                default: break;
+            }
+            if (lock_domain_mask) {
+                priority_pre_domains(priority, &/*? me.interface.name ?*/_info, lock_domain_mask);
+            }
+        /*- else -*/
+            priority_pre(priority, &/*? me.interface.name ?*/_info);
+        /*- endif -*/
+        /*- if preserve_msg -*/
+            memcpy(/*? connector.recv_buffer ?*/, saved_msg, sizeof(saved_msg));
+        /*- endif -*/
+
+        /*- if inversion_monitor -*/
+            inversion_monitor_entered(&/*? me.interface.name ?*/_inversion, &inversion);
+        /*- endif -*/
+
+        /*- if admission_enabled -*/
+            //CPU time consumed from here until priority_post is charged to the client's budget
+            admission_start = admission_thread_cycles();
+        /*- endif -*/
+
+        switch (method) {
+            /*-- for m, methods_len, symbol in shared_methods -*/
+                case /*? loop.index0 ?*/: { /*? '%s%s%s%s%s' % ('/', '* ', m.name, ' *', '/') ?*/
+                    /*#- Declare parameters. #*/
+                    /*-- for p in m.parameters -*/
+
+                        /*-- if p.array -*/
+                            size_t p_/*? p.name ?*/_sz;
+                            size_t * p_/*? p.name ?*/_sz_ptr = &p_/*? p.name ?*/_sz;
+                            /*-- if p.type == 'string' -*/
+                                char ** p_/*? p.name ?*/ = NULL;
+                                char *** p_/*? p.name ?*/_ptr = &p_/*? p.name ?*/;
+                            /*-- else -*/
+                                /*? macros.show_type(p.type) ?*/ * p_/*? p.name ?*/ = NULL;
+                                /*? macros.show_type(p.type) ?*/ ** p_/*? p.name ?*/_ptr = &p_/*? p.name ?*/;
+                            /*-- endif -*/
+                        /*-- elif p.type == 'string' -*/
+                            char * p_/*? p.name ?*/ = NULL;
+                            char ** p_/*? p.name ?*/_ptr = &p_/*? p.name ?*/;
+                        /*-- else -*/
+                            /*? macros.show_type(p.type) ?*/ p_/*? p.name ?*/;
+                            /*? macros.show_type(p.type) ?*/ * p_/*? p.name ?*/_ptr = &p_/*? p.name ?*/;
+                        /*-- endif -*/
+                    /*-- endfor -*/
+
+                    /* Unmarshal parameters */
+                    /*-- set input_parameters = list(filter(lambda('x: x.direction in [\'refin\', \'in\', \'inout\']'), m.parameters)) -*/
+                    int err = /*? marshal.call_unmarshal_input('%s_unmarshal_inputs' % symbol, payload, payload_size, input_parameters, namespace_prefix='p_') ?*/;
+                    if (unlikely(err != 0)) {
+                        /* Error in unmarshalling; return to event loop. */
+                        goto method_error;
+                    }
+
+                    /*-- if m.name in key_methods -*/
+                        /*
+                            priority-extensions:
+
+                            Enter the lock domain selected by the key argument
+                        */
+                        priority_pre_domains(priority, &/*? me.interface.name ?*/_info,
+                                1u << ((unsigned) p_/*? key_methods[m.name] ?*/ % /*? lock_domains ?*/u));
+                        /*-- if inversion_monitor -*/
+                        inversion_monitor_entered(&/*? me.interface.name ?*/_inversion, &inversion);
+                        /*-- endif -*/
+                    /*-- endif -*/
+
+                    /* Call the implementation */
+                    /*-- set ret = "%s_ret" % (m.name) -*/
+                    /*-- set ret_sz = "%s_ret_sz" % (m.name) -*/
+                    /*-- set ret_ptr = "%s_ret_ptr" % (m.name) -*/
+                    /*-- set ret_sz_ptr = "%s_ret_sz_ptr" % (m.name) -*/
+                    /*-- if m.return_type is not none -*/
+                        /*-- if m.return_type == 'string' -*/
+                            char * /*? ret ?*/;
+                            char ** /*? ret_ptr ?*/ = &/*? ret ?*/;
+                        /*-- else -*/
+                            /*? macros.show_type(m.return_type) ?*/ /*? ret ?*/;
+                            /*? macros.show_type(m.return_type) ?*/ * /*? ret_ptr ?*/ = &/*? ret ?*/;
+                        /*-- endif --*/
+                        * /*? ret_ptr ?*/ =
+                    /*-- endif --*/
+                    /*? me.interface.name ?*/_/*? m.name ?*/(
+                        /*-- for p in m.parameters -*/
+                            /*-- if p.array -*/
+                                /*-- if p.direction == 'in' -*/* /*- endif --*/
+                                p_/*? p.name ?*/_sz_ptr,
+                            /*-- endif -*/
+                            /*-- if p.direction =='in' --*/* /*- endif --*/
+                            p_/*? p.name ?*/_ptr
+                            /*-- if not loop.last -*/,/*- endif --*/
+                        /*-- endfor --*/
+                    );
+
+                    /*? complete_recv(connector) ?*/
+                    /*? begin_reply(connector) ?*/
+
+                    /* Marshal the response */
+                    /*-- set output_parameters = list(filter(lambda('x: x.direction in [\'out\', \'inout\']'), m.parameters)) -*/
+                    length = /*? marshal.call_marshal_output('%s_marshal_outputs' % symbol, connector.send_buffer, connector.send_buffer_size, output_parameters, m.return_type, ret_ptr, namespace_prefix='p_') ?*/;
+
+                    /*#- We no longer need anything we previously malloced #*/
+                    /*-- if m.return_type == 'string' -*/
+                        free(* /*? ret_ptr ?*/);
+                    /*-- endif -*/
+                    /*-- for p in m.parameters -*/
+                        /*-- if p.array -*/
+                            /*-- if p.type == 'string' -*/
+                                for (int mcount = 0; mcount < * p_/*? p.name ?*/_sz_ptr; mcount++) {
+                                    free((* p_/*? p.name ?*/_ptr)[mcount]);
+                                }
+                            /*-- endif -*/
+                            free(* p_/*? p.name ?*/_ptr);
+                        /*-- elif p.type == 'string' -*/
+                            free(* p_/*? p.name ?*/_ptr);
+                        /*-- endif -*/
+                    /*-- endfor -*/
+
+                    goto method_complete;
+                }
+            /*- endfor -*/
+            default: {
+                ERR(/*? error_handler ?*/, ((camkes_error_t){
+                    .type = CE_INVALID_METHOD_INDEX,
+                    .instance = "/*? instance ?*/",
+                    .interface = "/*? interface ?*/",
+                    .description = "invalid method index received in /*? me.interface.name ?*/",
+                    .lower_bound = 0,
+                    .upper_bound = method_bound - 1,
+                    .invalid_index = method_index,
+                }), ({
+                    goto method_error;
+                }));
+            }
+        }
+
+/*
+    priority-extensions:
+
+    The steps common to every method, once its reply is marshalled
+*/
+method_complete: {
+    /*
+        priority-extensions:
+
+        Call hook for priority protocol after CPI procedure function run
+    */
+    /*- if inversion_monitor -*/
+        inversion_monitor_release(&/*? me.interface.name ?*/_inversion, &inversion);
+    /*- endif -*/
+    priority_post(&/*? me.interface.name ?*/_info);
+
+    /*- if inversion_monitor -*/
+        //Record the request's blocking, back at the ceiling priority
+        inversion_monitor_record(&/*? me.interface.name ?*/_inversion, &inversion);
+    /*- endif -*/
+
+    /*- if utilisation_accounting -*/
+        //Charge the request the CPU time it consumed, back at the ceiling priority
+        utilisation_end(&/*? me.interface.name ?*/_utilisation, &utilisation);
+    /*- endif -*/
+
+    /*- if admission_enabled -*/
+        //Deferred requests are not charged against the budget that deferred them
+        if (admission == admission_admit) {
+            admission_charge(&/*? me.interface.name ?*/_admission, admission_client,
+                    admission_arrival, admission_thread_cycles() - admission_start);
+        }
+    /*- endif -*/
+
+    /*- if pure_indices -*/
+        /*
+            priority-extensions:
+
+            Cache the marshalled reply of a pure method,
+            back at the ceiling priority (memo_key_len is only set by a pure method's cache miss)
+        */
+        if (memo_key_len && length != UINT_MAX) {
+            memo_cache_insert(&/*? me.interface.name ?*/_memo, method_tag,
+                    memo_key, memo_key_len, /*? connector.send_buffer ?*/, length);
+        }
+    /*- endif -*/
+
+    /*- if idempotent_indices -*/
+        //Send the reply of a request we lead to the requests attached to it, back at the ceiling priority
+        if (coalesced) {
+            request_coalescing_complete(coalesced, /*? connector.send_buffer ?*/, length);
+        }
+    /*- endif -*/
+
+    /* Check if there was an error during marshalling. We do
+     * this after freeing internal parameter variables to avoid
+     * leaking memory on errors.
+     */
+    if (unlikely(length == UINT_MAX)) {
+        /*?- complete_reply(connector) ?*/
+        goto begin_recv;
+    }
+
+    goto reply_recv;
+}
+
+/*
+    priority-extensions:
+
+    An invalid method index or parameters: leave the priority protocol entered after reading the method index
+    (not yet entered by a method keyed by an argument), and return to the event loop
+*/
+method_error: {
+    /*- if inversion_monitor -*/
+    //A request that entered the protocol still leaves the critical section, having observed its blocking
+    /*- endif -*/
+    /*- if lock_domains > 1 -*/
+    if (lock_domain_mask) {
+        /*- if inversion_monitor -*/
+        inversion_monitor_release(&/*? me.interface.name ?*/_inversion, &inversion);
+        /*- endif -*/
+        priority_post(&/*? me.interface.name ?*/_info);
+        /*- if inversion_monitor -*/
+        inversion_monitor_record(&/*? me.interface.name ?*/_inversion, &inversion);
+        /*- endif -*/
+    }
+    /*- else -*/
+    /*- if inversion_monitor -*/
+    inversion_monitor_release(&/*? me.interface.name ?*/_inversion, &inversion);
+    /*- endif -*/
+    priority_post(&/*? me.interface.name ?*/_info);
+    /*- if inversion_monitor -*/
+    inversion_monitor_record(&/*? me.interface.name ?*/_inversion, &inversion);
+    /*- endif -*/
+    /*- endif -*/
+    /*- if utilisation_accounting -*/
+    //Charge the request the CPU time it consumed, as for a request that completes
+    utilisation_end(&/*? me.interface.name ?*/_utilisation, &utilisation);
+    /*- endif -*/
+    /*- if admission_enabled -*/
+    //The time the request consumed is charged to its client's budget, as for a request that completes
+    if (admission == admission_admit) {
+        admission_charge(&/*? me.interface.name ?*/_admission, admission_client,
+                admission_arrival, admission_thread_cycles() - admission_start);
+    }
+    /*- endif -*/
+    /*- if idempotent_indices -*/
+    //The requests attached to a request we lead fail with it
+    if (coalesced) {
+        request_coalescing_complete(coalesced, NULL, UINT_MAX);
+    }
+    /*- endif -*/
+    /*? complete_recv(connector) ?*/
+    goto begin_recv;
+}
+
 /* These labels are used to reduce the same code getting generated for each
  * case statement.
  */
 reply_recv: {
+    priority_busy_end(&/*? me.interface.name ?*/_info);
+    /*- if num_continuations -*/
+        //priority-extensions: workers reply through the continuation's saved reply capability
+        if (!continuation_receiver) {
+            continuation_reply(&/*? me.interface.name ?*/_continuation_pool, continuation, length);
+            goto resume_continuation;
+        }
+    /*- endif -*/
     /*? reply_recv(connector, "length", "size", me.might_block()) ?*/
     continue;
 }
 
 begin_recv: {
+    priority_busy_end(&/*? me.interface.name ?*/_info);
+    /*- if num_continuations -*/
+        //priority-extensions: workers drop a continuation they cannot reply to
+        if (!continuation_receiver) {
+            continuation_discard(&/*? me.interface.name ?*/_continuation_pool, continuation);
+            goto resume_continuation;
+        }
+    /*- endif -*/
     /*? begin_recv(connector, "size", me.might_block()) ?*/
     continue;
 }
 
+/*- if num_continuations -*/
+resume_continuation: {
+    //priority-extensions: workers resume the highest-priority parked continuation
+    continuation = continuation_resume(&/*? me.interface.name ?*/_continuation_pool,
+            &/*? connector.badge_symbol ?*/, /*? connector.recv_buffer ?*/, &size);
+    continue;
+}
+/*- endif -*/
+
     }
 
     UNREACHABLE();
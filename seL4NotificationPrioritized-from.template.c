@@ -0,0 +1,58 @@
+/*
+ *
+ * seL4NotificationPrioritized-from.template.c
+ *
+ * Implements the emitter side of the prioritized event connectors
+ * for the priority-aware concurrency framework extensions.
+ *
+ * Each emit is a short request on an endpoint shared with the consumer's threadpool,
+ * carrying the emitter's effective priority in the first message register.
+ * The consumer replies as soon as a threadpool thread receives the event,
+ * so the emitter only blocks if every threadpool thread is busy.
+ * See priority-events.h for more details.
+ *
+ */
+
+/*- if configuration[me.instance.name].get('environment', 'c').lower() == 'c' -*/
+
+#include <camkes.h>
+#include <sel4/sel4.h>
+#include <utils/attribute.h>
+
+/*
+  priority-extensions:
+
+  Include the per-thread priority context from the priority protocols library
+*/
+#include "../priority-aware-camkes/priority-protocols/priority-context.h"
+
+/*? macros.show_includes(me.instance.type.includes) ?*/
+
+/*- set ep_obj = alloc_obj('ep', seL4_EndpointObject) -*/
+/*- set ep = alloc_cap('ep', ep_obj, write=True, grantreply=True) -*/
+
+/*
+  Priority to send if the emitting thread has not set an effective priority.
+  This is the case for a task's control thread,
+  whose priority is given by the component's _priority attribute.
+*/
+/*- set default_priority = configuration[me.instance.name].get('_priority') -*/
+/*- if default_priority is none -*/
+  /*- set default_priority = 'CONFIG_CAMKES_DEFAULT_PRIORITY' -*/
+/*- endif -*/
+
+void /*? me.interface.name ?*/_emit(void) {
+
+    //The event carries the emitter's effective priority
+    int priority = get_effective_priority();
+    if (priority == PRIORITY_CONTEXT_UNSET) {
+        priority = /*? default_priority ?*/;
+    }
+
+    seL4_SetMR(0, (seL4_Word) priority);
+
+    //Returns once a threadpool thread has received the event
+    seL4_Call(/*? ep ?*/, seL4_MessageInfo_new(0, 0, 0, 1));
+}
+
+/*- endif -*/
@@ -0,0 +1,122 @@
+/*
+ *
+ * seL4NotificationPrioritized-to.template.c
+ *
+ * Implements the consumer side of the prioritized event connectors
+ * for the priority-aware concurrency framework extensions.
+ *
+ * Instead of the _wait, _poll and _reg_callback functions of a standard event interface,
+ * the component supplies an event handler, NAME_handle(void),
+ * which a threadpool thread runs for each event
+ * according to the interface's priority protocol.
+ * The handler may read the event's priority with get_effective_priority,
+ * except under the fixed protocol, for which it is the interface's priority.
+ * See priority-events.h for more details.
+ *
+ */
+
+/*- if configuration[me.instance.name].get('environment', 'c').lower() == 'c' -*/
+
+#include <camkes.h>
+#include <sel4/sel4.h>
+#include <utils/attribute.h>
+#include <utils/util.h>
+
+/*
+  priority-extensions:
+
+  Include necessary declarations from the priority protocols library
+*/
+#include "../priority-aware-camkes/priority-protocols/priority-protocols.h"
+#include "../priority-aware-camkes/priority-protocols/priority-events.h"
+
+/*? macros.show_includes(me.instance.type.includes) ?*/
+
+/*- set ep = alloc('ep', seL4_EndpointObject, read=True) -*/
+
+//Create component-scoped structs for the interface's Priority_Protocol information and event dispatch
+struct Priority_Protocol /*? me.interface.name ?*/_info;
+struct Priority_Events /*? me.interface.name ?*/_events;
+
+//Component-defined event handler
+extern void /*? me.interface.name ?*/_handle(void);
+
+/*
+  Template-defined __init function to initialize priority protocols,
+  overrides component interface __init function.
+  Instead, component writer supplies an _init function
+  (note the single, instead of double, underscore)
+*/
+extern void /*? me.interface.name ?*/_init(void);
+void /*? me.interface.name ?*/__init(void) {
+
+    //Get priority protocol specified by component attribute
+
+    /*- set protocols = ("propagated", "inherited", "fixed") -*/
+    /*- set attr = '%s_priority_protocol' % me.interface.name -*/
+    /*- set priority_protocol = configuration[me.instance.name].get(attr) -*/
+    /*- if priority_protocol not in protocols -*/
+      /*? raise(TemplateError('Invalid attribute "%s" for %s, must be one of "propagated", "inherited", "fixed"' % (priority_protocol, attr), me.parent)) ?*/
+    /*- endif -*/
+
+    //Initialize the Priority_Protocol and Priority_Events structs
+
+    priority_protocol_init(&/*? me.interface.name ?*/_info,
+        /*? priority_protocol ?*/,
+        CAMKES_CONST_ATTR(/*? me.interface.name ?*/_priority));
+    priority_events_init(&/*? me.interface.name ?*/_events);
+
+    //Events waiting for the handler (under inherited or fixed) need a Notification Manager
+
+    /*- if priority_protocol in ("inherited", "fixed") -*/
+
+      //Get the number of threads specified by component attribute
+
+      /*- set attr = '%s_num_threads' % me.interface.name -*/
+      /*- set num_threads = int(configuration[me.instance.name].get(attr)) -*/
+
+      /*
+        Allocates a static array of notification objects.
+        Even though it's in the init function scope,
+        each object's CPtr is bound to a Notification Node
+        and so can be accessed from component scope
+      */
+      static seL4_CPtr ntfn_objs[/*? num_threads ?*/];
+      /*- for i in range(num_threads) -*/
+          /*- set ntfn = alloc('%s_ntfn_obj_%d' % (me.interface.name, i), seL4_NotificationObject, read=True, write=True) -*/
+          ntfn_objs[/*? i ?*/] = /*? ntfn ?*/;
+      /*- endfor -*/
+
+      /*- if priority_protocol == "inherited" -*/
+        PRIORITY_INHERITANCE_INIT(&/*? me.interface.name ?*/_info, /*? num_threads ?*/,
+            CAMKES_CONST_ATTR(/*? me.interface.name ?*/_priority))
+        NOTIFICATION_MANAGER_INIT(&/*? me.interface.name ?*/_info.pip->ntfn_mgr, ntfn_objs, /*? num_threads ?*/);
+      /*- else -*/
+        NOTIFICATION_MANAGER_INIT(&/*? me.interface.name ?*/_events.ntfn_mgr, ntfn_objs, /*? num_threads ?*/);
+      /*- endif -*/
+    /*- endif -*/
+
+    /*? me.interface.name ?*/_init();
+}
+
+int /*? me.interface.name ?*/__run(void) {
+
+    while (1) {
+
+        //Threadpool threads wait for events at the interface's ceiling priority
+        seL4_Word badge;
+        seL4_Recv(/*? ep ?*/, &badge);
+        int priority = (int) seL4_GetMR(0);
+
+        //Release the emitter before handling the event
+        seL4_Reply(seL4_MessageInfo_new(0, 0, 0, 0));
+
+        priority_event_pre(priority, &/*? me.interface.name ?*/_info, &/*? me.interface.name ?*/_events);
+        /*? me.interface.name ?*/_handle();
+        priority_event_post(&/*? me.interface.name ?*/_info, &/*? me.interface.name ?*/_events);
+    }
+
+    UNREACHABLE();
+}
+
+/*- endif -*/
@@ -0,0 +1,78 @@
+/*
+ *
+ * seL4PriorityRelease-from.template.c
+ *
+ * Implements the releasing side of the priority release connector
+ * for the priority-aware concurrency framework extensions.
+ *
+ * The from end is the releases interface of a ReleaseServer component
+ * (see priority-release-server), and each to end is a periodic task.
+ * A notification object is allocated for each task,
+ * and the template generates the ReleaseServer's release schedule,
+ * from each task's NAME_period_us and NAME_offset_us attributes,
+ * sorted by descending task priority.
+ * See release-schedule.h for more details.
+ *
+ */
+
+/*- if configuration[me.instance.name].get('environment', 'c').lower() == 'c' -*/
+
+#include <camkes.h>
+#include <sel4/sel4.h>
+#include <utils/util.h>
+
+/*
+  priority-extensions:
+
+  Include the release schedule from the priority protocols library
+*/
+#include "../priority-aware-camkes/priority-protocols/release-schedule.h"
+
+/*? macros.show_includes(me.instance.type.includes) ?*/
+
+/*- set tasks = [] -*/
+/*- for end in me.parent.to_ends -*/
+
+  /*- set index = loop.index0 -*/
+
+  /*- set attr = '%s_period_us' % end.interface.name -*/
+  /*- set period_us = configuration[end.instance.name].get(attr) -*/
+  /*- if period_us is none or int(period_us) <= 0 -*/
+    /*? raise(TemplateError('Missing or invalid attribute %s for %s, must be a positive period' % (attr, end.instance.name), me.parent)) ?*/
+  /*- endif -*/
+  /*- set offset_us = int(configuration[end.instance.name].get('%s_offset_us' % end.interface.name, 0)) -*/
+
+  /*- set priority = configuration[end.instance.name].get('_priority') -*/
+  /*- if priority is none -*/
+    /*? raise(TemplateError('Missing attribute _priority for %s, released tasks must be prioritized' % end.instance.name, me.parent)) ?*/
+  /*- endif -*/
+
+  /*- set ntfn_obj = alloc_obj('release_ntfn_%d' % index, seL4_NotificationObject) -*/
+  /*- set ntfn = alloc_cap('release_ntfn_%d' % index, ntfn_obj, write=True) -*/
+
+  //Badged, so that a release can be polled for
+  /*- do cap_space.cnode[ntfn].set_badge(1) -*/
+
+  /*- do tasks.append((int(priority), index, '%s.%s' % (end.instance.name, end.interface.name), int(period_us), offset_us, ntfn)) -*/
+
+/*- endfor -*/
+
+/*
+  The release schedule, sorted by descending priority,
+  with ties released in the order of the connection's to ends
+*/
+struct Release_Entry /*? me.interface.name ?*/_entries[] = {
+/*- for priority, index, name, period_us, offset_us, ntfn in tasks | sort(attribute='1') | sort(attribute='0', reverse=True) -*/
+    {
+        .name = "/*? name ?*/",
+        .priority = /*? priority ?*/,
+        .period_ns = /*? period_us ?*/ * NS_IN_US,
+        .offset_ns = /*? offset_us ?*/ * NS_IN_US,
+        .ntfn = /*? ntfn ?*/,
+    },
+/*- endfor -*/
+};
+
+const unsigned /*? me.interface.name ?*/_num_entries = ARRAY_SIZE(/*? me.interface.name ?*/_entries);
+
+/*- endif -*/
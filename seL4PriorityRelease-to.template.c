@@ -0,0 +1,43 @@
+/*
+ *
+ * seL4PriorityRelease-to.template.c
+ *
+ * Implements the periodic task side of the priority release connector
+ * for the priority-aware concurrency framework extensions.
+ *
+ * The task's notification object is signalled by the ReleaseServer
+ * every NAME_period_us microseconds.
+ * As for a standard event interface, the task waits for its next release
+ * with NAME_wait(), or polls for it with NAME_poll().
+ * NAME_notification() gives the notification object itself,
+ * e.g., for periodic_task_run (see periodic-task.h).
+ * Releases are coalesced by the notification object while a job overruns.
+ *
+ */
+
+/*- if configuration[me.instance.name].get('environment', 'c').lower() == 'c' -*/
+
+#include <camkes.h>
+#include <sel4/sel4.h>
+
+/*? macros.show_includes(me.instance.type.includes) ?*/
+
+/*- set index = me.parent.to_ends.index(me) -*/
+/*- set ntfn_obj = alloc_obj('release_ntfn_%d' % index, seL4_NotificationObject) -*/
+/*- set ntfn = alloc_cap('release_ntfn_%d' % index, ntfn_obj, read=True) -*/
+
+void /*? me.interface.name ?*/_wait(void) {
+    seL4_Wait(/*? ntfn ?*/, NULL);
+}
+
+int /*? me.interface.name ?*/_poll(void) {
+    seL4_Word badge;
+    seL4_Poll(/*? ntfn ?*/, &badge);
+    return badge != 0;
+}
+
+seL4_CPtr /*? me.interface.name ?*/_notification(void) {
+    return /*? ntfn ?*/;
+}
+
+/*- endif -*/
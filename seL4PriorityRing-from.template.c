@@ -0,0 +1,103 @@
+/*
+ *
+ * seL4PriorityRing-from.template.c
+ *
+ * Implements the producer side of the priority ring connectors
+ * for the priority-aware concurrency framework extensions.
+ *
+ * The dataport itself is shared as by the seL4SharedData connector.
+ * Instead of writing to the dataport directly, the component reserves a slot with NAME_reserve(),
+ * writes its message in place, then commits it with NAME_commit(),
+ * tagged with the producing thread's effective priority.
+ * See priority-ring.h for more details.
+ *
+ */
+
+/*- include 'seL4SharedData-from.template.c' -*/
+
+/*- if configuration[me.instance.name].get('environment', 'c').lower() == 'c' -*/
+
+#include <camkes.h>
+#include <sel4/sel4.h>
+#include <stddef.h>
+
+/*
+  priority-extensions:
+
+  Include necessary declarations from the priority protocols library
+*/
+#include "../priority-aware-camkes/priority-protocols/priority-context.h"
+#include "../priority-aware-camkes/priority-protocols/priority-ring.h"
+
+//The ring is configured by attributes of the consuming interface
+
+/*- set to_end = me.parent.to_end -*/
+/*- set to_config = configuration[to_end.instance.name] -*/
+/*- set num_producers = len(me.parent.from_ends) -*/
+/*- set producer = me.parent.from_ends.index(me) -*/
+/*- set num_consumers = int(to_config.get('%s_num_threads' % to_end.interface.name)) -*/
+
+/*
+  Each waiter, producer or consumer, has its own notification object.
+  This producer waits on its own, and signals the consumers'
+*/
+static seL4_CPtr /*? me.interface.name ?*/_ring_ntfns[/*? num_producers + num_consumers ?*/] = {
+/*- for i in range(num_producers + num_consumers) -*/
+  /*- set ntfn_obj = alloc_obj('ring_ntfn_%d' % i, seL4_NotificationObject) -*/
+  /*- if i == producer -*/
+    /*- set ntfn = alloc_cap('ring_ntfn_%d' % i, ntfn_obj, read=True) -*/
+    [/*? i ?*/] = /*? ntfn ?*/,
+  /*- elif i >= num_producers -*/
+    /*- set ntfn = alloc_cap('ring_ntfn_%d' % i, ntfn_obj, write=True) -*/
+    [/*? i ?*/] = /*? ntfn ?*/,
+  /*- endif -*/
+/*- endfor -*/
+};
+
+static struct Priority_Ring /*? me.interface.name ?*/_ring = {
+    .ceiling = /*? to_config.get('%s_priority' % to_end.interface.name) ?*/,
+    .num_slots = /*? to_config.get('%s_ring_slots' % to_end.interface.name, 8) ?*/,
+    .slot_size = /*? to_config.get('%s_ring_slot_size' % to_end.interface.name, 256) ?*/,
+    .num_producers = /*? num_producers ?*/,
+    .num_consumers = /*? num_consumers ?*/,
+    .ntfns = /*? me.interface.name ?*/_ring_ntfns
+};
+
+/*
+  Priority to send if the producing thread has not set an effective priority.
+  This is the case for a task's control thread,
+  whose priority is given by the component's _priority attribute.
+*/
+/*- set default_priority = configuration[me.instance.name].get('_priority') -*/
+/*- if default_priority is none -*/
+  /*- set default_priority = 'CONFIG_CAMKES_DEFAULT_PRIORITY' -*/
+/*- endif -*/
+
+static int /*? me.interface.name ?*/_ring_priority(void) {
+    int priority = get_effective_priority();
+    if (priority == PRIORITY_CONTEXT_UNSET) {
+        priority = /*? default_priority ?*/;
+    }
+    return priority;
+}
+
+size_t /*? me.interface.name ?*/_slot_size(void) {
+    return /*? me.interface.name ?*/_ring.slot_size;
+}
+
+void * /*? me.interface.name ?*/_reserve(void) {
+
+    //The ring is bound to the dataport on first use
+    priority_ring_init(&/*? me.interface.name ?*/_ring, (void *) /*? me.interface.name ?*/,
+        /*? macros.dataport_size(me.interface.type) ?*/);
+
+    return priority_ring_reserve(&/*? me.interface.name ?*/_ring, /*? producer ?*/,
+        /*? me.interface.name ?*/_ring_priority());
+}
+
+void /*? me.interface.name ?*/_commit(void * slot, size_t length) {
+    priority_ring_commit(&/*? me.interface.name ?*/_ring, slot, length,
+        /*? me.interface.name ?*/_ring_priority());
+}
+
+/*- endif -*/
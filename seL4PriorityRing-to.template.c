@@ -0,0 +1,104 @@
+/*
+ *
+ * seL4PriorityRing-to.template.c
+ *
+ * Implements the consumer side of the priority ring connectors
+ * for the priority-aware concurrency framework extensions.
+ *
+ * The dataport itself is shared as by the seL4SharedData connector.
+ * The component supplies a message handler, NAME_handle(void * data, size_t length),
+ * which a threadpool thread runs for each committed message, highest-priority first,
+ * at the message's priority (also available to the handler with get_effective_priority).
+ * The message's slot is released once the handler returns.
+ * See priority-ring.h for more details.
+ *
+ */
+
+/*- include 'seL4SharedData-to.template.c' -*/
+
+/*- if configuration[me.instance.name].get('environment', 'c').lower() == 'c' -*/
+
+#include <camkes.h>
+#include <sel4/sel4.h>
+#include <stddef.h>
+#include <utils/util.h>
+
+/*
+  priority-extensions:
+
+  Include necessary declarations from the priority protocols library
+*/
+#include "../priority-aware-camkes/priority-protocols/priority-context.h"
+#include "../priority-aware-camkes/priority-protocols/priority-ring.h"
+
+/*- set num_producers = len(me.parent.from_ends) -*/
+/*- set attr = '%s_num_threads' % me.interface.name -*/
+/*- set num_consumers = int(configuration[me.instance.name].get(attr)) -*/
+/*- set num_slots = int(configuration[me.instance.name].get('%s_ring_slots' % me.interface.name, 8)) -*/
+/*- if num_slots < 1 -*/
+  /*? raise(TemplateError('Invalid attribute %s_ring_slots for %s, must be at least 1' % (me.interface.name, me.instance.name), me.parent)) ?*/
+/*- endif -*/
+
+/*
+  Each waiter, producer or consumer, has its own notification object.
+  Threadpool threads wait on their own, and signal the producers'
+*/
+static seL4_CPtr /*? me.interface.name ?*/_ring_ntfns[/*? num_producers + num_consumers ?*/] = {
+/*- for i in range(num_producers + num_consumers) -*/
+  /*- set ntfn_obj = alloc_obj('ring_ntfn_%d' % i, seL4_NotificationObject) -*/
+  /*- if i < num_producers -*/
+    /*- set ntfn = alloc_cap('ring_ntfn_%d' % i, ntfn_obj, write=True) -*/
+  /*- else -*/
+    /*- set ntfn = alloc_cap('ring_ntfn_%d' % i, ntfn_obj, read=True) -*/
+  /*- endif -*/
+    [/*? i ?*/] = /*? ntfn ?*/,
+/*- endfor -*/
+};
+
+static struct Priority_Ring /*? me.interface.name ?*/_ring = {
+    .ceiling = CAMKES_CONST_ATTR(/*? me.interface.name ?*/_priority),
+    .num_slots = /*? num_slots ?*/,
+    .slot_size = /*? configuration[me.instance.name].get('%s_ring_slot_size' % me.interface.name, 256) ?*/,
+    .num_producers = /*? num_producers ?*/,
+    .num_consumers = /*? num_consumers ?*/,
+    .ntfns = /*? me.interface.name ?*/_ring_ntfns
+};
+
+//Component-defined message handler
+extern void /*? me.interface.name ?*/_handle(void * data, size_t length);
+
+/*
+  Template-defined __init function to bind the ring to its dataport,
+  overrides component interface __init function.
+  Instead, component writer supplies an _init function
+  (note the single, instead of double, underscore)
+*/
+extern void /*? me.interface.name ?*/_init(void);
+void /*? me.interface.name ?*/__init(void) {
+
+    priority_ring_init(&/*? me.interface.name ?*/_ring, (void *) /*? me.interface.name ?*/,
+        /*? macros.dataport_size(me.interface.type) ?*/);
+
+    /*? me.interface.name ?*/_init();
+}
+
+int /*? me.interface.name ?*/__run(void) {
+
+    /*
+      Number each threadpool thread as a waiter.
+      Threadpool threads start at the ceiling priority,
+      so the counter is not manipulated concurrently
+    */
+    static unsigned next_consumer = 0;
+    unsigned consumer = next_consumer++;
+
+    set_effective_priority(/*? me.interface.name ?*/_ring.ceiling);
+
+    while (1) {
+        priority_ring_dispatch(&/*? me.interface.name ?*/_ring, consumer, /*? me.interface.name ?*/_handle);
+    }
+
+    UNREACHABLE();
+}
+
+/*- endif -*/
@@ -0,0 +1,117 @@
+/*
+ *
+ * sel4RPCCallPrioritized-from.template.c
+ *
+ * All code taken, except where noted (with a priority-extensions label),
+ * from the seL4 camkes-tool repo, /camkes/templates/seL4RPCCall-from.template.c
+ *
+ * Implements CAmkES seL4 RPC Call (sender side) functionality,
+ * with additions for the priority-aware concurrency framework extensions.
+ *
+ */
+
+/*- if configuration[me.instance.name].get('environment', 'c').lower() == 'c' -*/
+
+/*- from 'rpc-connector.c' import establish_from_rpc, begin_send, perform_call, release_recv with context -*/
+
+#include <camkes/dataport.h>
+#include <utils/attribute.h>
+
+/*
+  priority-extensions:
+
+  Include the per-thread priority context from the priority protocols library
+*/
+#include "../priority-aware-camkes/priority-protocols/priority-context.h"
+
+/*? macros.show_includes(me.instance.type.includes) ?*/
+/*? macros.show_includes(me.interface.type.includes) ?*/
+
+/*- set connector = namespace() -*/
+
+/*- set buffer = configuration[me.parent.name].get('buffer') -*/
+/*- if buffer is none -*/
+  /*? establish_from_rpc(connector) ?*/
+/*- else -*/
+  /*- if not isinstance(buffer, six.string_types) -*/
+    /*? raise(TemplateError('invalid non-string setting for userspace buffer to back RPC connection', me.parent)) ?*/
+  /*- endif -*/
+  /*- if len(me.parent.from_ends) != 1 or len(me.parent.to_ends) != 1 -*/
+    /*? raise(TemplateError('invalid use of userspace buffer to back RPC connection that is not 1-to-1', me.parent)) ?*/
+  /*- endif -*/
+  /*- set c = list(filter(lambda('x: x.name == \'%s\'' % buffer), composition.connections)) -*/
+  /*- if len(c) == 0 -*/
+    /*? raise(TemplateError('invalid setting to non-existent connection for userspace buffer to back RPC connection', me.parent)) ?*/
+  /*- endif -*/
+  /*- if len(c[0].from_ends) != 1 or len(c[0].to_ends) != 1 -*/
+    /*? raise(TemplateError('invalid use of userspace buffer that is not 1-to-1 to back RPC connection', me.parent)) ?*/
+  /*- endif -*/
+  /*- if not isinstance(c[0].from_end.interface, camkes.ast.Dataport) -*/
+    /*? raise(TemplateError('invalid use of non-dataport to back RPC connection', me.parent)) ?*/
+  /*- endif -*/
+  extern /*? macros.dataport_type(c[0].from_end.interface.type) ?*/ * /*? c[0].from_end.interface.name ?*/;
+  /*? establish_from_rpc(connector, buffer=('((void*)%s)' % c[0].from_end.interface.name, macros.dataport_size(c[0].from_end.interface.type))) ?*/
+/*- endif -*/
+
+
+/*
+  priority-extensions:
+
+  Priority to send if the calling thread has not set an effective priority.
+  This is the case for a task's control thread,
+  whose priority is given by the component's _priority attribute.
+*/
+/*- set default_priority = configuration[me.instance.name].get('_priority') -*/
+/*- if default_priority is none -*/
+  /*- set default_priority = 'CONFIG_CAMKES_DEFAULT_PRIORITY' -*/
+/*- endif -*/
+
+/*
+  priority-extensions:
+
+  Requests to an interface with an inversion monitor also carry the time they were sent
+  (the replicas behind a routed connection are configured alike, so the first is checked)
+*/
+/*- set to_end = me.parent.to_ends[0] -*/
+/*- set inversion_monitor = int(configuration[to_end.instance.name].get('%s_inversion_monitor' % to_end.interface.name, 0)) -*/
+/*- if inversion_monitor -*/
+#include "../priority-aware-camkes/priority-protocols/priority-clock.h"
+/*- endif -*/
+
+/*
+  priority-extensions:
+
+  A client with the NAME_replay_enabled attribute can also send captured requests
+  with NAME_replay (see priority-replay).
+  The attribute is not named NAME_replay, as CAmkES also declares each attribute as a C symbol
+*/
+/*- set replay = int(configuration[me.instance.name].get('%s_replay_enabled' % me.interface.name, 0)) -*/
+
+/*
+  priority-extensions:
+
+  A client with the NAME_futures attribute can also make non-blocking calls,
+  with NAME_METHOD_async and NAME_METHOD_join (see priority-futures.h)
+*/
+/*- set futures = int(configuration[me.instance.name].get('%s_futures' % me.interface.name, 0)) -*/
+/*- if futures -*/
+  /*- if buffer is not none -*/
+    /*? raise(TemplateError('Invalid attribute %s_futures for %s, futures require the IPC buffer' % (me.interface.name, me.instance.name), me.parent)) ?*/
+  /*- endif -*/
+#include "../priority-aware-camkes/priority-protocols/priority-futures.h"
+/*- endif -*/
+
+/*
+  priority-extensions:
+
+  A client of a routed connection calls the replica its request is routed to
+  (see seL4RPCCallPrioritizedRouted-from.template.c)
+*/
+/*- if perform_routed_call is defined -*/
+  /*- set perform_call = perform_routed_call -*/
+/*- endif -*/
+
+//Include RPC priority connector template instead of default RPC connector template
+/*- include 'rpc-priority-connector-common-from.c' -*/
+
+/*- endif -*/
@@ -17,6 +17,7 @@
 #include <camkes/dataport.h>
 #include <camkes/allocator.h>
 #include <utils/attribute.h>
+#include <utils/util.h>
 
 /*
   priority-extensions:
@@ -54,6 +55,18 @@
   /*? establish_recv_rpc(connector, me.interface.name, buffer=('((void*)%s)' % c[0].to_end.interface.name, macros.dataport_size(c[0].to_end.interface.type))) ?*/
 /*- endif -*/
 
+/*
+  priority-extensions:
+
+  A replica behind a routed connection (see seL4RPCCallPrioritizedRouted-to.template.c)
+  receives on its own endpoint, from clients badged by their index
+*/
+/*- if replica_index is defined -*/
+  /*- set replica_ep_obj = alloc_obj('replica_ep_%d' % replica_index, seL4_EndpointObject) -*/
+  /*- set connector.ep = alloc_cap('replica_ep_%d' % replica_index, replica_ep_obj, read=True, write=True) -*/
+  /*- set connector.badges = range(1, len(me.parent.from_ends) + 1) | list -*/
+/*- endif -*/
+
 
 
 /*
@@ -66,6 +79,371 @@
 //Create a component-scoped struct for the interface Priority_Protocol information
 struct Priority_Protocol /*? me.interface.name ?*/_info;
 
+/*
+  Methods declared pure by the NAME_pure_methods attribute (a comma-separated list of method names)
+  have their replies cached in a Memo_Cache of NAME_memo_entries entries
+*/
+/*- set attr = '%s_pure_methods' % me.interface.name -*/
+/*- set pure_methods = configuration[me.instance.name].get(attr, '') -*/
+/*- if isinstance(pure_methods, six.string_types) -*/
+  /*- set pure_methods = pure_methods.split(',') | map('trim') | reject('equalto', '') | list -*/
+/*- endif -*/
+/*- set method_names = me.interface.type.methods | map(attribute='name') | list -*/
+/*- for name in pure_methods -*/
+  /*- if name not in method_names -*/
+    /*? raise(TemplateError('Invalid attribute "%s" for %s, "%s" is not a method of %s' % (pure_methods, attr, name, me.interface.name), me.parent)) ?*/
+  /*- endif -*/
+/*- endfor -*/
+
+/*- if pure_methods -*/
+#include "../priority-aware-camkes/priority-protocols/memo-cache.h"
+
+//Create a component-scoped result cache for the interface's pure methods
+struct Memo_Cache /*? me.interface.name ?*/_memo;
+/*- endif -*/
+
+/*
+  Per-client admission control, enabled by the NAME_admission_min_interarrival_us
+  or NAME_admission_budget_us (with NAME_admission_period_us) attributes.
+  The interface attributes apply to every client,
+  and may be overridden for a single client by the same attributes on its uses interface.
+*/
+/*- set admission_defaults = {} -*/
+/*- for limit in ('min_interarrival_us', 'budget_us', 'period_us') -*/
+  /*- do admission_defaults.update({limit: int(configuration[me.instance.name].get('%s_admission_%s' % (me.interface.name, limit), 0))}) -*/
+/*- endfor -*/
+/*- set admission_clients = [] -*/
+/*- set admission_enabled = [] -*/
+/*- for f in me.parent.from_ends -*/
+  /*- set client = {} -*/
+  /*- for limit in ('min_interarrival_us', 'budget_us', 'period_us') -*/
+    /*- do client.update({limit: int(configuration[f.instance.name].get('%s_admission_%s' % (f.interface.name, limit), admission_defaults[limit]))}) -*/
+  /*- endfor -*/
+  /*- if client['budget_us'] > 0 and (client['period_us'] <= 0 or client['budget_us'] > client['period_us']) -*/
+    /*? raise(TemplateError('Invalid admission budget for %s.%s, the period must be set and at least the budget' % (f.instance.name, f.interface.name), me.parent)) ?*/
+  /*- endif -*/
+  /*- if client['min_interarrival_us'] > 0 or client['budget_us'] > 0 -*/
+    /*- do admission_enabled.append(f) -*/
+  /*- endif -*/
+  /*- do admission_clients.append(client) -*/
+/*- endfor -*/
+
+/*- if admission_enabled -*/
+#include "../priority-aware-camkes/priority-protocols/admission-control.h"
+
+//Create a component-scoped struct for the interface's admission control
+struct Admission_Control /*? me.interface.name ?*/_admission;
+
+//Admission limits for each client, in the order of the connection's from ends
+static struct Admission_Client /*? me.interface.name ?*/_admission_clients[/*? len(admission_clients) ?*/] = {
+  /*- for client in admission_clients -*/
+    {
+        .badge = /*? connector.badges[loop.index0] ?*/,
+        .min_interarrival_us = /*? client['min_interarrival_us'] ?*/,
+        .budget_us = /*? client['budget_us'] ?*/,
+        .period_us = /*? client['period_us'] ?*/,
+    },
+  /*- endfor -*/
+};
+
+//Map a badge to the index of its client
+static unsigned /*? me.interface.name ?*/_admission_client(seL4_Word badge) {
+    switch (badge) {
+      /*- for client in admission_clients -*/
+        case /*? connector.badges[loop.index0] ?*/: return /*? loop.index0 ?*/;
+      /*- endfor -*/
+        default: return 0;
+    }
+}
+/*- endif -*/
+
+/*
+  Lock domains of a PIP interface, enabled by the NAME_lock_domains attribute (the number of domains).
+  NAME_method_domains maps methods to the domains they use,
+  e.g. "register:0, lookup:1, migrate:0+1",
+  and methods not mapped, but with an integer in parameter named by NAME_lock_key,
+  use the domain given by the key modulo the number of domains.
+  Any other method uses every domain.
+*/
+/*- set lock_domains = int(configuration[me.instance.name].get('%s_lock_domains' % me.interface.name, 1)) -*/
+/*- set domain_masks = {} -*/
+/*- set key_methods = {} -*/
+/*- if lock_domains > 1 -*/
+  /*- if configuration[me.instance.name].get('%s_priority_protocol' % me.interface.name) != 'inherited' -*/
+    /*? raise(TemplateError('Invalid attribute %s_lock_domains for %s, lock domains require the "inherited" protocol' % (me.interface.name, me.instance.name), me.parent)) ?*/
+  /*- endif -*/
+  /*- if lock_domains > 32 -*/
+    /*? raise(TemplateError('Invalid attribute "%s" for %s_lock_domains, must be at most 32' % (lock_domains, me.interface.name), me.parent)) ?*/
+  /*- endif -*/
+  /*- set attr = '%s_method_domains' % me.interface.name -*/
+  /*- set method_domains = configuration[me.instance.name].get(attr, '') -*/
+  /*- for entry in method_domains.split(',') | map('trim') | reject('equalto', '') -*/
+    /*- set parts = entry.split(':') | map('trim') | list -*/
+    /*- if len(parts) != 2 or parts[0] not in method_names -*/
+      /*? raise(TemplateError('Invalid attribute "%s" for %s, "%s" is not of the form method:domain+domain' % (method_domains, attr, entry), me.parent)) ?*/
+    /*- endif -*/
+    /*- set bits = [] -*/
+    /*- for domain in parts[1].split('+') | map('trim') | map('int') | unique -*/
+      /*- if domain < 0 or domain >= lock_domains -*/
+        /*? raise(TemplateError('Invalid attribute "%s" for %s, domain %d is out of range' % (method_domains, attr, domain), me.parent)) ?*/
+      /*- endif -*/
+      /*- do bits.append(2 ** domain) -*/
+    /*- endfor -*/
+    /*- do domain_masks.update({parts[0]: bits | sum}) -*/
+  /*- endfor -*/
+  /*- set lock_key = configuration[me.instance.name].get('%s_lock_key' % me.interface.name) -*/
+  /*- if lock_key -*/
+    /*- set integer_types = ('int', 'unsigned int', 'long', 'unsigned long', 'char', 'unsigned char', 'int8_t', 'int16_t', 'int32_t', 'int64_t', 'uint8_t', 'uint16_t', 'uint32_t', 'uint64_t', 'uintptr_t') -*/
+    /*- for m in me.interface.type.methods -*/
+      /*- if m.name not in domain_masks -*/
+        /*- for p in m.parameters -*/
+          /*- if p.name == lock_key and p.direction == 'in' and not p.array and p.type in integer_types -*/
+            /*- do key_methods.update({m.name: p.name}) -*/
+          /*- endif -*/
+        /*- endfor -*/
+      /*- endif -*/
+    /*- endfor -*/
+  /*- endif -*/
+/*- endif -*/
+
+/*
+  Methods declared idempotent by the NAME_idempotent_methods attribute (a comma-separated list of method names)
+  have identical concurrent requests coalesced into one, on PIP interfaces with a single lock
+*/
+/*- set attr = '%s_idempotent_methods' % me.interface.name -*/
+/*- set idempotent_methods = configuration[me.instance.name].get(attr, '') -*/
+/*- if isinstance(idempotent_methods, six.string_types) -*/
+  /*- set idempotent_methods = idempotent_methods.split(',') | map('trim') | reject('equalto', '') | list -*/
+/*- endif -*/
+/*- for name in idempotent_methods -*/
+  /*- if name not in method_names -*/
+    /*? raise(TemplateError('Invalid attribute "%s" for %s, "%s" is not a method of %s' % (idempotent_methods, attr, name, me.interface.name), me.parent)) ?*/
+  /*- endif -*/
+/*- endfor -*/
+
+/*- if idempotent_methods -*/
+  /*- if configuration[me.instance.name].get('%s_priority_protocol' % me.interface.name) != 'inherited' or lock_domains > 1 -*/
+    /*? raise(TemplateError('Invalid attribute %s for %s, coalescing requires the "inherited" protocol with a single lock domain' % (attr, me.instance.name), me.parent)) ?*/
+  /*- endif -*/
+  /*- if buffer is not none -*/
+    /*? raise(TemplateError('Invalid attribute %s for %s, coalescing requires the connection to use the IPC buffer' % (attr, me.instance.name), me.parent)) ?*/
+  /*- endif -*/
+#include "../priority-aware-camkes/priority-protocols/request-coalescing.h"
+
+//Create a component-scoped struct for coalescing the interface's idempotent requests
+struct Request_Coalescing /*? me.interface.name ?*/_coalescing;
+/*- endif -*/
+
+/*
+  Continuations, enabled by the NAME_continuations attribute
+  (the number of requests that may be in flight at once).
+  The threadpool's first thread becomes the receiver, and the rest its workers.
+*/
+/*- set attr = '%s_continuations' % me.interface.name -*/
+/*- set num_continuations = int(configuration[me.instance.name].get(attr, 0)) -*/
+/*- if num_continuations -*/
+  /*- set num_threads = int(configuration[me.instance.name].get('%s_num_threads' % me.interface.name)) -*/
+  /*- if num_threads < 2 -*/
+    /*? raise(TemplateError('Invalid attribute %s_num_threads for %s, continuations need a receiver and at least one worker' % (me.interface.name, me.instance.name), me.parent)) ?*/
+  /*- endif -*/
+  /*- if options.realtime and configuration[me.instance.name].get("%s_passive" % me.interface.name, False) -*/
+    /*? raise(TemplateError('Invalid attribute "%s" for passive interface %s' % (num_continuations, attr), me.parent)) ?*/
+  /*- endif -*/
+#include "../priority-aware-camkes/priority-protocols/continuations.h"
+
+//Create a component-scoped struct for the interface's continuations
+struct Continuation_Pool /*? me.interface.name ?*/_continuation_pool;
+/*- endif -*/
+
+/*
+  Workers for the component's futures (see priority-futures.h), enabled by the NAME_future_workers attribute
+  (the number of threadpool threads to make the calls of futures).
+  The threadpool's first threads to start become the workers, and the rest handle requests.
+*/
+/*- set attr = '%s_future_workers' % me.interface.name -*/
+/*- set future_workers = int(configuration[me.instance.name].get(attr, 0)) -*/
+/*- if future_workers -*/
+  /*- set num_threads = int(configuration[me.instance.name].get('%s_num_threads' % me.interface.name)) -*/
+  /*- if num_threads <= future_workers -*/
+    /*? raise(TemplateError('Invalid attribute "%s" for %s, %s_num_threads must leave a thread to handle requests' % (future_workers, attr, me.interface.name), me.parent)) ?*/
+  /*- endif -*/
+  /*- if num_continuations -*/
+    /*? raise(TemplateError('Invalid attribute "%s" for %s, futures cannot be combined with continuations' % (future_workers, attr), me.parent)) ?*/
+  /*- endif -*/
+  /*- if configuration[me.instance.name].get('%s_priority_protocol' % me.interface.name) == 'inherited' -*/
+    /*? raise(TemplateError('Invalid attribute "%s" for %s, the threads joining futures must not inherit priorities' % (future_workers, attr), me.parent)) ?*/
+  /*- endif -*/
+  /*- set worker_interfaces = [] -*/
+  /*- for p in me.instance.type.provides -*/
+    /*- if int(configuration[me.instance.name].get('%s_future_workers' % p.name, 0)) -*/
+      /*- do worker_interfaces.append(p.name) -*/
+    /*- endif -*/
+  /*- endfor -*/
+  /*- if len(worker_interfaces) > 1 -*/
+    /*? raise(TemplateError('Invalid attribute "%s" for %s, a component has a single pool of future workers, but %s all set them' % (future_workers, attr, ', '.join(worker_interfaces)), me.parent)) ?*/
+  /*- endif -*/
+  /*
+    Any thread of the component may join futures:
+    its control thread, and the threads of each interface it provides or event it consumes,
+    except the workers themselves
+  */
+  /*- set component_threads = [1] -*/
+  /*- for i in (me.instance.type.provides | list) + (me.instance.type.consumes | list) -*/
+    /*- do component_threads.append(int(configuration[me.instance.name].get('%s_num_threads' % i.name, 1))) -*/
+  /*- endfor -*/
+  /*- set num_joiners = component_threads | sum - future_workers -*/
+#include "../priority-aware-camkes/priority-protocols/priority-futures.h"
+/*- endif -*/
+
+/*
+  A component-wide pool of notification objects shared by the waiters of all of its PIP interfaces,
+  enabled by the component's notification_pool attribute.
+  A thread can only wait on one lock at a time, and each lock with waiters has a holder,
+  so the pool is sized by the threads of all PIP interfaces, minus one.
+*/
+/*- set notification_pool = int(configuration[me.instance.name].get('notification_pool', 0)) -*/
+/*- set pool_interfaces = [] -*/
+/*- set pool_threads = [] -*/
+/*- if notification_pool -*/
+  /*- for p in me.instance.type.provides | sort(attribute='name') -*/
+    /*- if configuration[me.instance.name].get('%s_priority_protocol' % p.name) == 'inherited' -*/
+      /*- do pool_interfaces.append(p.name) -*/
+      /*- do pool_threads.append(int(configuration[me.instance.name].get('%s_num_threads' % p.name))) -*/
+    /*- endif -*/
+  /*- endfor -*/
+/*- endif -*/
+/*- set pool_owner = pool_interfaces and pool_interfaces[0] == me.interface.name -*/
+/*- set pool_size = [pool_threads | sum - 1, 1] | max -*/
+
+/*
+  Runtime ceiling changes, enabled by the NAME_mode_ceilings attribute
+  (a comma-separated list of the CPI's ceiling in each of the system's modes)
+*/
+/*- set attr = '%s_mode_ceilings' % me.interface.name -*/
+/*- set mode_ceilings = configuration[me.instance.name].get(attr, '') -*/
+/*- if isinstance(mode_ceilings, six.string_types) -*/
+  /*- set mode_ceilings = mode_ceilings.split(',') | map('trim') | reject('equalto', '') | list -*/
+/*- endif -*/
+/*- set mode_ceilings = mode_ceilings | map('int') | list -*/
+
+/*- if mode_ceilings -*/
+static const int /*? me.interface.name ?*/_mode_ceiling_table[/*? len(mode_ceilings) ?*/] = {
+    /*? mode_ceilings | join(', ') ?*/
+};
+
+/*
+  Priority to return to if the calling thread has not set an effective priority.
+  This is the case for a component's control thread,
+  whose priority is given by the component's _priority attribute.
+*/
+/*- set default_priority = configuration[me.instance.name].get('_priority') -*/
+/*- if default_priority is none -*/
+  /*- set default_priority = 'CONFIG_CAMKES_DEFAULT_PRIORITY' -*/
+/*- endif -*/
+
+//Switch the interface's ceiling to that of the given mode
+void /*? me.interface.name ?*/_set_mode(unsigned mode) {
+
+    if (mode >= /*? len(mode_ceilings) ?*/) {
+        ZF_LOGE("Invalid mode %u for /*? me.interface.name ?*/.\n", mode);
+        return;
+    }
+
+    int priority = get_effective_priority();
+    if (priority == PRIORITY_CONTEXT_UNSET) {
+        priority = /*? default_priority ?*/;
+    }
+
+    priority_mode_change(&/*? me.interface.name ?*/_info, /*? me.interface.name ?*/_mode_ceiling_table[mode], priority);
+}
+/*- endif -*/
+
+/*
+  Runtime blocking and priority inversion monitoring, enabled by the NAME_inversion_monitor attribute.
+  Requests then also carry the time they were sent (see inversion-monitor.h).
+*/
+/*- set inversion_monitor = int(configuration[me.instance.name].get('%s_inversion_monitor' % me.interface.name, 0)) -*/
+
+/*- if inversion_monitor -*/
+#include "../priority-aware-camkes/priority-protocols/inversion-monitor.h"
+
+//Create a component-scoped struct for the interface's inversion monitor
+struct Inversion_Monitor /*? me.interface.name ?*/_inversion;
+
+//Clients of the interface, in the order of the connection's from ends
+static struct Inversion_Client /*? me.interface.name ?*/_inversion_clients[/*? len(me.parent.from_ends) ?*/] = {
+  /*- for f in me.parent.from_ends -*/
+    { .badge = /*? connector.badges[loop.index0] ?*/ },
+  /*- endfor -*/
+};
+/*- endif -*/
+
+/*
+  CPU utilisation accounting, per threadpool thread, client and request priority,
+  enabled by the NAME_utilisation_accounting attribute on a kernel built with
+  CONFIG_BENCHMARK_TRACK_UTILISATION (see utilisation-accounting.h)
+*/
+/*- set utilisation_accounting = int(configuration[me.instance.name].get('%s_utilisation_accounting' % me.interface.name, 0)) -*/
+
+/*- if utilisation_accounting -*/
+#include "../priority-aware-camkes/priority-protocols/utilisation-accounting.h"
+
+//Create a component-scoped struct for the interface's utilisation accounting
+struct Utilisation_Accounting /*? me.interface.name ?*/_utilisation;
+
+//Clients of the interface, in the order of the connection's from ends
+static struct Utilisation_Client /*? me.interface.name ?*/_utilisation_clients[/*? len(me.parent.from_ends) ?*/] = {
+  /*- for f in me.parent.from_ends -*/
+    { .badge = /*? connector.badges[loop.index0] ?*/ },
+  /*- endfor -*/
+};
+/*- endif -*/
+
+/*
+  Capture of the interface's requests for offline replay, enabled by the NAME_capture_dataport attribute,
+  naming a dataport of the component to hold the captured requests (see request-capture.h)
+*/
+/*- set attr = '%s_capture_dataport' % me.interface.name -*/
+/*- set capture_dataport = configuration[me.instance.name].get(attr) -*/
+
+/*- if capture_dataport -*/
+  /*- set d = list(filter(lambda('x: x.name == \'%s\'' % capture_dataport), me.instance.type.dataports)) -*/
+  /*- if len(d) == 0 -*/
+    /*? raise(TemplateError('Invalid attribute "%s" for %s, not a dataport of %s' % (capture_dataport, attr, me.instance.name), me.parent)) ?*/
+  /*- endif -*/
+  /*- set capture_dataport_size = macros.dataport_size(d[0].type) -*/
+#include "../priority-aware-camkes/priority-protocols/request-capture.h"
+
+extern /*? macros.dataport_type(d[0].type) ?*/ * /*? d[0].name ?*/;
+
+//Create a component-scoped struct for the interface's request capture
+struct Request_Capture /*? me.interface.name ?*/_request_capture;
+
+//Stop or restart capturing requests
+void /*? me.interface.name ?*/_capture_enable(int enabled) {
+    request_capture_enable(&/*? me.interface.name ?*/_request_capture, enabled);
+}
+
+//Print the captured requests, for priority-capture-convert.py
+void /*? me.interface.name ?*/_capture_dump(void) {
+    request_capture_dump(&/*? me.interface.name ?*/_request_capture, "/*? me.interface.name ?*/");
+}
+/*- endif -*/
+
+/*
+  Stack high-water marks of the threadpool threads, enabled by the NAME_stack_watermarks attribute.
+  Each thread paints its stack as it starts (see stack-watermark.h).
+*/
+/*- set stack_watermarks = int(configuration[me.instance.name].get('%s_stack_watermarks' % me.interface.name, 0)) -*/
+/*- set stack_size = configuration[me.instance.name].get('%s_stack_size' % me.interface.name, options.default_stack_size) -*/
+
+/*- if stack_watermarks -*/
+#include "../priority-aware-camkes/priority-protocols/stack-watermark.h"
+
+//Create a component-scoped struct for the interface's stack high-water marks
+struct Stack_Watermarks /*? me.interface.name ?*/_stack_watermarks;
+/*- endif -*/
+
 //Include RPC priority connector template instead of default RPC connector template
 /*- include 'rpc-priority-connector-common-to.c' -*/
 
@@ -80,11 +458,11 @@ void /*? me.interface.name ?*/__init(void) {
 
     //Get priority protocol specified by component attribute
   
-    /*- set protocols = ("propagated", "inherited", "fixed") -*/
+    /*- set protocols = ("propagated", "inherited", "fixed", "threshold") -*/
     /*- set attr = '%s_priority_protocol' % me.interface.name -*/
     /*- set priority_protocol = configuration[me.instance.name].get(attr) -*/
     /*- if priority_protocol not in protocols -*/
-      /*? raise(TemplateError('Invalid attribute "%s" for %s, must be one of "propagated", "inherited", "fixed"' % (priority_protocol, attr), me.parent)) ?*/
+      /*? raise(TemplateError('Invalid attribute "%s" for %s, must be one of "propagated", "inherited", "fixed", "threshold"' % (priority_protocol, attr), me.parent)) ?*/
     /*- endif -*/
 
     //Initialize the Priority_Protocol struct
@@ -92,6 +470,23 @@ void /*? me.interface.name ?*/__init(void) {
     priority_protocol_init(&/*? me.interface.name ?*/_info,
         /*? priority_protocol ?*/,
         CAMKES_CONST_ATTR(/*? me.interface.name ?*/_priority));
+
+    //If necessary, set the preemption threshold, which must not exceed the ceiling (in any mode)
+
+    /*- if priority_protocol == "threshold" -*/
+      /*- set attr = '%s_threshold' % me.interface.name -*/
+      /*- set threshold = configuration[me.instance.name].get(attr) -*/
+      /*- set ceiling = configuration[me.instance.name].get('%s_priority' % me.interface.name) -*/
+      /*- if threshold is none or (ceiling is not none and int(threshold) > int(ceiling)) -*/
+        /*? raise(TemplateError('Invalid attribute "%s" for %s, must be set and at most %s_priority' % (threshold, attr, me.interface.name), me.parent)) ?*/
+      /*- endif -*/
+      /*- for mode_ceiling in mode_ceilings -*/
+        /*- if int(threshold) > mode_ceiling -*/
+          /*? raise(TemplateError('Invalid attribute "%s" for %s, must be at most the ceiling of every mode in %s_mode_ceilings, but mode %d has ceiling %d' % (threshold, attr, me.interface.name, loop.index0, mode_ceiling), me.parent)) ?*/
+        /*- endif -*/
+      /*- endfor -*/
+      priority_threshold_init(&/*? me.interface.name ?*/_info, /*? threshold ?*/);
+    /*- endif -*/
     
     //If necessary, initialize Priority Inheritance Protocol
 
@@ -102,6 +497,40 @@ void /*? me.interface.name ?*/__init(void) {
       /*- set attr = '%s_num_threads' % me.interface.name -*/
       /*- set num_threads = int(configuration[me.instance.name].get(attr)) -*/
 
+      /*- if notification_pool -*/
+
+      /*
+        Waiters take their notification objects from the component's shared pool,
+        allocated by the first of its PIP interfaces (by name)
+      */
+      /*- if pool_owner -*/
+      {
+        static seL4_CPtr pool_ntfn_objs[/*? pool_size ?*/];
+        /*- for i in range(pool_size) -*/
+            /*- set ntfn = alloc('notification_pool_obj_%d' % i, seL4_NotificationObject, read=True, write=True) -*/
+            pool_ntfn_objs[/*? i ?*/] = /*? ntfn ?*/;
+        /*- endfor -*/
+        NOTIFICATION_POOL_INIT(&priority_notification_pool, pool_ntfn_objs, /*? pool_size ?*/)
+      }
+      /*- endif -*/
+
+      /*- if lock_domains > 1 -*/
+        PRIORITY_INHERITANCE_DOMAINS_INIT(&/*? me.interface.name ?*/_info, /*? lock_domains ?*/, /*? num_threads ?*/)
+        /*- for d in range(lock_domains) -*/
+        {
+          NOTIFICATION_MANAGER_INIT_SHARED(&/*? me.interface.name ?*/_info.pip[/*? d ?*/].ntfn_mgr,
+              &priority_notification_pool, /*? num_threads ?*/)
+        }
+        /*- endfor -*/
+      /*- else -*/
+        PRIORITY_INHERITANCE_INIT(&/*? me.interface.name ?*/_info, /*? num_threads ?*/,
+            CAMKES_CONST_ATTR(/*? me.interface.name ?*/_priority))
+        NOTIFICATION_MANAGER_INIT_SHARED(&/*? me.interface.name ?*/_info.pip->ntfn_mgr,
+            &priority_notification_pool, /*? num_threads ?*/)
+      /*- endif -*/
+
+      /*- else -*/
+
       /*
         Allocates a static array of notification objects.
         Even though it's in the init function scope,
@@ -122,13 +551,222 @@ void /*? me.interface.name ?*/__init(void) {
         We currently use NUM_THREADS for safety.
         We defer analysis and evaluation with NUM_THREADS-1 to future work.
       */
-      PRIORITY_INHERITANCE_INIT(&/*? me.interface.name ?*/_info, /*? num_threads ?*/,
+      /*- if lock_domains > 1 -*/
+        //Domain 0 uses the notification objects above, and each other domain its own
+        PRIORITY_INHERITANCE_DOMAINS_INIT(&/*? me.interface.name ?*/_info, /*? lock_domains ?*/, /*? num_threads ?*/)
+        NOTIFICATION_MANAGER_INIT(&/*? me.interface.name ?*/_info.pip[0].ntfn_mgr, ntfn_objs, /*? num_threads ?*/);
+        /*- for d in range(1, lock_domains) -*/
+        {
+          static seL4_CPtr domain_ntfn_objs[/*? num_threads ?*/];
+          /*- for i in range(num_threads) -*/
+              /*- set ntfn = alloc('%s_ntfn_obj_%d_%d' % (me.interface.name, d, i), seL4_NotificationObject, read=True, write=True) -*/
+              domain_ntfn_objs[/*? i ?*/] = /*? ntfn ?*/;
+          /*- endfor -*/
+          NOTIFICATION_MANAGER_INIT(&/*? me.interface.name ?*/_info.pip[/*? d ?*/].ntfn_mgr, domain_ntfn_objs, /*? num_threads ?*/);
+        }
+        /*- endfor -*/
+      /*- else -*/
+        PRIORITY_INHERITANCE_INIT(&/*? me.interface.name ?*/_info, /*? num_threads ?*/,
+            CAMKES_CONST_ATTR(/*? me.interface.name ?*/_priority))
+        NOTIFICATION_MANAGER_INIT(&/*? me.interface.name ?*/_info.pip->ntfn_mgr, ntfn_objs, /*? num_threads ?*/);
+      /*- endif -*/
+
+      /*- endif -*/
+    /*- endif -*/
+
+    //If necessary, initialize continuations
+
+    /*- if num_continuations -*/
+    {
+      /*- set cnode = alloc_cap('%s_continuation_cnode' % me.interface.name, my_cnode, write=True) -*/
+      /*- set receiver_ntfn = alloc('%s_continuation_ntfn' % me.interface.name, seL4_NotificationObject, read=True, write=True) -*/
+
+      //Empty CNode slots, to which the receiver saves reply capabilities
+      static seL4_CPtr reply_slots[/*? num_continuations ?*/];
+      /*- for i in range(num_continuations) -*/
+          reply_slots[/*? i ?*/] = /*? alloc_cap('%s_continuation_reply_%d' % (me.interface.name, i), None) ?*/;
+      /*- endfor -*/
+
+      //Workers wait for parked continuations on a Notification Manager
+      static seL4_CPtr worker_ntfn_objs[/*? num_threads - 1 ?*/];
+      /*- for i in range(num_threads - 1) -*/
+          /*- set ntfn = alloc('%s_continuation_ntfn_obj_%d' % (me.interface.name, i), seL4_NotificationObject, read=True, write=True) -*/
+          worker_ntfn_objs[/*? i ?*/] = /*? ntfn ?*/;
+      /*- endfor -*/
+
+      CONTINUATION_POOL_INIT(&/*? me.interface.name ?*/_continuation_pool, /*? num_continuations ?*/,
+          reply_slots, /*? cnode ?*/, /*? receiver_ntfn ?*/,
           CAMKES_CONST_ATTR(/*? me.interface.name ?*/_priority))
-      NOTIFICATION_MANAGER_INIT(&/*? me.interface.name ?*/_info.pip->ntfn_mgr, ntfn_objs, /*? num_threads ?*/);
+      NOTIFICATION_MANAGER_INIT(&/*? me.interface.name ?*/_continuation_pool.ntfn_mgr,
+          worker_ntfn_objs, /*? num_threads - 1 ?*/);
+    }
+    /*- endif -*/
+
+    //If necessary, initialize the component's Future_Pool
+
+    /*- if future_workers -*/
+    {
+      //Workers wait for futures on a Notification Manager
+      static seL4_CPtr worker_ntfn_objs[/*? future_workers ?*/];
+      /*- for i in range(future_workers) -*/
+          /*- set ntfn = alloc('%s_future_ntfn_obj_%d' % (me.interface.name, i), seL4_NotificationObject, read=True, write=True) -*/
+          worker_ntfn_objs[/*? i ?*/] = /*? ntfn ?*/;
+      /*- endfor -*/
+
+      //Each thread of the component other than the workers may join futures (see above)
+      static seL4_CPtr join_ntfn_objs[/*? num_joiners ?*/];
+      /*- for i in range(num_joiners) -*/
+          /*- set ntfn = alloc('%s_future_join_ntfn_%d' % (me.interface.name, i), seL4_NotificationObject, read=True, write=True) -*/
+          join_ntfn_objs[/*? i ?*/] = /*? ntfn ?*/;
+      /*- endfor -*/
+
+      future_pool_init(/*? future_workers ?*/, join_ntfn_objs, /*? num_joiners ?*/,
+          CAMKES_CONST_ATTR(/*? me.interface.name ?*/_priority));
+      NOTIFICATION_MANAGER_INIT(&priority_future_pool.ntfn_mgr, worker_ntfn_objs, /*? future_workers ?*/);
+    }
+    /*- endif -*/
+
+    //If necessary, register threadpool threads for mode changes
+
+    /*- if mode_ceilings -*/
+      /*- set attr = '%s_num_threads' % me.interface.name -*/
+      PRIORITY_MODE_INIT(&/*? me.interface.name ?*/_info, /*? configuration[me.instance.name].get(attr) ?*/)
+    /*- endif -*/
+
+    //If necessary, initialize admission control
+
+    /*- if admission_enabled -*/
+      /*- set attr = '%s_admission_policy' % me.interface.name -*/
+      /*- set admission_policy = configuration[me.instance.name].get(attr, 'reject') -*/
+      /*- if admission_policy not in ('reject', 'background') -*/
+        /*? raise(TemplateError('Invalid attribute "%s" for %s, must be one of "reject", "background"' % (admission_policy, attr), me.parent)) ?*/
+      /*- endif -*/
+      /*- if admission_policy == 'background' and priority_protocol == 'fixed' -*/
+        /*? raise(TemplateError('Invalid attribute "background" for %s, requests of a CPI with a fixed priority protocol run at its ceiling, so deferring them has no effect; use "reject"' % attr, me.parent)) ?*/
+      /*- endif -*/
+      /*- if admission_policy == 'reject' -*/
+        /*
+          A refused request receives an empty reply, which its client only reports as an unmarshalling error
+          for a method with outputs, so every method must return a value or have an output parameter
+        */
+        /*- for f in me.parent.from_ends -*/
+          /*- for m in f.interface.type.methods -*/
+            /*- if m.return_type is none and not (m.parameters | selectattr('direction', 'in', ['out', 'inout']) | list) -*/
+              /*? raise(TemplateError('Invalid attribute "reject" for %s, method %s has no outputs, so its client cannot detect a refused request; use "background"' % (attr, m.name), me.parent)) ?*/
+            /*- endif -*/
+          /*- endfor -*/
+        /*- endfor -*/
+      /*- endif -*/
+      /*- set attr = '%s_admission_background_priority' % me.interface.name -*/
+      /*- set background_priority = configuration[me.instance.name].get(attr, 0) -*/
+
+      priority_clock_init(/*? configuration[me.instance.name].get('clock_cycles_per_us', 'PRIORITY_CLOCK_DEFAULT_CYCLES_PER_US') ?*/);
+      admission_control_init(&/*? me.interface.name ?*/_admission,
+          /*? me.interface.name ?*/_admission_clients, /*? len(admission_clients) ?*/,
+          admission_/*? admission_policy ?*/, /*? background_priority ?*/);
+    /*- endif -*/
+
+    //If necessary, initialize the inversion monitor
+
+    /*- if inversion_monitor -*/
+      //Requests can only be attributed to a blocking client if they are mutually exclusive
+      /*- set exclusive = priority_protocol == 'fixed' or (priority_protocol == 'inherited' and lock_domains == 1) -*/
+      priority_clock_init(/*? configuration[me.instance.name].get('clock_cycles_per_us', 'PRIORITY_CLOCK_DEFAULT_CYCLES_PER_US') ?*/);
+      inversion_monitor_init(&/*? me.interface.name ?*/_inversion,
+          /*? me.interface.name ?*/_inversion_clients, /*? len(me.parent.from_ends) ?*/,
+          /*? 'true' if exclusive else 'false' ?*/);
+    /*- endif -*/
+
+    //If necessary, initialize utilisation accounting
+
+    /*- if utilisation_accounting -*/
+      UTILISATION_ACCOUNTING_INIT(&/*? me.interface.name ?*/_utilisation,
+          /*? configuration[me.instance.name].get('%s_num_threads' % me.interface.name) ?*/,
+          /*? me.interface.name ?*/_utilisation_clients, /*? len(me.parent.from_ends) ?*/)
+    /*- endif -*/
+
+    //If necessary, initialize request capture
+
+    /*- if capture_dataport -*/
+      priority_clock_init(/*? configuration[me.instance.name].get('clock_cycles_per_us', 'PRIORITY_CLOCK_DEFAULT_CYCLES_PER_US') ?*/);
+      request_capture_init(&/*? me.interface.name ?*/_request_capture,
+          (void *) /*? capture_dataport ?*/, /*? capture_dataport_size ?*/);
+    /*- endif -*/
+
+    //If necessary, initialize stack high-water marks
+
+    /*- if stack_watermarks -*/
+      /*- set attr = '%s_num_threads' % me.interface.name -*/
+      STACK_WATERMARKS_INIT(&/*? me.interface.name ?*/_stack_watermarks,
+          /*? configuration[me.instance.name].get(attr) ?*/, /*? stack_size ?*/)
+    /*- endif -*/
+
+    //If necessary, initialize coalescing of idempotent requests
+
+    /*- if idempotent_methods -*/
+    {
+      /*- set num_threads = int(configuration[me.instance.name].get('%s_num_threads' % me.interface.name)) -*/
+
+      //Each threadpool thread waits on its own notification object while attached to a request
+      static seL4_CPtr coalescing_ntfn_objs[/*? num_threads ?*/];
+      /*- for i in range(num_threads) -*/
+          /*- set ntfn = alloc('%s_coalescing_ntfn_obj_%d' % (me.interface.name, i), seL4_NotificationObject, read=True, write=True) -*/
+          coalescing_ntfn_objs[/*? i ?*/] = /*? ntfn ?*/;
+      /*- endfor -*/
+
+      REQUEST_COALESCING_INIT(&/*? me.interface.name ?*/_coalescing, coalescing_ntfn_objs, /*? num_threads ?*/)
+    }
+    /*- endif -*/
+
+    //If necessary, initialize the result cache for pure methods
+
+    /*- if pure_methods -*/
+      /*- set attr = '%s_memo_entries' % me.interface.name -*/
+      /*- set memo_entries = int(configuration[me.instance.name].get(attr, 8)) -*/
+      /*- if memo_entries < 1 -*/
+        /*? raise(TemplateError('Invalid attribute "%s" for %s, must be at least 1' % (memo_entries, attr), me.parent)) ?*/
+      /*- endif -*/
+      MEMO_CACHE_INIT(&/*? me.interface.name ?*/_memo, /*? memo_entries ?*/)
     /*- endif -*/
 
     /*? me.interface.name ?*/_init();
 }
 
+//Report the interface's statistics, in the format of priority-stats.h
+void /*? me.interface.name ?*/_report_stats(void) {
+    priority_protocol_report(&/*? me.interface.name ?*/_info, "/*? me.interface.name ?*/");
+    priority_sizing_report(&/*? me.interface.name ?*/_info, "/*? me.interface.name ?*/",
+        /*? configuration[me.instance.name].get('%s_num_threads' % me.interface.name) ?*/, /*? stack_size ?*/,
+        /*- if stack_watermarks -*/
+        stack_watermark_max_used(&/*? me.interface.name ?*/_stack_watermarks));
+        /*- else -*/
+        0);
+        /*- endif -*/
+    /*- if pure_methods -*/
+    memo_cache_report(&/*? me.interface.name ?*/_memo, "/*? me.interface.name ?*/");
+    /*- endif -*/
+    /*- if idempotent_methods -*/
+    request_coalescing_report(&/*? me.interface.name ?*/_coalescing, "/*? me.interface.name ?*/");
+    /*- endif -*/
+    /*- if admission_enabled -*/
+    admission_report(&/*? me.interface.name ?*/_admission, "/*? me.interface.name ?*/");
+    /*- endif -*/
+    /*- if notification_pool and pool_owner -*/
+    ntfn_pool_report(&priority_notification_pool, "component");
+    /*- endif -*/
+    /*- if future_workers -*/
+    future_pool_report("/*? me.interface.name ?*/");
+    /*- endif -*/
+    /*- if capture_dataport -*/
+    request_capture_report(&/*? me.interface.name ?*/_request_capture, "/*? me.interface.name ?*/");
+    /*- endif -*/
+    /*- if inversion_monitor -*/
+    inversion_monitor_report(&/*? me.interface.name ?*/_inversion, "/*? me.interface.name ?*/");
+    /*- endif -*/
+    /*- if utilisation_accounting -*/
+    utilisation_report(&/*? me.interface.name ?*/_utilisation, "/*? me.interface.name ?*/");
+    /*- endif -*/
+}
+
 
 /*- endif -*/
@@ -0,0 +1,104 @@
+/*
+ *
+ * seL4RPCCallPrioritizedRouted-from.template.c
+ *
+ * Implements the sender side of the routed RPC connectors
+ * for the priority-aware concurrency framework extensions.
+ *
+ * A routed connection fronts several replicas of a stateless CPI, one per to-end.
+ * Requests are marshalled and carry their priority as for seL4RPCCallPrioritized,
+ * but each is sent to the replica it is routed to, by priority and load.
+ * See replica-routing.h for more details.
+ *
+ */
+
+/*- if configuration[me.instance.name].get('environment', 'c').lower() == 'c' -*/
+
+#include <camkes.h>
+#include <sel4/sel4.h>
+#include <utils/attribute.h>
+#include <utils/util.h>
+
+/*
+  priority-extensions:
+
+  Include necessary declarations from the priority protocols library
+*/
+#include "../priority-aware-camkes/priority-protocols/replica-routing.h"
+
+/*- if configuration[me.parent.name].get('buffer') is not none -*/
+  /*? raise(TemplateError('Routed connection %s must use the IPC buffer' % me.parent.name, me.parent)) ?*/
+/*- endif -*/
+/*- set num_replicas = len(me.parent.to_ends) -*/
+
+/*
+  Each replica receives on its own endpoint.
+  This client's capability to each is badged by its index, as the replicas expect
+  (see seL4RPCCallPrioritizedRouted-to.template.c)
+*/
+/*- set badge = me.parent.from_ends.index(me) + 1 -*/
+static const seL4_CPtr /*? me.interface.name ?*/_replica_eps[/*? num_replicas ?*/] = {
+/*- for replica in me.parent.to_ends -*/
+  /*- set ep_obj = alloc_obj('replica_ep_%d' % loop.index0, seL4_EndpointObject) -*/
+  /*- set ep = alloc_cap('replica_ep_%d' % loop.index0, ep_obj, write=True, grantreply=True) -*/
+  /*- do cap_space.cnode[ep].set_badge(badge) -*/
+    [/*? loop.index0 ?*/] = /*? ep ?*/,
+/*- endfor -*/
+};
+
+static const unsigned /*? me.interface.name ?*/_replica_threads[/*? num_replicas ?*/] = {
+/*- for replica in me.parent.to_ends -*/
+    [/*? loop.index0 ?*/] = /*? configuration[replica.instance.name].get('%s_num_threads' % replica.interface.name) ?*/,
+/*- endfor -*/
+};
+
+static unsigned long long /*? me.interface.name ?*/_replica_routed[/*? num_replicas ?*/];
+
+//The requests in flight at each replica are shared by every client of the connection
+/*- set routing_symbol = '%s_routing_state' % me.interface.name -*/
+struct {
+    char content[PAGE_SIZE_4K];
+} /*? routing_symbol ?*/ ALIGN(PAGE_SIZE_4K) SECTION("align_12bit");
+/*? register_shared_variable('%s_routing' % me.parent.name, routing_symbol, 4096) ?*/
+
+_Static_assert(sizeof(struct Replica_Routing_State) <= PAGE_SIZE_4K,
+    "replica routing state must fit in a page");
+_Static_assert(/*? num_replicas ?*/ <= REPLICA_ROUTING_MAX,
+    "routed connection /*? me.parent.name ?*/ has more than REPLICA_ROUTING_MAX replicas");
+
+/*
+  Requests at or above the connection's routing_priority attribute
+  are sent to the least-loaded free replica, and others packed onto the most-loaded
+*/
+static struct Replica_Routing /*? me.interface.name ?*/_routing = {
+    .state = (struct Replica_Routing_State *) &/*? routing_symbol ?*/,
+    .num_replicas = /*? num_replicas ?*/,
+    .num_threads = /*? me.interface.name ?*/_replica_threads,
+    .routing_priority = /*? configuration[me.parent.name].get('routing_priority', 0) ?*/,
+    .routed = /*? me.interface.name ?*/_replica_routed
+};
+
+//Report the requests this client routed to each replica (see priority-stats.h)
+void /*? me.interface.name ?*/_routing_report(void) {
+    replica_routing_report(&/*? me.interface.name ?*/_routing, "/*? me.interface.name ?*/");
+}
+
+/*
+  Call the replica a request is routed to, by the priority in its first message register,
+  in place of the perform_call of rpc-connector.c.
+  Requests are sent in the IPC buffer, so the request length is its length in message registers.
+*/
+/*- macro perform_routed_call(namespace, size, length) -*/
+    {
+        unsigned replica = replica_route_acquire(&/*? me.interface.name ?*/_routing,
+                (int) seL4_GetMR(0));
+        seL4_MessageInfo_t info = seL4_Call(/*? me.interface.name ?*/_replica_eps[replica],
+                seL4_MessageInfo_new(0, 0, 0, ROUND_UP_UNSAFE(/*? length ?*/, sizeof(seL4_Word)) / sizeof(seL4_Word)));
+        replica_route_release(&/*? me.interface.name ?*/_routing, replica);
+        /*? size ?*/ = seL4_MessageInfo_get_length(info) * sizeof(seL4_Word);
+    }
+/*- endmacro -*/
+
+/*- endif -*/
+
+/*- include 'seL4RPCCallPrioritized-from.template.c' -*/
@@ -0,0 +1,22 @@
+/*
+ *
+ * seL4RPCCallPrioritizedRouted-to.template.c
+ *
+ * Implements the recipient side of the routed RPC connectors
+ * for the priority-aware concurrency framework extensions.
+ *
+ * Each to-end of a routed connection is a replica of the same stateless CPI,
+ * handling the requests routed to it exactly as a CPI connected with seL4RPCCallPrioritized,
+ * with its own threadpool, priority protocol and attributes.
+ * Only the endpoint it receives on differs (see seL4RPCCallPrioritized-to.template.c).
+ * See replica-routing.h for more details.
+ *
+ */
+
+/*- if configuration[me.parent.name].get('buffer') is not none -*/
+  /*? raise(TemplateError('Routed connection %s must use the IPC buffer' % me.parent.name, me.parent)) ?*/
+/*- endif -*/
+
+/*- set replica_index = me.parent.to_ends.index(me) -*/
+
+/*- include 'seL4RPCCallPrioritized-to.template.c' -*/